@@ -0,0 +1,359 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Segment many images without a display. Each line of the manifest describes one job:
+ *
+ *   image foreground.png background.png lambda bins [output.png [cutout.png [overlay.png]]]
+ *
+ * The foreground/background files are the same seed masks that are read by
+ * "Selections->Load Foreground/Background" in the GUI (any non-zero pixel is a seed).
+ * The output is the segment mask that "Export->Segment Mask" writes. If no output is
+ * given, it is written next to the input as <image>_mask.png. The optional cut-out (the segment on a transparent
+ * background) and overlay (the image with the segment tinted) are composed in the same pass over the image as the mask.
+ * Blank lines and lines starting with '#' are ignored.
+ *
+ * An 8 bit RGB or 8 or 16 bit gray image is cut in its own pixel type, every other image as float components.
+ *
+ * The image may also be a volume (e.g. a CT stack in a .mha file). It is then cut as a whole with a
+ * 6-connected graph, the seeds are read from volume masks, and the default output is <image>_mask.mha.
+ *
+ * Jobs are distributed over a pool of worker threads (one per core by default).
+ * ITK's own filter threading is disabled so that the workers do not oversubscribe the cores.
+*/
+
+// Custom
+#include "ImageFormat.h"
+#include "IncrementalImageGraphCut.h"
+#include "SegmentationExporter.h"
+
+// ITK
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkImageIOFactory.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkMultiThreader.h>
+#include <itkVectorImage.h>
+
+// STL
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/** One line of the manifest. */
+struct BatchJob
+{
+  std::string ImageFileName;
+  std::string ForegroundFileName;
+  std::string BackgroundFileName;
+  float Lambda;
+  int NumberOfHistogramBins;
+
+  /** Empty until the job is run if the manifest does not name it, since the default depends on the dimension. */
+  std::string OutputFileName;
+
+  /** Only written if the manifest names them (images only). */
+  std::string CutOutFileName;
+  std::string OverlayFileName;
+};
+
+/** Default output name: "path/image.png" -> "path/image_mask.png" (with 'extension' ".png"). */
+static std::string DefaultOutputFileName(const std::string& imageFileName, const std::string& extension)
+{
+  std::string::size_type dot = imageFileName.find_last_of('.');
+  std::string::size_type slash = imageFileName.find_last_of("/\\");
+  if(dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+    return imageFileName + "_mask" + extension;
+    }
+  return imageFileName.substr(0, dot) + "_mask" + extension;
+}
+
+static bool ReadManifest(const std::string& fileName, std::vector<BatchJob>& jobs)
+{
+  std::ifstream fin(fileName.c_str());
+  if(!fin)
+    {
+    std::cerr << "Could not open manifest " << fileName << std::endl;
+    return false;
+    }
+
+  std::string line;
+  unsigned int lineNumber = 0;
+  while(std::getline(fin, line))
+    {
+    lineNumber++;
+    std::string::size_type firstCharacter = line.find_first_not_of(" \t\r");
+    if(firstCharacter == std::string::npos || line[firstCharacter] == '#')
+      {
+      continue;
+      }
+
+    std::stringstream ss(line);
+    BatchJob job;
+    if(!(ss >> job.ImageFileName >> job.ForegroundFileName >> job.BackgroundFileName
+            >> job.Lambda >> job.NumberOfHistogramBins))
+      {
+      std::cerr << fileName << ":" << lineNumber
+                << ": expected 'image foreground background lambda bins [output [cutout [overlay]]]'" << std::endl;
+      return false;
+      }
+
+    ss >> job.OutputFileName >> job.CutOutFileName >> job.OverlayFileName;
+
+    if(job.Lambda <= 0)
+      {
+      std::cerr << fileName << ":" << lineNumber << ": lambda must be > 0" << std::endl;
+      return false;
+      }
+
+    if(job.NumberOfHistogramBins <= 0)
+      {
+      std::cerr << fileName << ":" << lineNumber << ": bins must be > 0" << std::endl;
+      return false;
+      }
+
+    jobs.push_back(job);
+    }
+
+  return true;
+}
+
+/** The non-zero pixels of a seed mask (an image or a volume, like the image it belongs to). */
+template <unsigned int VDimension>
+static std::vector<itk::Index<VDimension> > ReadSeeds(const std::string& fileName)
+{
+  typedef itk::Image<unsigned char, VDimension> SeedImageType;
+  typedef itk::ImageFileReader<SeedImageType> ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(fileName);
+  reader->Update();
+
+  std::vector<itk::Index<VDimension> > seeds;
+  itk::ImageRegionConstIteratorWithIndex<SeedImageType> seedIterator(reader->GetOutput(),
+                                                                     reader->GetOutput()->GetLargestPossibleRegion());
+  while(!seedIterator.IsAtEnd())
+    {
+    if(seedIterator.Get() != 0)
+      {
+      seeds.push_back(seedIterator.GetIndex());
+      }
+    ++seedIterator;
+    }
+  return seeds;
+}
+
+/** Write the mask, cut-out and overlay of an image in one pass. The workers already run one job per core, so the
+ *  exporter only uses threads to write the files concurrently. */
+template <typename TImage>
+static void WriteOutputs(const BatchJob& job, IncrementalImageGraphCut<TImage>& graphCut, std::true_type)
+{
+  typename IncrementalImageGraphCut<TImage>::MaskType* segmentMask = graphCut.GetSegmentMask();
+
+  SegmentationExporter<TImage> exporter;
+  exporter.SetImage(graphCut.GetImage());
+  exporter.SetMask(segmentMask, segmentMask->GetHoleValue(), segmentMask->GetValidValue());
+  exporter.Write(job.OutputFileName, job.CutOutFileName, job.OverlayFileName);
+}
+
+/** A volume only has a mask. */
+template <typename TImage>
+static void WriteOutputs(const BatchJob& job, IncrementalImageGraphCut<TImage>& graphCut, std::false_type)
+{
+  typedef typename IncrementalImageGraphCut<TImage>::MaskType MaskType;
+  typedef itk::ImageFileWriter<MaskType> WriterType;
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetFileName(job.OutputFileName);
+  writer->SetInput(graphCut.GetSegmentMask());
+  writer->Update();
+}
+
+/** Segment a single job whose image is read as a TImage. This is self contained (it owns its
+ *  reader, graph cut and writer) so that any number of jobs can run concurrently. */
+template <typename TImage>
+static void RunJob(BatchJob& job)
+{
+  const unsigned int Dimension = TImage::ImageDimension;
+  typedef itk::ImageFileReader<TImage> ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(job.ImageFileName);
+  reader->Update();
+
+  IncrementalImageGraphCut<TImage> graphCut;
+  graphCut.SetImage(reader->GetOutput());
+  graphCut.SetNumberOfHistogramBins(job.NumberOfHistogramBins);
+  graphCut.SetLambda(job.Lambda);
+  graphCut.SetSources(ReadSeeds<Dimension>(job.ForegroundFileName));
+  graphCut.SetSinks(ReadSeeds<Dimension>(job.BackgroundFileName));
+  graphCut.PerformSegmentation();
+
+  if(job.OutputFileName.empty())
+    {
+    job.OutputFileName = DefaultOutputFileName(job.ImageFileName, (Dimension == 2) ? ".png" : ".mha");
+    }
+
+  WriteOutputs(job, graphCut, std::integral_constant<bool, Dimension == 2>());
+}
+
+/** Run a job as an image or as a volume, depending on its file. An image is read in its own pixel type if it has
+ *  8 bit RGB or 8 or 16 bit gray pixels (see ImageFormat). */
+static void RunJob(BatchJob& job)
+{
+  itk::ImageIOBase::Pointer imageIO =
+    itk::ImageIOFactory::CreateImageIO(job.ImageFileName.c_str(), itk::ImageIOFactory::ReadMode);
+  if(imageIO.IsNull())
+    {
+    itkGenericExceptionMacro(<< "No ImageIO can read " << job.ImageFileName);
+    }
+  imageIO->SetFileName(job.ImageFileName);
+  imageIO->ReadImageInformation();
+
+  // A single slice stored as a volume is still an image
+  if(imageIO->GetNumberOfDimensions() == 3 && imageIO->GetDimensions(2) > 1)
+    {
+    RunJob<itk::VectorImage<float, 3> >(job);
+    return;
+    }
+
+  switch(ImageFormat::GetPixelFormat(imageIO))
+    {
+    case ImageFormat::RGB:
+      RunJob<ImageFormat::RGBImageType>(job);
+      break;
+    case ImageFormat::Gray:
+      RunJob<ImageFormat::GrayImageType>(job);
+      break;
+    case ImageFormat::Gray16:
+      RunJob<ImageFormat::Gray16ImageType>(job);
+      break;
+    default:
+      RunJob<ImageFormat::VectorImageType>(job);
+      break;
+    }
+}
+
+static void Usage(const char* programName)
+{
+  std::cerr << "Usage: " << programName << " manifest.txt [numberOfThreads]" << std::endl
+            << "Each manifest line: image foreground.png background.png lambda bins"
+            << " [output.png [cutout.png [overlay.png]]]"
+            << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  if(argc < 2 || argc > 3)
+    {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+    }
+
+  std::vector<BatchJob> jobs;
+  if(!ReadManifest(argv[1], jobs))
+    {
+    return EXIT_FAILURE;
+    }
+
+  if(jobs.empty())
+    {
+    std::cout << "Nothing to do." << std::endl;
+    return EXIT_SUCCESS;
+    }
+
+  unsigned int numberOfThreads = std::thread::hardware_concurrency();
+  if(argc == 3)
+    {
+    numberOfThreads = atoi(argv[2]);
+    }
+  if(numberOfThreads == 0)
+    {
+    numberOfThreads = 1;
+    }
+  if(numberOfThreads > jobs.size())
+    {
+    numberOfThreads = jobs.size();
+    }
+
+  // The parallelism is across images, so don't let ITK filters spawn their own threads as well.
+  itk::MultiThreader::SetGlobalDefaultNumberOfThreads(1);
+
+  // Register the ImageIO factories once from this thread instead of racing on them from the workers.
+  itk::ImageIOFactory::CreateImageIO(jobs[0].ImageFileName.c_str(), itk::ImageIOFactory::ReadMode);
+
+  std::cout << "Segmenting " << jobs.size() << " images with " << numberOfThreads
+            << " threads." << std::endl;
+
+  std::atomic<size_t> nextJob(0);
+  std::atomic<unsigned int> numberOfFailures(0);
+  std::mutex outputMutex;
+
+  auto worker = [&]()
+  {
+    for(size_t jobId = nextJob++; jobId < jobs.size(); jobId = nextJob++)
+      {
+      BatchJob& job = jobs[jobId];
+      try
+        {
+        RunJob(job);
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << "[" << jobId + 1 << "/" << jobs.size() << "] "
+                  << job.ImageFileName << " -> " << job.OutputFileName << std::endl;
+        }
+      catch(itk::ExceptionObject& e)
+        {
+        numberOfFailures++;
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cerr << "[" << jobId + 1 << "/" << jobs.size() << "] "
+                  << job.ImageFileName << " failed: " << e << std::endl;
+        }
+      catch(std::exception& e)
+        {
+        // e.g. std::bad_alloc for an image that does not fit in memory: fail this job, not the batch
+        numberOfFailures++;
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cerr << "[" << jobId + 1 << "/" << jobs.size() << "] "
+                  << job.ImageFileName << " failed: " << e.what() << std::endl;
+        }
+      }
+  };
+
+  std::vector<std::thread> threads;
+  for(unsigned int threadId = 0; threadId < numberOfThreads; ++threadId)
+    {
+    threads.push_back(std::thread(worker));
+    }
+
+  for(unsigned int threadId = 0; threadId < threads.size(); ++threadId)
+    {
+    threads[threadId].join();
+    }
+
+  if(numberOfFailures > 0)
+    {
+    std::cerr << numberOfFailures << " of " << jobs.size() << " images failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -24,6 +24,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "VTKHelpers/VTKHelpers.h"
 #include "Mask/Mask.h"
 
+// Custom
+#include "ImageFormat.h"
+#include "ImagePixelTraits.h"
+#include "PixelRuns.h"
+#include "RegionalCostTable.h"
+#include "SegmentationExporter.h"
+#include "VTKImageBridge.h"
+
 // ITK
 #include <itkCastImageFilter.h>
 #include <itkCovariantVector.h>
@@ -54,9 +62,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QFileDialog>
 #include <QLineEdit>
 #include <QMessageBox>
+#include <QThread>
 #include <QtConcurrentRun>
 
 // STL
+#include <algorithm>
 #include <iostream>
 
 GraphCutSegmentationWidget::GraphCutSegmentationWidget(const std::string& fileName) : QMainWindow(NULL)
@@ -79,7 +89,7 @@ void GraphCutSegmentationWidget::SharedConstructor()
   this->BackgroundColor[1] = 0;
   this->BackgroundColor[2] = 1;
   
-  SelectedPixelSet = &Sources;
+  this->SelectedLabel = SeedSet<2>::Source;
   
   SourceSinkImageData = vtkSmartPointer<vtkImageData>::New();
   SetupBothPanes(); // This must be called before SetupLeftPane() and SetupRightPane()
@@ -89,6 +99,17 @@ void GraphCutSegmentationWidget::SharedConstructor()
   // This will track if we should reset the camera or not
   this->AlreadySegmented = false;
 
+  this->LambdaSweepIsCurrent = false;
+  this->LambdaSweepMaximum = 0;
+
+  this->AbortSegmentation = false;
+  this->PendingCut = NoCut;
+
+  this->PixelFormat = ImageFormat::Vector;
+  this->ImageBuffer = NULL;
+  this->NumberOfComponents = 0;
+  SetGraphCut(new ImageGraphCutAdapter<ImageFormat::VectorImageType>);
+
   // Setup the progress bar
   this->ProgressDialog = new QProgressDialog();
   this->ProgressDialog->setMinimum(0);
@@ -96,6 +117,17 @@ void GraphCutSegmentationWidget::SharedConstructor()
   this->ProgressDialog->setWindowModality(Qt::WindowModal);
   connect(&this->FutureWatcher, SIGNAL(finished()), this, SLOT(slot_SegmentationComplete()));
   connect(&this->FutureWatcher, SIGNAL(finished()), this->ProgressDialog , SLOT(cancel()));
+  connect(this->ProgressDialog, SIGNAL(canceled()), this, SLOT(slot_CancelSegmentation()));
+
+  this->PreviewTimer = new QTimer(this);
+  this->PreviewTimer->setSingleShot(true);
+  this->PreviewTimer->setInterval(PreviewDelay);
+  connect(this->PreviewTimer, SIGNAL(timeout()), this, SLOT(slot_Preview()));
+
+  this->IdleTimer = new QTimer(this);
+  this->IdleTimer->setSingleShot(true);
+  this->IdleTimer->setInterval(IdleDelay);
+  connect(this->IdleTimer, SIGNAL(timeout()), this, SLOT(slot_Idle()));
   
   connect( this->sldHistogramBins, SIGNAL( valueChanged(int) ), this, SLOT(sldHistogramBins_valueChanged()));
   connect( this->sldLambda, SIGNAL( valueChanged(int) ), this, SLOT(UpdateLambda()));
@@ -118,12 +150,32 @@ void GraphCutSegmentationWidget::SharedConstructor()
   this->toolBar->addAction(actionSaveSegmentation);
 }
 
+void GraphCutSegmentationWidget::SetGraphCut(ImageGraphCutInterface* const graphCut)
+{
+  this->GraphCut.reset(graphCut);
+  this->GraphCut->SetNumberOfThreads(QThread::idealThreadCount());
+
+  // The cut runs in another thread, so its progress is queued to the event loop
+  this->GraphCut->SetAbortFlag(&this->AbortSegmentation);
+  this->GraphCut->SetTraceRecorder(&this->Trace);
+  this->GraphCut->SetProgressCallback([this](IncrementalImageGraphCutBase::ProgressPhase phase,
+                                             unsigned int done, unsigned int total)
+    {
+    QMetaObject::invokeMethod(this, "slot_Progress", Qt::QueuedConnection, Q_ARG(int, phase),
+                              Q_ARG(int, done), Q_ARG(int, total));
+    });
+}
+
 void GraphCutSegmentationWidget::SetupBothPanes()
 {
   this->OriginalImageSlice = vtkSmartPointer<vtkImageSlice>::New();
   this->OriginalImageSlice->VisibilityOff();
   this->OriginalImageSliceMapper = vtkSmartPointer<vtkImageSliceMapper>::New();
   this->OriginalImageSlice->SetMapper(this->OriginalImageSliceMapper);
+
+  // A wrapped image keeps its float components, which are shown like the unsigned char image they were read from
+  this->OriginalImageSlice->GetProperty()->SetColorWindow(VTKImageBridge::ColorWindow);
+  this->OriginalImageSlice->GetProperty()->SetColorLevel(VTKImageBridge::ColorLevel);
   
   this->ResultSlice = vtkSmartPointer<vtkImageSlice>::New();
   this->ResultSlice ->VisibilityOff();
@@ -155,11 +207,24 @@ void GraphCutSegmentationWidget::SetupLeftPane()
   this->LeftSourceSinkImageSlice->GetProperty()->SetInterpolationTypeToNearest();
   this->LeftSourceSinkImageSlice->SetMapper(this->LeftSourceSinkImageSliceMapper);
 
+  // The strokes that have not been uploaded with the rest of the overlay yet
+  this->StrokeImageData = vtkSmartPointer<vtkImageData>::New();
+  this->StrokeImageSliceMapper = vtkSmartPointer<vtkImageSliceMapper>::New();
+  this->StrokeImageSliceMapper->SetInputData(this->StrokeImageData);
+  this->StrokeImageSlice = vtkSmartPointer<vtkImageSlice>::New();
+  this->StrokeImageSlice->VisibilityOff();
+  this->StrokeImageSlice->GetProperty()->SetInterpolationTypeToNearest();
+  this->StrokeImageSlice->SetMapper(this->StrokeImageSliceMapper);
+  this->DirtyExtent[0] = 0;
+  this->DirtyExtent[1] = -1;
+
   this->LeftStack->AddImage(this->OriginalImageSlice);
   this->LeftStack->AddImage(this->LeftSourceSinkImageSlice);
+  this->LeftStack->AddImage(this->StrokeImageSlice);
   
   this->OriginalImageSlice->GetProperty()->SetLayerNumber(0); // 0 = Bottom of the stack
   this->LeftSourceSinkImageSlice->GetProperty()->SetLayerNumber(1); // The source/sink image should be displayed on top of the result image.
+  this->StrokeImageSlice->GetProperty()->SetLayerNumber(2);
   this->LeftStack->SetActiveLayer(1);
   
   this->LeftRenderer->AddViewProp(this->LeftStack);
@@ -254,7 +319,7 @@ void GraphCutSegmentationWidget::on_actionExportSegmentMask_triggered()
   typedef  itk::ImageFileWriter<Mask> WriterType;
   WriterType::Pointer writer = WriterType::New();
   writer->SetFileName(fileName.toStdString());
-  writer->SetInput(this->GraphCut.GetSegmentMask());
+  writer->SetInput(this->GraphCut->GetSegmentMask());
   writer->Update();
 }
 
@@ -274,29 +339,70 @@ void GraphCutSegmentationWidget::on_actionOpenImage_triggered()
   OpenFile(filename.toStdString());
 }
 
+void GraphCutSegmentationWidget::on_actionOpenSession_triggered()
+{
+  QString fileName = QFileDialog::getOpenFileName(this,
+     "Open Session", ".", "Session Files (*.gcs)");
+
+  if(fileName.isEmpty())
+    {
+    return;
+    }
+  OpenSession(fileName.toStdString());
+}
+
+void GraphCutSegmentationWidget::on_actionSaveSession_triggered()
+{
+  QString fileName = QFileDialog::getSaveFileName(this,
+    "Save Session", "session.gcs", "Session Files (*.gcs)");
+
+  if(fileName.isEmpty())
+    {
+    return;
+    }
+
+  if(!SaveSession(fileName.toStdString()))
+    {
+    QMessageBox msgBox;
+    msgBox.setText("Could not write " + fileName);
+    msgBox.exec();
+    }
+}
+
 // Display segmented image with transparent background pixels
 void GraphCutSegmentationWidget::slot_SegmentationComplete()
 {
   // When the ProgressThread emits the StopProgressSignal, we need to display the result of the segmentation
 
-  // Convert the segmentation mask to a binary VTK image
-  vtkSmartPointer<vtkImageData> VTKSegmentMask =
-    vtkSmartPointer<vtkImageData>::New();
-  ITKVTKHelpers::ITKScalarImageToScaledVTKImage(this->GraphCut.GetSegmentMask(), VTKSegmentMask);
+  // The right pane shows the whole overlay, so it needs the strokes that were only uploaded to the left pane
+  FlushDirtyRegion();
 
-  // Convert the image into a VTK image for display
-  vtkSmartPointer<vtkImageData> VTKImage =
-    vtkSmartPointer<vtkImageData>::New();
+  // The seeds changed during the cut, so its result is already out of date
+  if(this->PendingCut != NoCut)
+    {
+    CutType type = this->PendingCut;
+    this->PendingCut = NoCut;
+    StartSegmentation(type);
+    return;
+    }
 
-  ITKVTKHelpers::ITKImageToVTKRGBImage(this->GraphCut.GetImage(), VTKImage);
+  // A cancelled cut leaves the previous result, which is still displayed
+  if(this->GraphCut->GetAborted())
+    {
+    this->statusBar()->showMessage("Cut cancelled.");
+    return;
+    }
 
-  vtkSmartPointer<vtkImageData> VTKMaskedImage =
-    vtkSmartPointer<vtkImageData>::New();
-  VTKHelpers::MaskImage(VTKImage, VTKSegmentMask, VTKMaskedImage);
+  // After a sweep, show the level that the slider is at
+  if(!this->LambdaSweepIsCurrent && this->GraphCut->GetNumberOfLambdaLevels() > 0)
+    {
+    this->LambdaSweepIsCurrent = true;
+    this->GraphCut->SetLambdaLevel(this->sldLambda->value());
+    }
 
-  // Remove the old output, set the new output and refresh everything
-  //this->ResultActor = vtkSmartPointer<vtkImageActor>::New();
-  this->ResultSliceMapper->SetInputData(VTKMaskedImage);
+  // Show the foreground of the image: only the alpha channel of the result image changes
+  Mask* segmentMask = this->GraphCut->GetSegmentMask();
+  VTKImageBridge::UpdateMaskedImage(segmentMask, segmentMask->GetHoleValue(), this->ResultImageData);
 
   this->RightSourceSinkImageSlice->VisibilityOn();
   this->ResultSlice->VisibilityOn();
@@ -308,6 +414,69 @@ void GraphCutSegmentationWidget::slot_SegmentationComplete()
   this->Refresh();
 
   this->AlreadySegmented = true;
+
+  // Where the time of the cut (and of displaying it) went
+  this->statusBar()->showMessage(QString::fromStdString(this->Trace.GetSummary(this->CutStartTotals)));
+}
+
+void GraphCutSegmentationWidget::slot_Progress(int phase, int done, int total)
+{
+  // Progress that arrives after the cut finished is out of date
+  if(!this->FutureWatcher.isRunning())
+    {
+    return;
+    }
+
+  QString text;
+  switch(phase)
+    {
+    case IncrementalImageGraphCutBase::CreatingGraph:
+      text = QString("Creating the graph: %1%").arg(100 * done / total);
+      break;
+    case IncrementalImageGraphCutBase::CreatingHistograms:
+      text = "Computing the histograms";
+      break;
+    case IncrementalImageGraphCutBase::CreatingSuperpixels:
+      text = "Computing the superpixels";
+      break;
+    default:
+      text = QString("Computing the max-flow: %1 augmenting paths").arg(done);
+      break;
+    }
+
+  if(!this->ProgressDialog->isVisible())
+    {
+    this->statusBar()->showMessage(text);
+    return;
+    }
+
+  this->ProgressDialog->setLabelText(text);
+  if(phase == IncrementalImageGraphCutBase::CreatingGraph)
+    {
+    this->ProgressDialog->setMaximum(total);
+    this->ProgressDialog->setValue(done);
+    }
+  else
+    {
+    // The number of augmenting paths is not known in advance
+    this->ProgressDialog->setMaximum(0);
+    }
+}
+
+void GraphCutSegmentationWidget::slot_CancelSegmentation()
+{
+  this->PendingCut = NoCut;
+  this->AbortSegmentation = true;
+}
+
+void GraphCutSegmentationWidget::slot_Preview()
+{
+  RequestSegmentation(PreviewCut);
+}
+
+void GraphCutSegmentationWidget::slot_Idle()
+{
+  RequestSegmentation(FullCut);
 }
 
 float GraphCutSegmentationWidget::ComputeLambda()
@@ -326,46 +495,82 @@ void GraphCutSegmentationWidget::UpdateLambda()
   // Compute lambda and then set the label to this value so the user can see the current setting
   double lambda = ComputeLambda();
   this->lblLambda->setText(QString::number(lambda));
+
+  // If all of the lambdas have been solved for, show the result for this one
+  if(this->LambdaSweepIsCurrent && this->sldLambda->value() > 0 &&
+     this->txtLambdaMax->text().toDouble() == this->LambdaSweepMaximum && !this->FutureWatcher.isRunning())
+    {
+    this->GraphCut->SetLambdaLevel(this->sldLambda->value());
+    slot_SegmentationComplete();
+    }
 }
 
 void GraphCutSegmentationWidget::sldHistogramBins_valueChanged()
 {
-  this->GraphCut.SetNumberOfHistogramBins(sldHistogramBins->value());
+  // The next cut reads the slider, a running cut must not see the bins change
+  this->LambdaSweepIsCurrent = false;
+  if(!this->FutureWatcher.isRunning())
+    {
+    this->GraphCut->SetNumberOfHistogramBins(sldHistogramBins->value());
+    }
   //this->lblHistogramBins->setText(QString::number(sldHistogramBins->value())); // This is taken care of by a signal/slot pair setup in QtDesigner
 }
 
 void GraphCutSegmentationWidget::on_radForeground_clicked()
 {
-  this->SelectedPixelSet = &Sources;
+  this->SelectedLabel = SeedSet<2>::Source;
   this->GraphCutStyle->SetColorToGreen();
 }
 
 void GraphCutSegmentationWidget::on_radBackground_clicked()
 {
-  this->SelectedPixelSet = &Sinks;
+  this->SelectedLabel = SeedSet<2>::Sink;
   this->GraphCutStyle->SetColorToRed();
 }
 
+// The clears are recorded like strokes, so they can be undone
 void GraphCutSegmentationWidget::on_actionClearAll_activated()
 {
-  on_actionClearForegroundSelection_activated();
-  on_actionClearBackgroundSelection_activated();
+  std::vector<itk::Index<2> > pixels(this->Seeds.GetPixels(SeedSet<2>::Source));
+  const std::vector<itk::Index<2> >& sinks = this->Seeds.GetPixels(SeedSet<2>::Sink);
+  pixels.insert(pixels.end(), sinks.begin(), sinks.end());
+  ChangeSeeds(pixels, SeedSet<2>::None);
+  UpdateDirtyRegion();
+  Refresh();
 }
 
 void GraphCutSegmentationWidget::on_actionClearForegroundSelection_activated()
 {
-  this->Sources.clear();
-  UpdateSelections();
+  std::vector<itk::Index<2> > pixels(this->Seeds.GetPixels(SeedSet<2>::Source));
+  ChangeSeeds(pixels, SeedSet<2>::None);
+  UpdateDirtyRegion();
   Refresh();
 }
 
 void GraphCutSegmentationWidget::on_actionClearBackgroundSelection_activated()
 {
-  this->Sinks.clear();
-  UpdateSelections();
+  std::vector<itk::Index<2> > pixels(this->Seeds.GetPixels(SeedSet<2>::Sink));
+  ChangeSeeds(pixels, SeedSet<2>::None);
+  UpdateDirtyRegion();
   Refresh();
 }
 
+void GraphCutSegmentationWidget::on_actionUndo_triggered()
+{
+  if(this->History.CanUndo())
+    {
+    ApplyStroke(this->History.Undo(), true);
+    }
+}
+
+void GraphCutSegmentationWidget::on_actionRedo_triggered()
+{
+  if(this->History.CanRedo())
+    {
+    ApplyStroke(this->History.Redo(), false);
+    }
+}
+
 void GraphCutSegmentationWidget::on_actionSaveForegroundSelection_activated()
 {
 //   QString directoryName = QFileDialog::getExistingDirectory(this,
@@ -387,7 +592,7 @@ void GraphCutSegmentationWidget::on_actionSaveForegroundSelection_activated()
   foregroundImage->SetRegions(this->ImageRegion);
   foregroundImage->Allocate();
   
-  ITKHelpers::IndicesToBinaryImage(this->Sources, foregroundImage);
+  ITKHelpers::IndicesToBinaryImage(this->Seeds.GetPixels(SeedSet<2>::Source), foregroundImage);
 
   ITKHelpers::WriteImage(foregroundImage.GetPointer(), fileName.toStdString());
 }
@@ -415,16 +620,13 @@ void GraphCutSegmentationWidget::on_actionSaveBackgroundSelection_activated()
   backgroundImage->SetRegions(this->ImageRegion);
   backgroundImage->Allocate();
   
-  ITKHelpers::IndicesToBinaryImage(this->Sinks, backgroundImage);
+  ITKHelpers::IndicesToBinaryImage(this->Seeds.GetPixels(SeedSet<2>::Sink), backgroundImage);
 
   ITKHelpers::WriteImage(backgroundImage.GetPointer(), fileName.toStdString());
 }
 
 void GraphCutSegmentationWidget::on_btnCut_clicked()
 {
-  // Get the number of bins from the slider
-  this->GraphCut.SetNumberOfHistogramBins(this->sldHistogramBins->value());
-
   if(this->sldLambda->value() == 0)
     {
     QMessageBox msgBox;
@@ -433,16 +635,81 @@ void GraphCutSegmentationWidget::on_btnCut_clicked()
     return;
     }
 
+  this->IdleTimer->stop();
+  RequestSegmentation(FullCut);
+}
+
+void GraphCutSegmentationWidget::RequestSegmentation(const CutType type)
+{
+  // GraphCut must not be changed while it cuts, so a running cut is cancelled and the new one started when it stops
+  if(this->FutureWatcher.isRunning())
+    {
+    this->AbortSegmentation = true;
+    this->PendingCut = type;
+    return;
+    }
+
+  StartSegmentation(type);
+}
+
+unsigned int GraphCutSegmentationWidget::GetPreviewLevel() const
+{
+  const itk::Size<2> size = this->ImageRegion.GetSize();
+  unsigned int level = 0;
+  while(((size[0] + (1 << level) - 1) >> level) * ((size[1] + (1 << level) - 1) >> level) > MaximumPreviewPixels)
+    {
+    level++;
+    }
+  return level;
+}
+
+void GraphCutSegmentationWidget::StartSegmentation(const CutType type)
+{
+  // Get the number of bins from the slider
+  this->GraphCut->SetNumberOfHistogramBins(this->sldHistogramBins->value());
+
+  this->GraphCut->SetNumberOfResolutionLevels(this->spinResolutionLevels->value());
+  this->GraphCut->SetSuperpixelSize(this->spinSuperpixelSize->value());
+
   // Setup the graph cut from the GUI and the scribble selection
-  this->GraphCut.SetLambda(ComputeLambda());
+  this->GraphCut->SetLambda(ComputeLambda());
+
+  this->GraphCut->SetSeeds(this->Seeds);
 
-  this->GraphCut.SetSources(this->Sources);
-  this->GraphCut.SetSinks(this->Sinks);
+  this->AbortSegmentation = false;
+  this->CutStartTotals = this->Trace.GetTotals();
 
   /////////////
-  QFuture<void> future = QtConcurrent::run(this->GraphCut, &ImageGraphCut<ImageType>::PerformSegmentation);
+  // Run on the member itself (not a copy), since it holds the graph that the next cut continues from
+  QFuture<void> future;
+  this->LambdaSweepIsCurrent = false;
+  if(type == PreviewCut)
+    {
+    future = QtConcurrent::run(this->GraphCut.get(), &ImageGraphCutInterface::PerformPreviewSegmentation,
+                               GetPreviewLevel());
+    }
+  else if(this->chkLambdaSweep->isChecked())
+    {
+    // One level per slider position, so level i is lambda = i% of LambdaMax
+    this->LambdaSweepMaximum = this->txtLambdaMax->text().toDouble();
+    unsigned int numberOfLevels = this->sldLambda->maximum();
+    float maximumLambda = this->LambdaSweepMaximum * numberOfLevels / 100.;
+    future = QtConcurrent::run(this->GraphCut.get(), &ImageGraphCutInterface::PerformParametricSegmentation,
+                               maximumLambda, numberOfLevels);
+    }
+  else
+    {
+    future = QtConcurrent::run(this->GraphCut.get(), &ImageGraphCutInterface::PerformSegmentation);
+    }
   this->FutureWatcher.setFuture(future);
 
+  if(type == PreviewCut || this->chkRecutOnStroke->isChecked() || this->chkLivePreview->isChecked())
+    {
+    this->statusBar()->showMessage(type == PreviewCut ? "Previewing..." : "Cutting...");
+    return;
+    }
+
+  this->ProgressDialog->setLabelText("Cutting...");
   this->ProgressDialog->setMinimum(0);
   this->ProgressDialog->setMaximum(0);
   this->ProgressDialog->setWindowModality(Qt::WindowModal);
@@ -450,33 +717,166 @@ void GraphCutSegmentationWidget::on_btnCut_clicked()
 
 }
 
-void GraphCutSegmentationWidget::OpenFile(const std::string& fileName)
+/** Show 'image' in 'output'. An image with fixed size pixels is always shown from its own buffer. */
+template <typename TImage>
+static void DisplayImage(TImage* const image, vtkImageData* const output)
 {
-  // Clear the scribbles
-  this->Sources.clear();
-  this->Sinks.clear();
+  VTKImageBridge::WrapImage(image, output);
+}
 
-  this->ResultSlice->VisibilityOff();
-  
+/** An image with float components is converted if VTK cannot show its number of components. */
+static void DisplayImage(VTKImageBridge::ImageType* const image, vtkImageData* const output)
+{
+  if(VTKImageBridge::CanWrapImage(image))
+    {
+    VTKImageBridge::WrapImage(image, output);
+    }
+  else
+    {
+    ITKVTKHelpers::ITKImageToVTKRGBImage(image, output);
+    }
+}
+
+template <typename TImage>
+void GraphCutSegmentationWidget::OpenImage(const std::string& fileName, const ImageFormat::PixelFormat format)
+{
   // Read file
-  itk::ImageFileReader<ImageType>::Pointer reader = itk::ImageFileReader<ImageType>::New();
+  typename itk::ImageFileReader<TImage>::Pointer reader = itk::ImageFileReader<TImage>::New();
   reader->SetFileName(fileName);
   reader->Update();
+  typename TImage::Pointer image = reader->GetOutput();
+
+  SetImage(image.GetPointer(), format);
+}
+
+template <typename TImage>
+void GraphCutSegmentationWidget::OpenSessionImage(const SessionFile::Contents& contents)
+{
+  typedef typename TImage::InternalPixelType InternalPixelType;
+
+  itk::Size<2> size = {{contents.Width, contents.Height}};
+  itk::Index<2> corner = {{0, 0}};
+  itk::ImageRegion<2> region(corner, size);
+
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(region);
+  image->SetNumberOfComponentsPerPixel(contents.NumberOfComponents);
+
+  // Use the pixels where they are in the map of the session, without copying them
+  const unsigned int pixelSize = (ImagePixelTraits<TImage>::NumberOfComponents == 0) ? contents.NumberOfComponents : 1;
+  image->GetPixelContainer()->SetImportPointer(reinterpret_cast<InternalPixelType*>(contents.ImageBuffer),
+                                               region.GetNumberOfPixels() * pixelSize, false);
+
+  SetImage(image.GetPointer(), contents.PixelFormat);
+}
+
+template <typename TImage>
+void GraphCutSegmentationWidget::SetImage(TImage* const inputImage, const ImageFormat::PixelFormat format)
+{
+  typename TImage::Pointer image = inputImage;
+
+  this->ImageRegion = image->GetLargestPossibleRegion();
+
+  this->PixelFormat = format;
+  this->ImageBuffer = image->GetBufferPointer();
+  this->NumberOfComponents = image->GetNumberOfComponentsPerPixel();
+
+  // The bins of all the components of a pixel have to fit in the keys of the RegionalCostTable
+  const int maximumNumberOfHistogramBins = RegionalCostTable::GetMaximumNumberOfHistogramBins(this->NumberOfComponents);
+  this->sldHistogramBins->setMaximum(std::min(99, maximumNumberOfHistogramBins));
+  this->label_8->setNum(this->sldHistogramBins->maximum());
+
+  // Clear the scribbles
+  this->Seeds.SetRegion(this->ImageRegion);
+  this->History.Clear();
+  UpdateHistoryActions();
 
-  this->ImageRegion = reader->GetOutput()->GetLargestPossibleRegion();
+  ImageGraphCutAdapter<TImage>* graphCut = new ImageGraphCutAdapter<TImage>;
+  graphCut->GetGraphCut().SetImage(image);
+  SetGraphCut(graphCut);
 
-  this->GraphCut.SetImage(reader->GetOutput());
+  // Display the ITK image from its own buffer. GraphCut holds the image until the next one is opened.
+  this->OriginalImageData = vtkSmartPointer<vtkImageData>::New();
+  DisplayImage(image.GetPointer(), this->OriginalImageData);
+  this->OriginalImageSliceMapper->SetInputData(this->OriginalImageData);
 
-  // Convert the ITK image to a VTK image and display it
-  vtkSmartPointer<vtkImageData> VTKImage = vtkSmartPointer<vtkImageData>::New();
-  ITKVTKHelpers::ITKImageToVTKRGBImage(reader->GetOutput(), VTKImage);
+  const double colorWindow = VTKImageBridge::GetColorWindow(this->OriginalImageData);
+  this->OriginalImageSlice->GetProperty()->SetColorWindow(colorWindow);
+  this->OriginalImageSlice->GetProperty()->SetColorLevel(colorWindow / 2);
+
+  this->ResultImageData = vtkSmartPointer<vtkImageData>::New();
+  VTKImageBridge::CreateMaskedImage(image.GetPointer(), this->ResultImageData);
+  this->ResultSliceMapper->SetInputData(this->ResultImageData);
+
+  // Only the largest region of the segment, on a transparent background
+  this->WriteSegmentedImage = [this, image](const std::string& segmentedFileName)
+    {
+    Mask* segmentMask = this->GraphCut->GetSegmentMask();
+
+    SegmentationExporter<TImage> exporter;
+    exporter.SetImage(image);
+    exporter.SetMask(segmentMask, segmentMask->GetHoleValue(), segmentMask->GetValidValue());
+    exporter.SetKeepLargestComponent(true);
+    exporter.SetNumberOfThreads(QThread::idealThreadCount());
+    exporter.Write("", segmentedFileName, "");
+    };
+}
+
+void GraphCutSegmentationWidget::CloseImage()
+{
+  // The running cut still uses the old image
+  this->PreviewTimer->stop();
+  this->IdleTimer->stop();
+  if(this->FutureWatcher.isRunning())
+    {
+    this->PendingCut = NoCut;
+    this->AbortSegmentation = true;
+    this->FutureWatcher.waitForFinished();
+    }
+
+  this->ResultSlice->VisibilityOff();
+}
+
+void GraphCutSegmentationWidget::OpenFile(const std::string& fileName)
+{
+  if(SessionFile::IsSessionFile(fileName))
+    {
+    OpenSession(fileName);
+    return;
+    }
+
+  CloseImage();
+
+  const ImageFormat::PixelFormat format = ImageFormat::ReadPixelFormat(fileName);
+  switch(format)
+    {
+    case ImageFormat::RGB:
+      OpenImage<ImageFormat::RGBImageType>(fileName, format);
+      break;
+    case ImageFormat::Gray:
+      OpenImage<ImageFormat::GrayImageType>(fileName, format);
+      break;
+    case ImageFormat::Gray16:
+      OpenImage<ImageFormat::Gray16ImageType>(fileName, format);
+      break;
+    default:
+      OpenImage<ImageFormat::VectorImageType>(fileName, format);
+      break;
+    }
 
-  this->OriginalImageSliceMapper->SetInputData(VTKImage);
+  // The image of a session that was open before has been replaced, so its map is no longer used
+  this->Session.reset();
 
+  ShowImage();
+}
+
+void GraphCutSegmentationWidget::ShowImage()
+{
   // Setup the scribble canvas
-  VTKHelpers::SetImageSizeToMatch(VTKImage, this->SourceSinkImageData);
+  VTKHelpers::SetImageSizeToMatch(this->OriginalImageData, this->SourceSinkImageData);
   this->SourceSinkImageData->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
   VTKHelpers::MakeImageTransparent(this->SourceSinkImageData);
+  FlushDirtyRegion();
   
   this->LeftSourceSinkImageSlice->VisibilityOn();
   this->OriginalImageSlice->VisibilityOn();
@@ -487,21 +887,182 @@ void GraphCutSegmentationWidget::OpenFile(const std::string& fileName)
   // Setup the scribble style
   if(this->radBackground->isChecked())
     {
-    this->SelectedPixelSet = &Sinks;
+    this->SelectedLabel = SeedSet<2>::Sink;
     }
   else
     {
-    this->SelectedPixelSet = &Sources;
+    this->SelectedLabel = SeedSet<2>::Source;
     }
 
   this->AlreadySegmented = false;
+  this->LambdaSweepIsCurrent = false;
 
   this->GraphCutStyle->InitializeTracer(this->LeftSourceSinkImageSlice);
   //std::cout << "Exit OpenFile()" << std::endl;
 }
 
+/** The pixels of 'offsets' (in buffer order) of an image that is 'width' pixels wide. */
+static std::vector<itk::Index<2> > OffsetsToPixels(const std::vector<unsigned int>& offsets, const unsigned int width)
+{
+  std::vector<itk::Index<2> > pixels(offsets.size());
+  for(unsigned int i = 0; i < offsets.size(); ++i)
+    {
+    pixels[i][0] = offsets[i] % width;
+    pixels[i][1] = offsets[i] / width;
+    }
+  return pixels;
+}
+
+/** Add the pixels of the runs of a session to 'seeds' as 'label'. */
+static void AddSeedRuns(const unsigned int* const runs, const std::size_t numberOfRuns, const SeedSet<2>::Label label,
+                        SeedSet<2>& seeds)
+{
+  std::vector<unsigned int> offsets;
+  PixelRuns::Decode(runs, numberOfRuns, offsets);
+
+  seeds.Add(OffsetsToPixels(offsets, seeds.GetRegion().GetSize()[0]), label);
+}
+
+/** Append the runs of the seeds of 'label' to 'runs'. */
+static void EncodeSeedRuns(const SeedSet<2>& seeds, const SeedSet<2>::Label label, std::vector<unsigned int>& runs)
+{
+  const std::vector<itk::Index<2> >& pixels = seeds.GetPixels(label);
+  const unsigned int width = seeds.GetRegion().GetSize()[0];
+
+  std::vector<unsigned int> offsets(pixels.size());
+  for(unsigned int i = 0; i < pixels.size(); ++i)
+    {
+    offsets[i] = pixels[i][1] * width + pixels[i][0];
+    }
+  std::sort(offsets.begin(), offsets.end());
+  PixelRuns::Encode(offsets, runs);
+}
+
+void GraphCutSegmentationWidget::OpenSession(const std::string& fileName)
+{
+  std::unique_ptr<SessionFile> session(new SessionFile);
+  if(!session->Open(fileName))
+    {
+    QMessageBox msgBox;
+    msgBox.setText(QString::fromStdString("Could not read " + fileName));
+    msgBox.exec();
+    return;
+    }
+  const SessionFile::Contents& contents = session->GetContents();
+
+  CloseImage();
+
+  switch(contents.PixelFormat)
+    {
+    case ImageFormat::RGB:
+      OpenSessionImage<ImageFormat::RGBImageType>(contents);
+      break;
+    case ImageFormat::Gray:
+      OpenSessionImage<ImageFormat::GrayImageType>(contents);
+      break;
+    case ImageFormat::Gray16:
+      OpenSessionImage<ImageFormat::Gray16ImageType>(contents);
+      break;
+    default:
+      OpenSessionImage<ImageFormat::VectorImageType>(contents);
+      break;
+    }
+
+  // The image now uses the map of the session, and the one of the session that was open before is released
+  this->Session = std::move(session);
+
+  ShowImage();
+
+  // Settings
+  this->txtLambdaMax->setText(QString::number(contents.CutSettings.LambdaMax));
+  this->sldLambda->setValue(contents.CutSettings.LambdaPercent);
+  this->sldHistogramBins->setValue(contents.CutSettings.NumberOfHistogramBins);
+  this->spinResolutionLevels->setValue(contents.CutSettings.NumberOfResolutionLevels);
+  this->spinSuperpixelSize->setValue(contents.CutSettings.SuperpixelSize);
+  UpdateLambda();
+
+  // Seeds
+  AddSeedRuns(contents.SourceRuns, contents.NumberOfSourceRuns, SeedSet<2>::Source, this->Seeds);
+  AddSeedRuns(contents.SinkRuns, contents.NumberOfSinkRuns, SeedSet<2>::Sink, this->Seeds);
+  UpdateSelections();
+
+  // The graph, so that the next cut only changes its t-links
+  if(contents.NWeights)
+    {
+    this->GraphCut->SetNWeights(contents.NWeights);
+    }
+
+  // Segment
+  if(contents.NumberOfSegmentRuns > 0)
+    {
+    Mask* segmentMask = this->GraphCut->GetSegmentMask();
+    unsigned char* const maskBuffer = segmentMask->GetBufferPointer();
+    std::fill(maskBuffer, maskBuffer + this->ImageRegion.GetNumberOfPixels(), segmentMask->GetValidValue());
+    PixelRuns::Fill(contents.SegmentRuns, contents.NumberOfSegmentRuns, segmentMask->GetHoleValue(), maskBuffer);
+
+    VTKImageBridge::UpdateMaskedImage(segmentMask, segmentMask->GetHoleValue(), this->ResultImageData);
+    this->RightSourceSinkImageSlice->VisibilityOn();
+    this->ResultSlice->VisibilityOn();
+    this->RightRenderer->ResetCamera();
+    this->AlreadySegmented = true;
+    }
+
+  this->Refresh();
+}
+
+bool GraphCutSegmentationWidget::SaveSession(const std::string& fileName)
+{
+  if(!this->ImageBuffer)
+    {
+    return false;
+    }
+
+  // The segment and the graph must not change while they are written
+  this->FutureWatcher.waitForFinished();
+
+  SessionFile::Contents contents;
+  contents.PixelFormat = this->PixelFormat;
+  contents.Width = this->ImageRegion.GetSize()[0];
+  contents.Height = this->ImageRegion.GetSize()[1];
+  contents.NumberOfComponents = this->NumberOfComponents;
+  contents.ImageBuffer = this->ImageBuffer;
+
+  contents.CutSettings.LambdaMax = this->txtLambdaMax->text().toDouble();
+  contents.CutSettings.LambdaPercent = this->sldLambda->value();
+  contents.CutSettings.NumberOfHistogramBins = this->sldHistogramBins->value();
+  contents.CutSettings.NumberOfResolutionLevels = this->spinResolutionLevels->value();
+  contents.CutSettings.SuperpixelSize = this->spinSuperpixelSize->value();
+
+  std::vector<unsigned int> sourceRuns;
+  EncodeSeedRuns(this->Seeds, SeedSet<2>::Source, sourceRuns);
+  contents.SourceRuns = sourceRuns.data();
+  contents.NumberOfSourceRuns = sourceRuns.size() / 2;
+
+  std::vector<unsigned int> sinkRuns;
+  EncodeSeedRuns(this->Seeds, SeedSet<2>::Sink, sinkRuns);
+  contents.SinkRuns = sinkRuns.data();
+  contents.NumberOfSinkRuns = sinkRuns.size() / 2;
+
+  // The runs of the foreground (the hole of the mask)
+  std::vector<unsigned int> segmentRuns;
+  if(this->AlreadySegmented)
+    {
+    Mask* segmentMask = this->GraphCut->GetSegmentMask();
+    PixelRuns::Encode(segmentMask->GetBufferPointer(), this->ImageRegion.GetNumberOfPixels(),
+                      segmentMask->GetHoleValue(), segmentRuns);
+    }
+  contents.SegmentRuns = segmentRuns.data();
+  contents.NumberOfSegmentRuns = segmentRuns.size() / 2;
+
+  std::vector<float> nWeights;
+  contents.NWeights = this->GraphCut->GetNWeights(nWeights) ? nWeights.data() : NULL;
+
+  return SessionFile::Write(fileName, contents);
+}
+
 void GraphCutSegmentationWidget::Refresh()
 {
+  TraceRecorder::ScopedTimer timer(&this->Trace, "Render");
   this->qvtkWidgetRight->GetRenderWindow()->Render();
   this->qvtkWidgetLeft->GetRenderWindow()->Render();
   this->qvtkWidgetRight->GetInteractor()->Render();
@@ -513,54 +1074,12 @@ void GraphCutSegmentationWidget::on_actionExportSegmentedImage_triggered()
   QString fileName = QFileDialog::getSaveFileName(this,
     "Save Segmented Image", "segmented.png", "Image Files (*.png)");
 
-  if(fileName.isEmpty())
+  if(fileName.isEmpty() || !this->WriteSegmentedImage)
   {
     return;
   }
 
-  Mask::Pointer mask = Mask::New();
-  ITKHelpers::DeepCopy(this->GraphCut.GetSegmentMask(), mask.GetPointer());
-
-  mask->KeepLargestHole();
-  //mask->Invert();
-
-  typedef itk::RGBAPixel<unsigned char> TransparentPixelType;
-  typedef itk::Image<TransparentPixelType, 2>  TransparentImageType;
-
-  TransparentImageType::Pointer transparentImage = TransparentImageType::New();
-  transparentImage->SetRegions(mask->GetLargestPossibleRegion());
-  transparentImage->Allocate();
-  
-  itk::ImageRegionIterator<TransparentImageType> imageIterator(transparentImage, transparentImage->GetLargestPossibleRegion());
-
-  while(!imageIterator.IsAtEnd())
-    {
-    TransparentImageType::PixelType pixel = imageIterator.Get();
-
-    if(mask->IsHole(imageIterator.GetIndex()))
-      {
-      pixel.SetRed(this->GraphCut.GetImage()->GetPixel(imageIterator.GetIndex())[0]);
-      pixel.SetGreen(this->GraphCut.GetImage()->GetPixel(imageIterator.GetIndex())[1]);
-      pixel.SetBlue(this->GraphCut.GetImage()->GetPixel(imageIterator.GetIndex())[2]);
-      pixel.SetAlpha(255); // Invisible
-      }
-    else
-      {
-      pixel.SetRed(0);
-      pixel.SetGreen(0);
-      pixel.SetBlue(0);
-      pixel.SetAlpha(0); // Visible
-      }
-    imageIterator.Set(pixel);
-
-    ++imageIterator;
-  }
-
-  typedef  itk::ImageFileWriter<TransparentImageType> WriterType;
-  WriterType::Pointer writer = WriterType::New();
-  writer->SetFileName(fileName.toStdString());
-  writer->SetInput(transparentImage);
-  writer->Update();
+  this->WriteSegmentedImage(fileName.toStdString());
 }
 
 void GraphCutSegmentationWidget::on_actionLoadForeground_triggered()
@@ -580,7 +1099,12 @@ void GraphCutSegmentationWidget::on_actionLoadForeground_triggered()
 
   std::vector<itk::Index<2> > pixels = ITKHelpers::GetNonZeroPixels(reader->GetOutput());
 
-  this->Sources=pixels;
+  this->Seeds.Clear(SeedSet<2>::Source);
+  this->Seeds.Add(pixels, SeedSet<2>::Source);
+
+  // The strokes were made on the seeds that have been replaced
+  this->History.Clear();
+  UpdateHistoryActions();
 
   UpdateSelections();  
   std::cout << "Set " << pixels.size() << " new foreground pixels." << std::endl;
@@ -603,7 +1127,12 @@ void GraphCutSegmentationWidget::on_actionLoadBackground_triggered()
 
   std::vector<itk::Index<2> > pixels = ITKHelpers::GetNonZeroPixels(reader->GetOutput());
 
-  this->Sinks=pixels;
+  this->Seeds.Clear(SeedSet<2>::Sink);
+  this->Seeds.Add(pixels, SeedSet<2>::Sink);
+
+  // The strokes were made on the seeds that have been replaced
+  this->History.Clear();
+  UpdateHistoryActions();
 
   UpdateSelections();
   std::cout << "Set " << pixels.size() << " new background pixels." << std::endl;
@@ -620,26 +1149,199 @@ void GraphCutSegmentationWidget::ScribbleEventHandler(vtkObject* caller, long un
                                                                    this->ImageRegion,
                                                                    dilateRadius);
 
-  this->SelectedPixelSet->insert(this->SelectedPixelSet->end(), selection.begin(), selection.end());
+  // Pixels that are already seeds are not added again
+  ChangeSeeds(selection, this->SelectedLabel);
 
-  UpdateSelections();
+  // Only the stroke is painted and uploaded, the rest of the overlay did not change
+  UpdateDirtyRegion();
+  this->Refresh();
+
+  StartCutForSeeds();
+}
+
+void GraphCutSegmentationWidget::ChangeSeeds(const std::vector<itk::Index<2> >& pixels, const SeedSet<2>::Label label)
+{
+  // The pixels whose label changes, by the label they had
+  const unsigned int width = this->ImageRegion.GetSize()[0];
+  std::vector<unsigned int> changedOffsets[3];
+  for(unsigned int i = 0; i < pixels.size(); ++i)
+    {
+    SeedSet<2>::Label previousLabel = this->Seeds.GetLabel(pixels[i]);
+    if(previousLabel != label && this->ImageRegion.IsInside(pixels[i]))
+      {
+      changedOffsets[previousLabel].push_back(pixels[i][1] * width + pixels[i][0]);
+      }
+    }
+  this->History.Add(label, changedOffsets);
+  UpdateHistoryActions();
+
+  if(label == SeedSet<2>::None)
+    {
+    this->Seeds.Remove(pixels);
+    }
+  else
+    {
+    this->Seeds.Add(pixels, label);
+    }
+  this->LambdaSweepIsCurrent = false;
+  PaintSeeds(pixels, label);
+}
+
+void GraphCutSegmentationWidget::ApplyStroke(const StrokeHistory::Stroke& stroke, const bool undo)
+{
+  const unsigned int width = this->ImageRegion.GetSize()[0];
+  const SeedSet<2>::Label previousLabels[3] = {SeedSet<2>::None, SeedSet<2>::Source, SeedSet<2>::Sink};
+  for(unsigned int i = 0; i < 3; ++i)
+    {
+    std::vector<unsigned int> offsets;
+    StrokeHistory::GetOffsets(stroke, previousLabels[i], offsets);
+    if(offsets.empty())
+      {
+      continue;
+      }
+
+    std::vector<itk::Index<2> > pixels = OffsetsToPixels(offsets, width);
+    const SeedSet<2>::Label label = undo ? previousLabels[i] : stroke.NewLabel;
+    if(label == SeedSet<2>::None)
+      {
+      this->Seeds.Remove(pixels);
+      }
+    else
+      {
+      this->Seeds.Add(pixels, label);
+      }
+    PaintSeeds(pixels, label);
+    }
+  this->LambdaSweepIsCurrent = false;
+  UpdateHistoryActions();
+
+  UpdateDirtyRegion();
+  this->Refresh();
+
+  StartCutForSeeds();
+}
+
+void GraphCutSegmentationWidget::UpdateHistoryActions()
+{
+  this->actionUndo->setEnabled(this->History.CanUndo());
+  this->actionRedo->setEnabled(this->History.CanRedo());
+}
+
+void GraphCutSegmentationWidget::StartCutForSeeds()
+{
+  if(this->sldLambda->value() > 0)
+    {
+    if(this->chkLivePreview->isChecked())
+      {
+      this->PreviewTimer->start();
+      this->IdleTimer->start();
+      }
+    else if(this->chkRecutOnStroke->isChecked())
+      {
+      RequestSegmentation(FullCut);
+      }
+    }
+}
+
+void GraphCutSegmentationWidget::PaintSeeds(const std::vector<itk::Index<2> >& pixels, const SeedSet<2>::Label label)
+{
+  unsigned char green[4] = {0, 255, 0, 255};
+  unsigned char red[4] = {255, 0, 0, 255};
+  unsigned char transparent[4] = {0, 0, 0, 0};
+  const unsigned char* color = (label == SeedSet<2>::Source) ? green : (label == SeedSet<2>::Sink) ? red : transparent;
+
+  int* extent = this->SourceSinkImageData->GetExtent();
+  for(unsigned int i = 0; i < pixels.size(); ++i)
+    {
+    int x = pixels[i][0];
+    int y = pixels[i][1];
+    if(x < extent[0] || x > extent[1] || y < extent[2] || y > extent[3])
+      {
+      continue;
+      }
+
+    unsigned char* pixel = static_cast<unsigned char*>(this->SourceSinkImageData->GetScalarPointer(x, y, 0));
+    std::copy(color, color + 4, pixel);
+
+    if(this->DirtyExtent[0] > this->DirtyExtent[1])
+      {
+      this->DirtyExtent[0] = this->DirtyExtent[1] = x;
+      this->DirtyExtent[2] = this->DirtyExtent[3] = y;
+      }
+    else
+      {
+      this->DirtyExtent[0] = std::min(this->DirtyExtent[0], x);
+      this->DirtyExtent[1] = std::max(this->DirtyExtent[1], x);
+      this->DirtyExtent[2] = std::min(this->DirtyExtent[2], y);
+      this->DirtyExtent[3] = std::max(this->DirtyExtent[3], y);
+      }
+    }
+}
+
+void GraphCutSegmentationWidget::UpdateDirtyRegion()
+{
+  if(this->DirtyExtent[0] > this->DirtyExtent[1])
+    {
+    return;
+    }
+
+  const int width = this->DirtyExtent[1] - this->DirtyExtent[0] + 1;
+  const int height = this->DirtyExtent[3] - this->DirtyExtent[2] + 1;
+  if(width * height > MaximumDirtyPixels)
+    {
+    FlushDirtyRegion();
+    return;
+    }
+
+  // The extent places the copy over the same pixels of the overlay
+  this->StrokeImageData->SetSpacing(this->SourceSinkImageData->GetSpacing());
+  this->StrokeImageData->SetOrigin(this->SourceSinkImageData->GetOrigin());
+  this->StrokeImageData->SetExtent(this->DirtyExtent[0], this->DirtyExtent[1], this->DirtyExtent[2], this->DirtyExtent[3], 0, 0);
+  this->StrokeImageData->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+  for(int y = this->DirtyExtent[2]; y <= this->DirtyExtent[3]; ++y)
+    {
+    unsigned char* row = static_cast<unsigned char*>(this->SourceSinkImageData->GetScalarPointer(this->DirtyExtent[0], y, 0));
+    std::copy(row, row + 4 * width, static_cast<unsigned char*>(this->StrokeImageData->GetScalarPointer(this->DirtyExtent[0], y, 0)));
+    }
+  this->StrokeImageData->Modified();
+
+  this->StrokeImageSlice->VisibilityOn();
+}
+
+void GraphCutSegmentationWidget::FlushDirtyRegion()
+{
+  if(this->DirtyExtent[0] > this->DirtyExtent[1])
+    {
+    return;
+    }
+
+  this->SourceSinkImageData->Modified();
+
+  this->StrokeImageSlice->VisibilityOff();
+  this->DirtyExtent[0] = 0;
+  this->DirtyExtent[1] = -1;
 }
 
 void GraphCutSegmentationWidget::UpdateSelections()
 {
+  // The seeds changed, so a previous lambda sweep no longer applies
+  this->LambdaSweepIsCurrent = false;
+
   // First, clear the image
   VTKHelpers::MakeImageTransparent(this->SourceSinkImageData);
 
   unsigned char green[3] = {0, 255, 0};
   unsigned char red[3] = {255, 0, 0};
 
-  ITKVTKHelpers::SetPixels(this->SourceSinkImageData, this->Sources, green);
-  ITKVTKHelpers::SetPixels(this->SourceSinkImageData, this->Sinks, red);
+  ITKVTKHelpers::SetPixels(this->SourceSinkImageData, this->Seeds.GetPixels(SeedSet<2>::Source), green);
+  ITKVTKHelpers::SetPixels(this->SourceSinkImageData, this->Seeds.GetPixels(SeedSet<2>::Sink), red);
 
+  // The whole overlay is uploaded, so the strokes do not need their own layer anymore
+  FlushDirtyRegion();
   this->SourceSinkImageData->Modified();
 
-  std::cout << this->Sources.size() << " sources." << std::endl;
-  std::cout << this->Sinks.size() << " sinks." << std::endl;
+  std::cout << this->Seeds.GetPixels(SeedSet<2>::Source).size() << " sources." << std::endl;
+  std::cout << this->Seeds.GetPixels(SeedSet<2>::Sink).size() << " sinks." << std::endl;
 
   this->Refresh();
 }
@@ -694,3 +1396,20 @@ void GraphCutSegmentationWidget::on_actionExportScreenshotLeft_triggered()
   writer->SetInputConnection(windowToImageFilter->GetOutputPort());
   writer->Write();
 }
+
+void GraphCutSegmentationWidget::on_actionExportTrace_triggered()
+{
+  QString fileName = QFileDialog::getSaveFileName(this, "Save Trace", "trace.json", "Chrome Trace Files (*.json)");
+
+  if(fileName.isEmpty())
+    {
+    return;
+    }
+
+  if(!this->Trace.WriteChromeTrace(fileName.toStdString()))
+    {
+    QMessageBox msgBox;
+    msgBox.setText("Could not write " + fileName);
+    msgBox.exec();
+    }
+}
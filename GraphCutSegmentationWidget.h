@@ -30,14 +30,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // Qt
 #include <QFutureWatcher>
 #include <QProgressDialog>
+#include <QTimer>
 
 // Custom
-#include "ImageGraphCutSegmentation/ImageGraphCut.h"
+#include "ImageFormat.h"
+#include "ImageGraphCutInterface.h"
+#include "SeedSet.h"
+#include "SessionFile.h"
+#include "StrokeHistory.h"
+#include "TraceRecorder.h"
 
 // Submodules
 #include "ScribbleInteractorStyle/vtkInteractorStyleScribble.h"
 #include "ITKVTKCamera/ITKVTKCamera.h"
 
+// STL
+#include <atomic>
+#include <functional>
+#include <memory>
+
 // VTK
 class vtkImageSlice;
 class vtkImageSliceMapper;
@@ -60,10 +71,13 @@ public slots:
   void on_actionExportSegmentedImage_triggered();
   void on_actionExportSegmentMask_triggered();
   void on_actionExportScreenshotLeft_triggered();
+  void on_actionExportTrace_triggered();
 
   // File menu
   void on_actionExit_triggered();
   void on_actionOpenImage_triggered();
+  void on_actionOpenSession_triggered();
+  void on_actionSaveSession_triggered();
 
   void on_actionLoadForeground_triggered();
   void on_actionLoadBackground_triggered();
@@ -76,6 +90,9 @@ public slots:
   void on_actionClearForegroundSelection_activated();
   void on_actionClearAll_activated();
 
+  void on_actionUndo_triggered();
+  void on_actionRedo_triggered();
+
   void on_btnCut_clicked();
   void on_radForeground_clicked();
   void on_radBackground_clicked();
@@ -89,16 +106,33 @@ public slots:
 
   void slot_SegmentationComplete();
 
+  /** Show the progress of the running cut. It is called through the event loop from the cut's threads. */
+  void slot_Progress(int phase, int done, int total);
+
+  /** Stop the running cut. The result of the previous cut stays displayed. */
+  void slot_CancelSegmentation();
+
+  /** The live preview timers expired. */
+  void slot_Preview();
+  void slot_Idle();
+
   /** Setting lambda must be handled specially because we need to multiply the
    *  percentage set by the slider by the MaxLambda set in the text box
    */
   void UpdateLambda();
 
-  /** Open the specified file as a greyscale or color image,
-   *  depending on which type the user has specified through the file menu.
-   */
+  /** Open the specified file as a greyscale or color image, in the pixel type that ImageFormat chooses for it.
+   *  A session file is opened with OpenSession(). */
   void OpenFile(const std::string& fileName);
 
+  /** Continue the session of a SessionFile: its image, seeds, settings and segment are shown as they were saved,
+   *  and if it has the n-links of the image, the next cut does not compute them. */
+  void OpenSession(const std::string& fileName);
+
+  /** Write the image, seeds, settings, segment and (if the graph has been created) n-links to a SessionFile.
+   *  Returns false if it could not be written. */
+  bool SaveSession(const std::string& fileName);
+
 protected:
 
   void ScribbleEventHandler(vtkObject* caller, long unsigned int eventId, void* callData);
@@ -106,9 +140,44 @@ protected:
   /** A constructor that can be used by all other constructors. */
   void SharedConstructor();
 
+  /** Stop the running cut and hide its result, before another image is opened. */
+  void CloseImage();
+
+  /** Read the image of 'fileName' as a TImage and SetImage() it. */
+  template <typename TImage>
+  void OpenImage(const std::string& fileName, const ImageFormat::PixelFormat format);
+
+  /** Make a TImage that uses the image buffer of 'contents' and SetImage() it. */
+  template <typename TImage>
+  void OpenSessionImage(const SessionFile::Contents& contents);
+
+  /** Create GraphCut for 'image' (of 'format') and display it. */
+  template <typename TImage>
+  void SetImage(TImage* const image, const ImageFormat::PixelFormat format);
+
+  /** Set up the scribble canvas and the cameras for the image that SetImage() displayed. */
+  void ShowImage();
+
+  /** Replace GraphCut with 'graphCut' (which the widget takes ownership of) and connect it to the widget. */
+  void SetGraphCut(ImageGraphCutInterface* const graphCut);
+
   /** Compute lambda by multiplying the percentage set by the slider by the MaxLambda set in the text box. */
   float ComputeLambda();
 
+  /** A preview is a cut of a downsampled image (see IncrementalImageGraphCut::PerformPreviewSegmentation()). */
+  enum CutType {NoCut, PreviewCut, FullCut};
+
+  /** Start a cut of the current seeds, or if one is running, cancel it and start this one once it stops. */
+  void RequestSegmentation(const CutType type);
+
+  /** Start a cut of the current seeds in the background. A full cut that the user asked for while neither
+   *  chkRecutOnStroke nor chkLivePreview is checked shows ProgressDialog until it is done or cancelled, the
+   *  other cuts do not block the window. */
+  void StartSegmentation(const CutType type);
+
+  /** The pyramid level that a preview cuts: the finest one with at most MaximumPreviewPixels pixels. */
+  unsigned int GetPreviewLevel() const;
+
   /** Our scribble interactor style */
   vtkSmartPointer<vtkInteractorStyleScribble> GraphCutStyle;
 
@@ -121,6 +190,13 @@ protected:
 
   vtkSmartPointer<vtkImageSliceMapper> OriginalImageSliceMapper;
   vtkSmartPointer<vtkImageSliceMapper> ResultSliceMapper;
+
+  /** The image that is being segmented. It shares the buffer of the image of GraphCut if it can (see VTKImageBridge). */
+  vtkSmartPointer<vtkImageData> OriginalImageData;
+
+  /** The image with a transparent background. It is allocated when an image is opened, and only its alpha channel is
+   *  updated after a cut. */
+  vtkSmartPointer<vtkImageData> ResultImageData;
   
   /** The renderers */
   vtkSmartPointer<vtkRenderer> LeftRenderer;
@@ -129,9 +205,19 @@ protected:
   /** Refresh both renderers and render windows */
   void Refresh();
 
-  /** The main segmentation class. */
-  typedef itk::VectorImage<float,2> ImageType;
-  ImageGraphCut<ImageType> GraphCut;
+  /** The main segmentation class. It keeps its graph between cuts, so re-cutting after
+   *  adding strokes continues from the previous flow. It is created for the pixel type of every image that is
+   *  opened (see OpenImage()). */
+  std::unique_ptr<ImageGraphCutInterface> GraphCut;
+
+  /** Write the segment of the image on a transparent background to a file. It is set with the image, since it
+   *  needs its pixel type. */
+  std::function<void(const std::string& fileName)> WriteSegmentedImage;
+
+  /** The timers and counters of every cut and render of the session. The status bar shows the totals of the
+   *  last cut (since CutStartTotals), and Export->Trace writes the latest ones (see TraceRecorder). */
+  TraceRecorder Trace;
+  TraceRecorder::Totals CutStartTotals;
 
   /** Allows the background color to be changed*/
   double BackgroundColor[3];
@@ -141,11 +227,44 @@ protected:
   /** We set this when the image is opeend. We sometimes need to know how big the image is.*/
   itk::ImageRegion<2> ImageRegion;
 
+  /** The pixels of the image, for SaveSession(). The buffer belongs to the image of GraphCut. */
+  ImageFormat::PixelFormat PixelFormat;
+  void* ImageBuffer;
+  unsigned int NumberOfComponents;
+
+  /** The session that the image was opened from. The image of GraphCut uses its map as its buffer, so it is kept
+   *  until another image is opened. */
+  std::unique_ptr<SessionFile> Session;
+
   QFutureWatcher<void> FutureWatcher;
   QProgressDialog* ProgressDialog;
 
+  /** Set to stop the running cut. GraphCut only reads it, and it is reset before every cut. */
+  std::atomic<bool> AbortSegmentation;
+
+  /** The cut to start when the running one finishes, because the seeds changed during it. */
+  CutType PendingCut;
+
+  /** With chkLivePreview, every stroke restarts both timers. A preview starts PreviewDelay ms after the last
+   *  stroke, so a quick series of strokes only gets one, and a full cut IdleDelay ms after it. */
+  QTimer* PreviewTimer;
+  QTimer* IdleTimer;
+
+  static const int PreviewDelay = 50;
+  static const int IdleDelay = 1500;
+
+  /** About 35 ms per preview on a desktop CPU. */
+  static const unsigned int MaximumPreviewPixels = 256 * 256;
+
   bool AlreadySegmented;
 
+  /** True if the last cut was a sweep over all lambda levels and the seeds and bins have not
+   *  changed since, so the slider can show the result for any lambda without another cut. */
+  bool LambdaSweepIsCurrent;
+
+  /** The LambdaMax that the sweep was computed for. */
+  double LambdaSweepMaximum;
+
   vtkSmartPointer<vtkImageStack> LeftStack;
   vtkSmartPointer<vtkImageStack> RightStack;
 
@@ -164,13 +283,55 @@ protected:
   /** This function setups up things that are shared by both panes. */
   void SetupBothPanes();
 
-  typedef std::vector<itk::Index<2> > VectorOfPixels;
-  VectorOfPixels Sources;
-  VectorOfPixels Sinks;
-  VectorOfPixels* SelectedPixelSet;
+  /** The scribbled seeds. A pixel is only stored once however often it is scribbled over. */
+  SeedSet<2> Seeds;
+
+  /** The label that new scribbles get. */
+  SeedSet<2>::Label SelectedLabel;
+
+  /** The strokes and clears, so that they can be undone. */
+  StrokeHistory History;
+
+  /** Give 'pixels' 'label' (None to remove them), record the change in History and paint it. */
+  void ChangeSeeds(const std::vector<itk::Index<2> >& pixels, const SeedSet<2>::Label label);
+
+  /** Undo or redo 'stroke' in Seeds and paint it. */
+  void ApplyStroke(const StrokeHistory::Stroke& stroke, const bool undo);
+
+  /** Enable Undo and Redo if History has a stroke for them. */
+  void UpdateHistoryActions();
+
+  /** Start the cut that a change of the seeds asks for (a preview or a full cut, depending on the check boxes). */
+  void StartCutForSeeds();
   
+  /** Repaint all of the seeds into SourceSinkImageData. This is proportional to the size of the image, so
+   *  it is only used when the seeds are replaced (load, open). */
   void UpdateSelections();
 
+  /** Paint 'pixels' into SourceSinkImageData in the color of 'label' (transparent for None), without marking it
+   *  modified (which would upload the whole overlay to the graphics card again). The painted pixels are added to
+   *  DirtyExtent. */
+  void PaintSeeds(const std::vector<itk::Index<2> >& pixels, const SeedSet<2>::Label label);
+
+  /** Show the pixels of SourceSinkImageData that changed since it was last uploaded. They are copied into
+   *  StrokeImageData, which only covers DirtyExtent and is drawn on top of it, so a stroke only uploads its
+   *  own bounding box. Once DirtyExtent is larger than MaximumDirtyPixels, the whole overlay is uploaded. */
+  void UpdateDirtyRegion();
+
+  /** Upload the whole overlay and hide StrokeImageData. */
+  void FlushDirtyRegion();
+
+  /** The changed pixels of SourceSinkImageData, on top of it in the left pane. */
+  vtkSmartPointer<vtkImageData> StrokeImageData;
+  vtkSmartPointer<vtkImageSliceMapper> StrokeImageSliceMapper;
+  vtkSmartPointer<vtkImageSlice> StrokeImageSlice;
+
+  /** The bounding box (xmin, xmax, ymin, ymax) of the pixels painted since the last upload of SourceSinkImageData.
+   *  It is empty if xmin > xmax. */
+  int DirtyExtent[4];
+
+  static const int MaximumDirtyPixels = 1 << 20;
+
   void closeEvent(QCloseEvent *);
 
   ITKVTKCamera* LeftCamera = nullptr;
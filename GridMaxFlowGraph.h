@@ -0,0 +1,123 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* A max-flow graph for a 4-connected image grid (VDimension = 2) or a 6-connected volume grid
+ * (VDimension = 3). See MaxFlowBase for the algorithm.
+ *
+ * Node (z*height + y)*width + x is pixel (x,y,z). No arc records are stored: arc 2*VDimension*i+d goes from
+ * node i to its neighbor in direction d, so the head and the reverse of an arc are computed from its index,
+ * and the only per-arc data is the residual capacity in a packed array of 2*VDimension floats per node.
+ * With the 24 bytes of a node, that is 40 bytes per pixel and 48 per voxel, about half the memory of
+ * MaxFlowGraph for the same grid, and no node id image is needed.
+*/
+
+#ifndef GridMaxFlowGraph_H
+#define GridMaxFlowGraph_H
+
+#include "MaxFlowBase.h"
+
+// STL
+#include <cstddef>
+#include <vector>
+
+template <unsigned int VDimension>
+class GridMaxFlowGraph : public MaxFlowBase<GridMaxFlowGraph<VDimension> >
+{
+public:
+  typedef MaxFlowBase<GridMaxFlowGraph<VDimension> > Superclass;
+  typedef typename Superclass::NodeId NodeId;
+
+  /** The reverse of each direction is direction^1. Direction 2*d is the positive direction along axis d.
+   *  FORWARD and BACKWARD (the next and previous slice) only exist in a volume. */
+  enum Direction {RIGHT = 0, LEFT = 1, DOWN = 2, UP = 3, FORWARD = 4, BACKWARD = 5};
+
+  static const int NumberOfDirections = 2 * VDimension;
+
+  GridMaxFlowGraph();
+
+  /** Remove all edge weights and flow and create a width x height (x depth) grid of nodes with no terminal weights. */
+  void Reset(const unsigned int width, const unsigned int height, const unsigned int depth = 1);
+
+  unsigned int GetWidth() const;
+  unsigned int GetHeight() const;
+  unsigned int GetDepth() const;
+
+  /** The number of pairs of neighboring nodes. */
+  unsigned long long GetNumberOfEdges() const;
+
+  /** The bytes allocated for the nodes and the arcs. */
+  std::size_t GetMemorySize() const;
+
+  /** Set the capacity (in both directions) of the edge between node i and its RIGHT, DOWN or FORWARD neighbor.
+   *  This is only valid before the first MaxFlow() or after ResetFlow(). */
+  void SetEdgeWeight(const NodeId i, const Direction direction, const float weight);
+
+  /** The capacity that the edge was given by SetEdgeWeight(). It is recovered from the residual capacities of its
+   *  arcs (see ResetFlow()), so after MaxFlow() it can differ from it by a float rounding. */
+  float GetEdgeWeight(const NodeId i, const Direction direction) const;
+
+  /** Remove the flow, but keep the edge and terminal weights, so that the next MaxFlow() starts from zero. */
+  void ResetFlow();
+
+private:
+  friend class MaxFlowBase<GridMaxFlowGraph<VDimension> >;
+
+  /** The number of nodes along each axis. */
+  int Size[VDimension];
+
+  /** The difference between the id of a node and the id of its neighbor in each direction. */
+  int Offsets[NumberOfDirections];
+
+  /** The residual capacity of arc NumberOfDirections*i+d. Arcs that would leave the grid always have no
+   *  capacity, so the search never follows them. */
+  std::vector<float> ResidualCapacities;
+
+  int FirstArc(const int i) const
+  {
+    return NumberOfDirections * i;
+  }
+
+  int NextArc(const int a) const
+  {
+    return (a % NumberOfDirections == NumberOfDirections - 1) ? -1 : a + 1;
+  }
+
+  int Head(const int a) const
+  {
+    return a / NumberOfDirections + this->Offsets[a % NumberOfDirections];
+  }
+
+  int Sister(const int a) const
+  {
+    return NumberOfDirections * Head(a) + ((a % NumberOfDirections) ^ 1);
+  }
+
+  float& ResidualCapacity(const int a)
+  {
+    return this->ResidualCapacities[a];
+  }
+
+  /** The neighbor along the last axis is the farthest one. */
+  int GetMaximumArcSpan() const
+  {
+    return this->Offsets[NumberOfDirections - 2];
+  }
+};
+
+#include "GridMaxFlowGraph.hpp"
+
+#endif
@@ -0,0 +1,152 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GridMaxFlowGraph_HPP
+#define GridMaxFlowGraph_HPP
+
+#include "GridMaxFlowGraph.h" // Appease syntax parser
+
+// STL
+#include <algorithm>
+
+template <unsigned int VDimension>
+const int GridMaxFlowGraph<VDimension>::NumberOfDirections;
+
+template <unsigned int VDimension>
+GridMaxFlowGraph<VDimension>::GridMaxFlowGraph()
+{
+  std::fill(this->Size, this->Size + VDimension, 0);
+  std::fill(this->Offsets, this->Offsets + NumberOfDirections, 0);
+}
+
+template <unsigned int VDimension>
+void GridMaxFlowGraph<VDimension>::Reset(const unsigned int width, const unsigned int height, const unsigned int depth)
+{
+  const unsigned int size[3] = {width, height, depth};
+
+  // The offset along each axis is the number of nodes in one step along all of the axes before it
+  int stride = 1;
+  for(unsigned int axis = 0; axis < VDimension; ++axis)
+    {
+    this->Size[axis] = size[axis];
+    this->Offsets[2 * axis] = stride;
+    this->Offsets[2 * axis + 1] = -stride;
+    stride *= size[axis];
+    }
+
+  this->ResetNodes(stride);
+
+  this->ResidualCapacities.assign(NumberOfDirections * stride, 0.0f);
+}
+
+template <unsigned int VDimension>
+unsigned int GridMaxFlowGraph<VDimension>::GetWidth() const
+{
+  return this->Size[0];
+}
+
+template <unsigned int VDimension>
+unsigned int GridMaxFlowGraph<VDimension>::GetHeight() const
+{
+  return this->Size[1];
+}
+
+template <unsigned int VDimension>
+unsigned int GridMaxFlowGraph<VDimension>::GetDepth() const
+{
+  return (VDimension > 2) ? this->Size[VDimension - 1] : 1;
+}
+
+template <unsigned int VDimension>
+unsigned long long GridMaxFlowGraph<VDimension>::GetNumberOfEdges() const
+{
+  // Along each axis, every node but the last of its line has an edge to the next node
+  unsigned long long numberOfEdges = 0;
+  for(unsigned int axis = 0; axis < VDimension; ++axis)
+    {
+    if(this->Size[axis] > 0)
+      {
+      numberOfEdges += this->Nodes.size() / this->Size[axis] * (this->Size[axis] - 1);
+      }
+    }
+  return numberOfEdges;
+}
+
+template <unsigned int VDimension>
+std::size_t GridMaxFlowGraph<VDimension>::GetMemorySize() const
+{
+  return this->GetNodesMemorySize() + this->ResidualCapacities.capacity() * sizeof(float);
+}
+
+template <unsigned int VDimension>
+void GridMaxFlowGraph<VDimension>::SetEdgeWeight(const NodeId i, const Direction direction, const float weight)
+{
+  int a = NumberOfDirections * i + direction;
+  this->ResidualCapacities[a] = weight;
+  this->ResidualCapacities[Sister(a)] = weight;
+}
+
+template <unsigned int VDimension>
+float GridMaxFlowGraph<VDimension>::GetEdgeWeight(const NodeId i, const Direction direction) const
+{
+  int a = NumberOfDirections * i + direction;
+  return 0.5f * (this->ResidualCapacities[a] + this->ResidualCapacities[Sister(a)]);
+}
+
+template <unsigned int VDimension>
+void GridMaxFlowGraph<VDimension>::ResetFlow()
+{
+  // The flow on an edge moves capacity from one of its arcs to the other, so the weight of an
+  // edge is always the mean of the residual capacities of its two arcs.
+  int coordinates[VDimension];
+  std::fill(coordinates, coordinates + VDimension, 0);
+
+  const int numberOfNodes = this->Nodes.size();
+  for(NodeId i = 0; i < numberOfNodes; ++i)
+    {
+    for(unsigned int axis = 0; axis < VDimension; ++axis)
+      {
+      if(coordinates[axis] + 1 < this->Size[axis])
+        {
+        int a = NumberOfDirections * i + 2 * axis;
+        SetEdgeWeight(i, static_cast<Direction>(2 * axis),
+                      0.5f * (this->ResidualCapacities[a] + this->ResidualCapacities[Sister(a)]));
+        }
+      }
+
+    // Step to the coordinates of node i+1
+    for(unsigned int axis = 0; axis < VDimension; ++axis)
+      {
+      if(++coordinates[axis] < this->Size[axis])
+        {
+        break;
+        }
+      coordinates[axis] = 0;
+      }
+    }
+
+  // Set the terminal edges the same way SetTerminalWeights() does for a node without flow, and grow the search
+  // trees from scratch
+  this->Flow = 0;
+  this->SearchTreesAreCurrent = false;
+  for(unsigned int i = 0; i < this->Nodes.size(); ++i)
+    {
+    this->Nodes[i].TerminalCapacity = this->TerminalWeights[i];
+    }
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ImageFormat.h"
+
+// ITK
+#include <itkImageIOFactory.h>
+
+namespace ImageFormat
+{
+
+PixelFormat GetPixelFormat(const itk::ImageIOBase* const imageIO)
+{
+  const unsigned int numberOfComponents = imageIO->GetNumberOfComponents();
+  switch(imageIO->GetComponentType())
+    {
+    case itk::ImageIOBase::UCHAR:
+      if(numberOfComponents == 3)
+        {
+        return RGB;
+        }
+      if(numberOfComponents == 1)
+        {
+        return Gray;
+        }
+      break;
+    case itk::ImageIOBase::USHORT:
+      if(numberOfComponents == 1)
+        {
+        return Gray16;
+        }
+      break;
+    default:
+      break;
+    }
+
+  // Alpha channels, signed and floating point components
+  return Vector;
+}
+
+unsigned int GetComponentSize(const PixelFormat format)
+{
+  switch(format)
+    {
+    case RGB:
+    case Gray:
+      return sizeof(unsigned char);
+    case Gray16:
+      return sizeof(unsigned short);
+    default:
+      return sizeof(float);
+    }
+}
+
+PixelFormat ReadPixelFormat(const std::string& fileName)
+{
+  itk::ImageIOBase::Pointer imageIO =
+    itk::ImageIOFactory::CreateImageIO(fileName.c_str(), itk::ImageIOFactory::ReadMode);
+  if(imageIO.IsNull())
+    {
+    itkGenericExceptionMacro(<< "No ImageIO can read " << fileName);
+    }
+  imageIO->SetFileName(fileName);
+  imageIO->ReadImageInformation();
+  return GetPixelFormat(imageIO);
+}
+
+} // namespace ImageFormat
@@ -0,0 +1,56 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* The pixel type that an image file is read into. An image with 8 or 16 bit gray or 8 bit RGB pixels is read into an
+ * itk::Image of that pixel type, which takes the memory of the file (an 8 bit RGB pixel is 3 bytes instead of the 12
+ * of an itk::VectorImage<float, 2>) and has its number of components at compile time (see ImagePixelTraits). Every
+ * other image is read into an itk::VectorImage<float, 2>.
+*/
+
+#ifndef ImageFormat_H
+#define ImageFormat_H
+
+// ITK
+#include <itkImage.h>
+#include <itkImageIOBase.h>
+#include <itkRGBPixel.h>
+#include <itkVectorImage.h>
+
+// STL
+#include <string>
+
+namespace ImageFormat
+{
+  typedef itk::Image<itk::RGBPixel<unsigned char>, 2> RGBImageType;
+  typedef itk::Image<unsigned char, 2> GrayImageType;
+  typedef itk::Image<unsigned short, 2> Gray16ImageType;
+  typedef itk::VectorImage<float, 2> VectorImageType;
+
+  enum PixelFormat {RGB, Gray, Gray16, Vector};
+
+  /** The format of the image that 'imageIO' describes. ReadImageInformation() must have been called. */
+  PixelFormat GetPixelFormat(const itk::ImageIOBase* const imageIO);
+
+  /** The bytes of a component of an image of 'format' (a float for Vector). */
+  unsigned int GetComponentSize(const PixelFormat format);
+
+  /** Read the header of 'fileName' and return the format of its image. Throws an itk::ExceptionObject if no ImageIO
+   *  can read the file. */
+  PixelFormat ReadPixelFormat(const std::string& fileName);
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* The interface of an IncrementalImageGraphCut of an image, whatever the pixel type of the image. The GUI only learns
+ * the pixel type when it reads the header of a file (see ImageFormat), so it holds its cut through this interface
+ * and creates an ImageGraphCutAdapter<TImage> for every image that it opens.
+*/
+
+#ifndef ImageGraphCutInterface_H
+#define ImageGraphCutInterface_H
+
+// Custom
+#include "IncrementalImageGraphCut.h"
+
+// Submodules
+#include "Mask/Mask.h"
+
+// STL
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+class ImageGraphCutInterface : public IncrementalImageGraphCutBase
+{
+public:
+  virtual ~ImageGraphCutInterface() {}
+
+  /** See IncrementalImageGraphCut. */
+  virtual void SetSeeds(const SeedSet<2>& seeds) = 0;
+  virtual void SetLambda(const float lambda) = 0;
+  virtual void SetNumberOfHistogramBins(const int bins) = 0;
+  virtual void SetNumberOfThreads(const unsigned int numberOfThreads) = 0;
+  virtual void SetNumberOfResolutionLevels(const unsigned int numberOfLevels) = 0;
+  virtual void SetSuperpixelSize(const unsigned int size) = 0;
+
+  virtual bool GetNWeights(std::vector<float>& weights) const = 0;
+  virtual void SetNWeights(const float* const weights) = 0;
+
+  virtual void PerformSegmentation() = 0;
+  virtual void PerformPreviewSegmentation(const unsigned int level) = 0;
+  virtual void PerformParametricSegmentation(const float maximumLambda, const unsigned int numberOfLevels) = 0;
+
+  virtual Mask* GetSegmentMask() = 0;
+  virtual unsigned int GetNumberOfLambdaLevels() const = 0;
+  virtual void SetLambdaLevel(const unsigned int level) = 0;
+
+  virtual void SetAbortFlag(const std::atomic<bool>* const abortFlag) = 0;
+  virtual bool GetAborted() const = 0;
+  virtual void SetProgressCallback(const ProgressCallbackType& callback) = 0;
+  virtual void SetTraceRecorder(TraceRecorder* const recorder) = 0;
+  virtual std::size_t GetMemorySize() const = 0;
+};
+
+/** Forward the interface to an IncrementalImageGraphCut<TImage>, where TImage is a two dimensional image. */
+template <typename TImage>
+class ImageGraphCutAdapter : public ImageGraphCutInterface
+{
+public:
+  /** The cut itself, for what depends on the pixel type (SetImage(), GetImage()). */
+  IncrementalImageGraphCut<TImage>& GetGraphCut();
+
+  void SetSeeds(const SeedSet<2>& seeds);
+  void SetLambda(const float lambda);
+  void SetNumberOfHistogramBins(const int bins);
+  void SetNumberOfThreads(const unsigned int numberOfThreads);
+  void SetNumberOfResolutionLevels(const unsigned int numberOfLevels);
+  void SetSuperpixelSize(const unsigned int size);
+
+  bool GetNWeights(std::vector<float>& weights) const;
+  void SetNWeights(const float* const weights);
+
+  void PerformSegmentation();
+  void PerformPreviewSegmentation(const unsigned int level);
+  void PerformParametricSegmentation(const float maximumLambda, const unsigned int numberOfLevels);
+
+  Mask* GetSegmentMask();
+  unsigned int GetNumberOfLambdaLevels() const;
+  void SetLambdaLevel(const unsigned int level);
+
+  void SetAbortFlag(const std::atomic<bool>* const abortFlag);
+  bool GetAborted() const;
+  void SetProgressCallback(const ProgressCallbackType& callback);
+  void SetTraceRecorder(TraceRecorder* const recorder);
+  std::size_t GetMemorySize() const;
+
+protected:
+  IncrementalImageGraphCut<TImage> GraphCut;
+};
+
+#include "ImageGraphCutInterface.hpp"
+
+#endif
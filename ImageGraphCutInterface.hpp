@@ -0,0 +1,139 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ImageGraphCutInterface.h" // Appease syntax parser
+
+template <typename TImage>
+IncrementalImageGraphCut<TImage>& ImageGraphCutAdapter<TImage>::GetGraphCut()
+{
+  return this->GraphCut;
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::SetSeeds(const SeedSet<2>& seeds)
+{
+  this->GraphCut.SetSeeds(seeds);
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::SetLambda(const float lambda)
+{
+  this->GraphCut.SetLambda(lambda);
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::SetNumberOfHistogramBins(const int bins)
+{
+  this->GraphCut.SetNumberOfHistogramBins(bins);
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::SetNumberOfThreads(const unsigned int numberOfThreads)
+{
+  this->GraphCut.SetNumberOfThreads(numberOfThreads);
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::SetNumberOfResolutionLevels(const unsigned int numberOfLevels)
+{
+  this->GraphCut.SetNumberOfResolutionLevels(numberOfLevels);
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::SetSuperpixelSize(const unsigned int size)
+{
+  this->GraphCut.SetSuperpixelSize(size);
+}
+
+template <typename TImage>
+bool ImageGraphCutAdapter<TImage>::GetNWeights(std::vector<float>& weights) const
+{
+  return this->GraphCut.GetNWeights(weights);
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::SetNWeights(const float* const weights)
+{
+  this->GraphCut.SetNWeights(weights);
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::PerformSegmentation()
+{
+  this->GraphCut.PerformSegmentation();
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::PerformPreviewSegmentation(const unsigned int level)
+{
+  this->GraphCut.PerformPreviewSegmentation(level);
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::PerformParametricSegmentation(const float maximumLambda,
+                                                                 const unsigned int numberOfLevels)
+{
+  this->GraphCut.PerformParametricSegmentation(maximumLambda, numberOfLevels);
+}
+
+template <typename TImage>
+Mask* ImageGraphCutAdapter<TImage>::GetSegmentMask()
+{
+  return this->GraphCut.GetSegmentMask();
+}
+
+template <typename TImage>
+unsigned int ImageGraphCutAdapter<TImage>::GetNumberOfLambdaLevels() const
+{
+  return this->GraphCut.GetNumberOfLambdaLevels();
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::SetLambdaLevel(const unsigned int level)
+{
+  this->GraphCut.SetLambdaLevel(level);
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::SetAbortFlag(const std::atomic<bool>* const abortFlag)
+{
+  this->GraphCut.SetAbortFlag(abortFlag);
+}
+
+template <typename TImage>
+bool ImageGraphCutAdapter<TImage>::GetAborted() const
+{
+  return this->GraphCut.GetAborted();
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::SetProgressCallback(const ProgressCallbackType& callback)
+{
+  this->GraphCut.SetProgressCallback(callback);
+}
+
+template <typename TImage>
+void ImageGraphCutAdapter<TImage>::SetTraceRecorder(TraceRecorder* const recorder)
+{
+  this->GraphCut.SetTraceRecorder(recorder);
+}
+
+template <typename TImage>
+std::size_t ImageGraphCutAdapter<TImage>::GetMemorySize() const
+{
+  return this->GraphCut.GetMemorySize();
+}
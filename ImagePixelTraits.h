@@ -0,0 +1,120 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Read the pixels of an image as a buffer of interleaved components, as the kernels that process a row of pixels at a
+ * time do (see WeightKernels).
+ *
+ * The images with fixed size pixels (itk::Image<unsigned char, N>, itk::Image<unsigned short, N>,
+ * itk::Image<itk::RGBPixel<unsigned char>, N>, ...) have their number of components in NumberOfComponents, so the
+ * loops over the components of a pixel are unrolled by the compiler. They also only take the memory of the file
+ * they were read from: an 8 bit RGB image has 3 bytes per pixel instead of the 12 of an itk::VectorImage<float, N>.
+ * The number of components of an itk::VectorImage is only known at runtime, so its NumberOfComponents is 0.
+ *
+ * Images of other pixel types have no buffer of components (HasComponentBuffer is false), and GetPixel() reads
+ * them through GetPixel() of the image.
+*/
+
+#ifndef ImagePixelTraits_H
+#define ImagePixelTraits_H
+
+// ITK
+#include <itkImage.h>
+#include <itkRGBPixel.h>
+#include <itkVectorImage.h>
+
+// STL
+#include <cstddef>
+#include <type_traits>
+
+template <typename TImage, typename TEnable = void>
+struct ImagePixelTraits
+{
+  static const bool HasComponentBuffer = false;
+  static const unsigned int NumberOfComponents = 0;
+
+  static unsigned int GetNumberOfComponents(const TImage* const image)
+  {
+    return image->GetNumberOfComponentsPerPixel();
+  }
+
+  /** Copy the components of the pixel at 'offset' (in buffer order) to 'pixel'. */
+  static void GetPixel(const TImage* const image, const std::size_t offset, float* const pixel)
+  {
+    typename TImage::PixelType imagePixel = image->GetPixel(image->ComputeIndex(offset));
+    for(unsigned int component = 0; component < image->GetNumberOfComponentsPerPixel(); ++component)
+      {
+      pixel[component] = imagePixel[component];
+      }
+  }
+};
+
+/** The images whose buffer is 'VNumberOfComponents' (0 if it is only known at runtime) interleaved components of
+ *  type TComponent per pixel. */
+template <typename TImage, typename TComponent, unsigned int VNumberOfComponents>
+struct ComponentBufferPixelTraits
+{
+  static const bool HasComponentBuffer = true;
+  static const unsigned int NumberOfComponents = VNumberOfComponents;
+  typedef TComponent ComponentType;
+
+  static unsigned int GetNumberOfComponents(const TImage* const image)
+  {
+    return (VNumberOfComponents > 0) ? VNumberOfComponents : image->GetNumberOfComponentsPerPixel();
+  }
+
+  static const TComponent* GetBuffer(const TImage* const image)
+  {
+    return reinterpret_cast<const TComponent*>(image->GetBufferPointer());
+  }
+
+  static TComponent* GetBuffer(TImage* const image)
+  {
+    return reinterpret_cast<TComponent*>(image->GetBufferPointer());
+  }
+
+  static void GetPixel(const TImage* const image, const std::size_t offset, float* const pixel)
+  {
+    const unsigned int numberOfComponents = GetNumberOfComponents(image);
+    const TComponent* const imagePixel = GetBuffer(image) + offset * numberOfComponents;
+    for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+      pixel[component] = imagePixel[component];
+      }
+  }
+};
+
+template <typename TComponent, unsigned int VDimension>
+struct ImagePixelTraits<itk::VectorImage<TComponent, VDimension> > :
+  public ComponentBufferPixelTraits<itk::VectorImage<TComponent, VDimension>, TComponent, 0>
+{
+};
+
+template <typename TComponent, unsigned int VDimension>
+struct ImagePixelTraits<itk::Image<TComponent, VDimension>,
+                        typename std::enable_if<std::is_arithmetic<TComponent>::value>::type> :
+  public ComponentBufferPixelTraits<itk::Image<TComponent, VDimension>, TComponent, 1>
+{
+};
+
+/** An RGBPixel is an array of its 3 components, so the buffer of the image is the interleaved components. */
+template <typename TComponent, unsigned int VDimension>
+struct ImagePixelTraits<itk::Image<itk::RGBPixel<TComponent>, VDimension> > :
+  public ComponentBufferPixelTraits<itk::Image<itk::RGBPixel<TComponent>, VDimension>, TComponent, 3>
+{
+};
+
+#endif
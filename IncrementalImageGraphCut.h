@@ -0,0 +1,421 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* This class has the same interface and energy as ImageGraphCut (from the ImageGraphCutSegmentation
+ * submodule), but it keeps the graph alive between calls to PerformSegmentation(). As long as the
+ * image does not change, a new cut only recomputes the t-weights (which depend on the seeds, lambda
+ * and the histograms) and continues the max-flow from the residual graph of the previous cut.
+ * The graph is a GridMaxFlowGraph, so there is no node per pixel object and no node id image.
+ *
+ * TImage may be an image or a volume. Volumes use a 6-connected graph and get a binary segment mask
+ * (see SegmentMaskTraits). The resolution pyramid is only implemented for images.
+ *
+ * The pixels of TImage are read from its buffer if ImagePixelTraits knows its pixel type, e.g. an
+ * itk::VectorImage<float, N> or an 8 bit itk::Image<itk::RGBPixel<unsigned char>, N>, which takes a quarter of the
+ * memory and whose number of components is a constant in the kernels.
+*/
+
+#ifndef IncrementalImageGraphCut_H
+#define IncrementalImageGraphCut_H
+
+// Custom
+#include "GridMaxFlowGraph.h"
+#include "ImagePixelTraits.h"
+#include "MaxFlowGraph.h"
+#include "RegionalCostTable.h"
+#include "SeedSet.h"
+#include "SegmentMaskTraits.h"
+#include "SLICSuperpixels.h"
+#include "TraceRecorder.h"
+
+// ITK
+#include <itkImage.h>
+
+// STL
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/** The types of IncrementalImageGraphCut that do not depend on the image, so that they are the same for every
+ *  TImage. */
+class IncrementalImageGraphCutBase
+{
+public:
+  enum ProgressPhase {CreatingGraph, CreatingHistograms, CreatingSuperpixels, ComputingMaxFlow};
+
+  /** Called during a cut with the phase and how far it is: 'done' of 'total' rows of the graph, 1 of 1
+   *  once the histograms are computed, 0 of 1 and 1 of 1 around the computation of the superpixels, and the
+   *  number of augmenting paths of the max-flow (whose total is not known, so 'total' is 0). It may be called
+   *  from the threads of the max-flow. */
+  typedef std::function<void(ProgressPhase phase, unsigned int done, unsigned int total)> ProgressCallbackType;
+
+  /** The seconds that the last full resolution PerformSegmentation() spent in each of its phases. A phase that
+   *  was skipped (e.g. the n-links of a graph that was reused) took 0 seconds. */
+  struct PhaseTimes
+  {
+    double NWeights;
+    double Histograms;
+    double TWeights;
+    double MaxFlow;
+    double SegmentMask;
+  };
+};
+
+template <typename TImage>
+class IncrementalImageGraphCut : public IncrementalImageGraphCutBase
+{
+public:
+  static const unsigned int Dimension = TImage::ImageDimension;
+
+  typedef itk::Index<Dimension> IndexType;
+  typedef GridMaxFlowGraph<Dimension> GraphType;
+  typedef SegmentMaskTraits<Dimension> MaskTraits;
+  typedef typename MaskTraits::MaskType MaskType;
+  typedef SeedSet<Dimension> SeedSetType;
+
+  IncrementalImageGraphCut();
+
+  /** Set the image to segment. This discards the graph of the previous image. */
+  void SetImage(TImage* const image);
+  TImage* GetImage();
+
+  /** The n-links of the graph of the image, Dimension weights per pixel in buffer order: to the next pixel along
+   *  each axis, 0 for the last pixel of an axis. Returns false if the graph has not been created since SetImage().
+   *  They are recovered from the residual graph (see GridMaxFlowGraph::GetEdgeWeight()). */
+  bool GetNWeights(std::vector<float>& weights) const;
+
+  /** Create the graph from the n-links that GetNWeights() returned for the same image (e.g. saved with a session)
+   *  instead of computing them. They are not checked, so they must be finite and not negative (SessionFile::Open()
+   *  rejects a session whose n-weights are not). */
+  void SetNWeights(const float* const weights);
+
+  /** Set the foreground/background seed pixels. Repeated pixels are only counted once, and a pixel that is
+   *  in both is a seed of the one that was set last. SetImage() removes all of the seeds. */
+  void SetSources(const std::vector<IndexType>& sources);
+  void SetSinks(const std::vector<IndexType>& sinks);
+
+  /** Set both kinds of seeds at once. 'seeds' must have the region of the image. */
+  void SetSeeds(const SeedSetType& seeds);
+
+  /** Set the weight of the regional term relative to the boundary term. */
+  void SetLambda(const float lambda);
+
+  /** Set the number of bins per dimension of the foreground and background histograms. It must be > 0, and
+   *  a cut throws if it exceeds RegionalCostTable::GetMaximumNumberOfHistogramBins() for the image's components. */
+  void SetNumberOfHistogramBins(const int bins);
+
+  /** If this is off, every cut computes the max-flow from zero (like ImageGraphCut). */
+  void SetIncremental(const bool incremental);
+  bool GetIncremental() const;
+
+  /** The number of threads used by the max-flow. The default is 1. */
+  void SetNumberOfThreads(const unsigned int numberOfThreads);
+
+  /** Cut on an image pyramid with this many levels (1, the default, cuts the full resolution image).
+   *  The coarsest level is cut as a whole. Every finer level only builds a graph for the pixels within
+   *  BandRadius of the upsampled boundary of the level below it; the other pixels keep the coarse label.
+   *  The size of the graphs then depends on the length of the boundary rather than on the number of pixels.
+   *  This is ignored for volumes. */
+  void SetNumberOfResolutionLevels(const unsigned int numberOfLevels);
+
+  /** The half width (in pixels of each level) of the band around the boundary. The default is 2. */
+  void SetBandRadius(const unsigned int radius);
+
+  /** Cut superpixels instead of pixels: the image is over-segmented (see SLICSuperpixels) into superpixels of
+   *  about size*size pixels, and the graph has one node per superpixel. Its t-links are the sums of the t-links of
+   *  its pixels, taken from a histogram of their bins, and the n-link between two superpixels is the sum of the
+   *  n-links between their pixels. The superpixels and their n-links only depend on the image, so they are computed
+   *  by the first cut after SetImage() and kept. 0, the default, cuts pixels. This is ignored for volumes. */
+  void SetSuperpixelSize(const unsigned int size);
+
+  /** See SLICSuperpixels::SetCompactness(). It is given in units of the noise of the image (the mean difference
+   *  of neighboring pixels), so that noise does not break up the superpixels. The default is 1.5. */
+  void SetSuperpixelCompactness(const float compactness);
+
+  /** If this is on (the default), the pixels within BandRadius of the boundary of the superpixel cut (and the seeds
+   *  that it got wrong) are cut again at full resolution, so the boundary does not have to follow the superpixels. */
+  void SetSuperpixelRefinement(const bool refinement);
+
+  /** Do the cut. The foreground pixels are the holes of the segment mask. */
+  void PerformSegmentation();
+
+  /** A fast approximation of PerformSegmentation(): cut only level 'level' of the image pyramid (as a multi-resolution
+   *  cut cuts its coarsest level), and upsample the result to the segment mask by repeating every pixel 2^level times
+   *  in each direction. The pyramid is kept until the next SetImage(), so only the first preview of an image pays for
+   *  downsampling it. The graph of the full resolution cut is not changed. This is ignored for volumes. */
+  void PerformPreviewSegmentation(const unsigned int level);
+
+  /** Get the result of the last cut. */
+  MaskType* GetSegmentMask();
+
+  /** Cut (at full resolution) with lambda = maximumLambda * level / numberOfLevels for every level in 1..numberOfLevels,
+   *  each solve continuing from the flow of the previous one. Afterwards SetLambdaLevel() shows the
+   *  result of any level without another max-flow. The segment mask is left at the last level. */
+  void PerformParametricSegmentation(const float maximumLambda, const unsigned int numberOfLevels);
+
+  /** The number of levels computed by the last PerformParametricSegmentation(), or 0 if
+   *  there was a regular cut since then. */
+  unsigned int GetNumberOfLambdaLevels() const;
+
+  /** Set the segment mask to the result of 'level' (1..GetNumberOfLambdaLevels()). The cost is
+   *  proportional to the number of pixels that change between the current and the new level. */
+  void SetLambdaLevel(const unsigned int level);
+
+  /** If 'abortFlag' is not null, a cut checks it regularly and stops early once it is true. The segment mask
+   *  and the lambda levels then keep the result of the previous cut. The flow that the max-flow had already
+   *  pushed is kept, so the next cut continues from it. */
+  void SetAbortFlag(const std::atomic<bool>* const abortFlag);
+
+  /** True if the last cut was stopped by the abort flag. */
+  bool GetAborted() const;
+
+  /** See IncrementalImageGraphCutBase::ProgressCallbackType. */
+  void SetProgressCallback(const ProgressCallbackType& callback);
+
+  /** See IncrementalImageGraphCutBase::PhaseTimes. */
+  const PhaseTimes& GetPhaseTimes() const;
+
+  /** The bytes taken by the image and by what the cuts keep of it: the graph, the bin indices, the pyramid, the
+   *  superpixels and the segment mask. */
+  std::size_t GetMemorySize() const;
+
+  /** If 'recorder' is not null, the cuts record timers for their phases and the counters GraphNodes, GraphEdges,
+   *  AugmentingPaths, OrphanAdoptions and BytesAllocated (of the graphs, the bin indices and the pyramid) in it.
+   *  The recorder must outlive the cuts. */
+  void SetTraceRecorder(TraceRecorder* const recorder);
+
+protected:
+
+  /** Set the n-links of the graph to the boundary term of every pair of neighboring pixels. */
+  void CreateNWeights();
+
+  /** The pixels of images with a buffer of components (std::true_type, see ImagePixelTraits) are read from the
+   *  buffer a row at a time by the WeightKernels, with the number of components of PixelTraits. Other images go
+   *  through the iterators. */
+  typedef ImagePixelTraits<TImage> PixelTraits;
+  typedef std::integral_constant<bool, PixelTraits::HasComponentBuffer> HasComponentBuffer;
+  void CreateNWeights(const float sigma, std::true_type);
+  void CreateNWeights(const float sigma, std::false_type);
+  float ComputeNoise(std::true_type);
+  float ComputeNoise(std::false_type);
+  void CreateBinIndices(std::true_type);
+  void CreateBinIndices(std::false_type);
+
+  /** The number of pixels of row 'row' (the rows of the buffer, along the first dimension) that have a
+   *  neighbor in the positive direction of 'dimension', and the offset of that neighbor in pixels. */
+  unsigned int GetRowNeighbors(const unsigned int row, const unsigned int dimension, std::size_t& neighborOffset) const;
+
+  /** Create the grid graph of the image, with its n-links. */
+  void CreateGraph();
+
+  /** Report that 'row' of 'numberOfRows' rows of n-links are done (every 64 rows). Returns true, and sets
+   *  Aborted, if the cut should stop. */
+  bool UpdateGraphProgress(const unsigned int row, const unsigned int numberOfRows);
+
+  void ReportProgress(const ProgressPhase phase, const unsigned int done, const unsigned int total);
+
+  /** Stop the max-flow of 'graph' with AbortFlag and report its progress. */
+  template <typename TGraph>
+  void ConnectMaxFlow(TGraph& graph);
+
+  /** Run graph.MaxFlow(), and record its time and counters if there is a TraceRecorder. */
+  template <typename TGraph>
+  void ComputeMaxFlow(TGraph& graph);
+
+  /** Add the nodes, edges and memory of a graph that was just created to the counters of the TraceRecorder. */
+  template <typename TGraph>
+  void RecordGraph(const TGraph& graph);
+
+  void RecordAllocation(const std::size_t bytes);
+
+  /** The histogram bin of a pixel (anything with operator[] over its components). */
+  template <typename TPixel>
+  unsigned int ComputeBinIndex(const TPixel& pixel) const;
+
+  /** Quantize every pixel into its histogram bin. */
+  void CreateBinIndices();
+
+  /** The bin of every pixel of 'pixels'. */
+  void ComputeBins(const std::vector<IndexType>& pixels, std::vector<unsigned int>& bins);
+
+  /** Compute the histograms of the source and sink pixels, as the lists of their bins. */
+  void CreateHistograms();
+
+  /** Compute the -log probability of every bin under the background and foreground histograms into RegionalCosts. */
+  void CreateRegionalCosts();
+
+  /** Set the t-links of every node from RegionalCosts and the seeds. */
+  void CreateTWeights(const float lambda);
+
+  /** Estimate the "camera noise" (sigma of the boundary term) as the mean difference of neighboring pixels.
+   *  It only depends on the image, so it is computed once per image and kept in Noise. */
+  float GetNoise();
+
+  /** The euclidean distance between two pixels. */
+  template <typename TPixel>
+  float PixelDifference(const TPixel& a, const TPixel& b) const;
+
+  /** The node of a pixel is its offset in the image buffer. */
+  typename GraphType::NodeId GetNodeId(const IndexType& index) const;
+
+  /** Copy the labels of the graph into the segment mask. */
+  void CreateSegmentMask();
+
+  /** PerformSegmentation() with more than one resolution level. The pyramid functions below are only
+   *  instantiated for images (std::true_type); a volume is never passed here. */
+  void PerformMultiResolutionSegmentation(std::true_type);
+  void PerformMultiResolutionSegmentation(std::false_type) {}
+
+  void PerformPreviewSegmentation(const unsigned int level, std::true_type);
+  void PerformPreviewSegmentation(const unsigned int, std::false_type) {}
+
+  /** PerformSegmentation() with superpixels. */
+  void PerformSuperpixelSegmentation(std::true_type);
+  void PerformSuperpixelSegmentation(std::false_type) {}
+
+  /** Compute the superpixels of Image and the n-links between them. */
+  void CreateSuperpixels();
+
+  /** Compute SuperpixelBins from BinIndices. */
+  void CreateSuperpixelBins();
+
+  /** Create the levels of the pyramid up to numberOfLevels - 1 that do not exist yet. */
+  void CreatePyramid(const unsigned int numberOfLevels);
+
+  /** Set the segment mask from the ForegroundLabel bits of 'labels', the labels of pyramid level 'level'. */
+  void CreateSegmentMask(const unsigned int level, const std::vector<unsigned char>& labels);
+
+  /** Copy the components of the pixel at 'offset' in pyramid level 'level' into 'pixel'. Level 0 is read from
+   *  Image. */
+  void GetPyramidPixel(const unsigned int level, const std::size_t offset, float* const pixel) const;
+
+  /** The offset in pyramid level 'level' of the pixel that contains 'index' (of the full resolution image). */
+  std::size_t GetPyramidOffset(const unsigned int level, const itk::Index<2>& index) const;
+
+  /** GetNoise() for a level of the pyramid. CreatePyramid() stores it as the Noise of the level. */
+  float ComputePyramidNoise(const unsigned int level);
+
+  /** Mark the pixels of 'labels' that are near a boundary (or on a seed that disagrees with its label) with
+   *  BandLabel, and list their offsets in 'band' in increasing order. 'labels' has one byte per pixel of the level,
+   *  so at level 0 it is as large as an 8 bit gray image. */
+  void CreateBand(const unsigned int level, std::vector<unsigned char>& labels, std::vector<std::size_t>& band);
+
+  /** Cut the pixels of 'band', with the other pixels of 'labels' fixed, and write the result into 'labels'. The nodes
+   *  of the band are still int ids of a MaxFlowGraph, so the band (not the level) must have less than 2^31 pixels. */
+  void SegmentBand(const unsigned int level, std::vector<unsigned char>& labels, const std::vector<std::size_t>& band);
+
+  /** The bits of the per-pixel labels of the multi-resolution cut. */
+  static const unsigned char ForegroundLabel = 1;
+  static const unsigned char BandLabel = 2;
+
+  typename TImage::Pointer Image;
+  typename MaskType::Pointer SegmentMask;
+
+  SeedSetType Seeds;
+
+  float Lambda;
+  int NumberOfHistogramBins;
+  bool Incremental;
+
+  unsigned int NumberOfResolutionLevels;
+  unsigned int BandRadius;
+
+  /** The n-links of Image and the residual flow of the last cut. */
+  GraphType Graph;
+
+  /** True if Graph holds the n-links of Image. The graph is only created by full resolution cuts. */
+  bool GraphIsCurrent;
+
+  /** The histogram bin of every node. The bin of a pixel is sum(bin_c * NumberOfHistogramBins^c) over its components c. */
+  std::vector<unsigned int> BinIndices;
+
+  /** The number of bins per unit of each component. */
+  std::vector<float> BinScale;
+
+  /** The NumberOfHistogramBins that BinIndices was computed with (0 if it has not been computed for this image). */
+  int BinIndicesNumberOfHistogramBins;
+
+  /** The bin of every source and sink seed. */
+  std::vector<unsigned int> SourceBins;
+  std::vector<unsigned int> SinkBins;
+
+  /** The t-link weights of a pixel in each bin, before they are multiplied by lambda. */
+  RegionalCostTable RegionalCosts;
+
+  /** The nodes whose label changes between level-1 and level of the last lambda sweep. */
+  std::vector<std::vector<typename GraphType::NodeId> > LevelFlips;
+
+  /** The level that the segment mask currently shows. */
+  unsigned int LambdaLevel;
+
+  const std::atomic<bool>* AbortFlag;
+  bool Aborted;
+  ProgressCallbackType ProgressCallback;
+
+  PhaseTimes Times;
+
+  TraceRecorder* Trace;
+
+  /** The sigma of the boundary term of Image, if NoiseIsCurrent. */
+  float Noise;
+  bool NoiseIsCurrent;
+
+  /** The per-component range of the image, used as the histogram range. */
+  std::vector<float> ImageMinimum;
+  std::vector<float> ImageMaximum;
+
+  struct PyramidLevel
+  {
+    itk::Size<2> Size;
+
+    /** The components of every pixel, averaged over 2x2 pixels of the level below. Empty for level 0 (Image itself). */
+    std::vector<float> Pixels;
+
+    /** The sigma of the n-links of this level, so that a banded cut does not scan the level again. */
+    float Noise;
+  };
+
+  /** Level l is Image downsampled by 2^l. Only the levels that a cut needed have been created. */
+  std::vector<PyramidLevel> Pyramid;
+
+  unsigned int SuperpixelSize;
+  float SuperpixelCompactness;
+  bool SuperpixelRefinement;
+
+  /** The superpixels of Image, if SuperpixelsAreCurrent. */
+  SLICSuperpixels<TImage> Superpixels;
+  bool SuperpixelsAreCurrent;
+
+  /** The pairs of adjacent superpixels (the smaller one first), and the sum of the n-links between their pixels. */
+  std::vector<std::pair<unsigned int, unsigned int> > SuperpixelEdges;
+  std::vector<float> SuperpixelEdgeWeights;
+
+  /** The (bin, number of pixels) of the pixels of superpixel s, for the bins that they fall into, are
+   *  SuperpixelBins[SuperpixelBinOffsets[s]] to SuperpixelBins[SuperpixelBinOffsets[s + 1] - 1]. */
+  std::vector<unsigned int> SuperpixelBinOffsets;
+  std::vector<std::pair<unsigned int, unsigned int> > SuperpixelBins;
+
+  /** The NumberOfHistogramBins that SuperpixelBins was computed with (0 if it is out of date). */
+  int SuperpixelBinsNumberOfHistogramBins;
+};
+
+#include "IncrementalImageGraphCut.hpp"
+
+#endif
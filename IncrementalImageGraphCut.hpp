@@ -0,0 +1,1625 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IncrementalImageGraphCut_HPP
+#define IncrementalImageGraphCut_HPP
+
+#include "IncrementalImageGraphCut.h" // Appease syntax parser
+
+// Custom
+#include "WeightKernels.h"
+
+// ITK
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+template <typename TImage>
+const unsigned int IncrementalImageGraphCut<TImage>::Dimension;
+
+template <typename TImage>
+const unsigned char IncrementalImageGraphCut<TImage>::ForegroundLabel;
+
+template <typename TImage>
+const unsigned char IncrementalImageGraphCut<TImage>::BandLabel;
+
+template <typename TImage>
+IncrementalImageGraphCut<TImage>::IncrementalImageGraphCut() :
+  Lambda(0.01), NumberOfHistogramBins(10), Incremental(true), NumberOfResolutionLevels(1), BandRadius(2),
+  GraphIsCurrent(false), BinIndicesNumberOfHistogramBins(0), LambdaLevel(0), AbortFlag(nullptr),
+  Aborted(false), Trace(nullptr), Noise(1.0f), NoiseIsCurrent(false), SuperpixelSize(0), SuperpixelCompactness(1.5f),
+  SuperpixelRefinement(true), SuperpixelsAreCurrent(false), SuperpixelBinsNumberOfHistogramBins(0)
+{
+  this->SegmentMask = MaskType::New();
+  this->Times = PhaseTimes();
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetImage(TImage* const image)
+{
+  this->Image = image;
+  this->GraphIsCurrent = false;
+  this->NoiseIsCurrent = false;
+  this->Pyramid.clear();
+  this->BinIndicesNumberOfHistogramBins = 0;
+  this->SuperpixelsAreCurrent = false;
+  this->SuperpixelBinsNumberOfHistogramBins = 0;
+
+  // Compute the range of each component for the histograms
+  unsigned int numberOfComponents = image->GetNumberOfComponentsPerPixel();
+  this->ImageMinimum.assign(numberOfComponents, std::numeric_limits<float>::max());
+  this->ImageMaximum.assign(numberOfComponents, -std::numeric_limits<float>::max());
+
+  std::vector<float> pixel(numberOfComponents);
+  const std::size_t numberOfPixels = image->GetLargestPossibleRegion().GetNumberOfPixels();
+  for(std::size_t offset = 0; offset < numberOfPixels; ++offset)
+    {
+    PixelTraits::GetPixel(image, offset, &pixel[0]);
+    for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+      this->ImageMinimum[component] = std::min(this->ImageMinimum[component], pixel[component]);
+      this->ImageMaximum[component] = std::max(this->ImageMaximum[component], pixel[component]);
+      }
+    }
+
+  this->Seeds.SetRegion(image->GetLargestPossibleRegion());
+
+  this->SegmentMask->SetRegions(image->GetLargestPossibleRegion());
+  this->SegmentMask->Allocate();
+  this->SegmentMask->FillBuffer(MaskTraits::GetValidValue(this->SegmentMask));
+
+}
+
+template <typename TImage>
+TImage* IncrementalImageGraphCut<TImage>::GetImage()
+{
+  return this->Image;
+}
+
+template <typename TImage>
+bool IncrementalImageGraphCut<TImage>::GetNWeights(std::vector<float>& weights) const
+{
+  if(!this->GraphIsCurrent)
+    {
+    return false;
+    }
+
+  const itk::Size<Dimension> size = this->Image->GetLargestPossibleRegion().GetSize();
+  weights.assign(static_cast<std::size_t>(this->Graph.GetNumberOfNodes()) * Dimension, 0.0f);
+
+  // Step through the coordinates of the nodes, as the pixels on the far border of an axis have no edge along it
+  unsigned int coordinates[Dimension] = {0};
+  for(unsigned int node = 0; node < this->Graph.GetNumberOfNodes(); ++node)
+    {
+    for(unsigned int dimension = 0; dimension < Dimension; ++dimension)
+      {
+      if(coordinates[dimension] + 1 < size[dimension])
+        {
+        weights[node * Dimension + dimension] =
+          this->Graph.GetEdgeWeight(node, static_cast<typename GraphType::Direction>(2 * dimension));
+        }
+      }
+    for(unsigned int dimension = 0; dimension < Dimension; ++dimension)
+      {
+      if(++coordinates[dimension] < size[dimension])
+        {
+        break;
+        }
+      coordinates[dimension] = 0;
+      }
+    }
+  return true;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetNWeights(const float* const weights)
+{
+  itk::Size<Dimension> size = this->Image->GetLargestPossibleRegion().GetSize();
+  unsigned int gridSize[3] = {1, 1, 1};
+  for(unsigned int dimension = 0; dimension < Dimension; ++dimension)
+    {
+    gridSize[dimension] = size[dimension];
+    }
+  this->Graph.Reset(gridSize[0], gridSize[1], gridSize[2]);
+  RecordGraph(this->Graph);
+
+  // The weights of the border pixels along their axis are 0, which is what Reset() left them at
+  unsigned int coordinates[Dimension] = {0};
+  for(unsigned int node = 0; node < this->Graph.GetNumberOfNodes(); ++node)
+    {
+    for(unsigned int dimension = 0; dimension < Dimension; ++dimension)
+      {
+      if(coordinates[dimension] + 1 < size[dimension])
+        {
+        this->Graph.SetEdgeWeight(node, static_cast<typename GraphType::Direction>(2 * dimension),
+                                  weights[node * Dimension + dimension]);
+        }
+      }
+    for(unsigned int dimension = 0; dimension < Dimension; ++dimension)
+      {
+      if(++coordinates[dimension] < size[dimension])
+        {
+        break;
+        }
+      coordinates[dimension] = 0;
+      }
+    }
+  this->GraphIsCurrent = true;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetSources(const std::vector<IndexType>& sources)
+{
+  this->Seeds.Clear(SeedSetType::Source);
+  this->Seeds.Add(sources, SeedSetType::Source);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetSinks(const std::vector<IndexType>& sinks)
+{
+  this->Seeds.Clear(SeedSetType::Sink);
+  this->Seeds.Add(sinks, SeedSetType::Sink);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetSeeds(const SeedSetType& seeds)
+{
+  this->Seeds = seeds;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetLambda(const float lambda)
+{
+  this->Lambda = lambda;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetNumberOfHistogramBins(const int bins)
+{
+  if(bins <= 0)
+    {
+    itkGenericExceptionMacro(<< "The number of histogram bins must be > 0, not " << bins);
+    }
+  this->NumberOfHistogramBins = bins;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetIncremental(const bool incremental)
+{
+  this->Incremental = incremental;
+}
+
+template <typename TImage>
+bool IncrementalImageGraphCut<TImage>::GetIncremental() const
+{
+  return this->Incremental;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetAbortFlag(const std::atomic<bool>* const abortFlag)
+{
+  this->AbortFlag = abortFlag;
+  ConnectMaxFlow(this->Graph);
+}
+
+template <typename TImage>
+bool IncrementalImageGraphCut<TImage>::GetAborted() const
+{
+  return this->Aborted;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetProgressCallback(const ProgressCallbackType& callback)
+{
+  this->ProgressCallback = callback;
+  ConnectMaxFlow(this->Graph);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::ReportProgress(const ProgressPhase phase, const unsigned int done,
+                                                      const unsigned int total)
+{
+  if(this->ProgressCallback)
+    {
+    this->ProgressCallback(phase, done, total);
+    }
+}
+
+template <typename TImage>
+template <typename TGraph>
+void IncrementalImageGraphCut<TImage>::ConnectMaxFlow(TGraph& graph)
+{
+  graph.SetAbortFlag(this->AbortFlag);
+  if(this->ProgressCallback)
+    {
+    graph.SetProgressCallback([this](unsigned int numberOfAugmentations)
+      {
+      this->ProgressCallback(ComputingMaxFlow, numberOfAugmentations, 0);
+      });
+    }
+  else
+    {
+    graph.SetProgressCallback(typename TGraph::ProgressCallbackType());
+    }
+}
+
+template <typename TImage>
+template <typename TGraph>
+void IncrementalImageGraphCut<TImage>::ComputeMaxFlow(TGraph& graph)
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "MaxFlow");
+  graph.MaxFlow();
+  if(this->Trace)
+    {
+    this->Trace->AddToCounter("AugmentingPaths", graph.GetNumberOfAugmentations());
+    this->Trace->AddToCounter("OrphanAdoptions", graph.GetNumberOfOrphans());
+    }
+}
+
+template <typename TImage>
+template <typename TGraph>
+void IncrementalImageGraphCut<TImage>::RecordGraph(const TGraph& graph)
+{
+  if(this->Trace)
+    {
+    this->Trace->AddToCounter("GraphNodes", graph.GetNumberOfNodes());
+    this->Trace->AddToCounter("GraphEdges", graph.GetNumberOfEdges());
+    this->Trace->AddToCounter("BytesAllocated", graph.GetMemorySize());
+    }
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::RecordAllocation(const std::size_t bytes)
+{
+  if(this->Trace)
+    {
+    this->Trace->AddToCounter("BytesAllocated", bytes);
+    }
+}
+
+template <typename TImage>
+bool IncrementalImageGraphCut<TImage>::UpdateGraphProgress(const unsigned int row, const unsigned int numberOfRows)
+{
+  if(row % 64 != 0)
+    {
+    return false;
+    }
+
+  if(this->AbortFlag && *this->AbortFlag)
+    {
+    this->Aborted = true;
+    return true;
+    }
+
+  ReportProgress(CreatingGraph, row, numberOfRows);
+  return false;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetNumberOfThreads(const unsigned int numberOfThreads)
+{
+  this->Graph.SetNumberOfThreads(numberOfThreads);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetNumberOfResolutionLevels(const unsigned int numberOfLevels)
+{
+  this->NumberOfResolutionLevels = std::max(numberOfLevels, 1u);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetBandRadius(const unsigned int radius)
+{
+  this->BandRadius = radius;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetSuperpixelSize(const unsigned int size)
+{
+  if(size != this->SuperpixelSize)
+    {
+    this->SuperpixelSize = size;
+    this->SuperpixelsAreCurrent = false;
+    }
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetSuperpixelCompactness(const float compactness)
+{
+  if(compactness != this->SuperpixelCompactness)
+    {
+    this->SuperpixelCompactness = compactness;
+    this->SuperpixelsAreCurrent = false;
+    }
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetSuperpixelRefinement(const bool refinement)
+{
+  this->SuperpixelRefinement = refinement;
+}
+
+template <typename TImage>
+typename IncrementalImageGraphCut<TImage>::MaskType* IncrementalImageGraphCut<TImage>::GetSegmentMask()
+{
+  return this->SegmentMask;
+}
+
+template <typename TImage>
+typename IncrementalImageGraphCut<TImage>::GraphType::NodeId
+IncrementalImageGraphCut<TImage>::GetNodeId(const IndexType& index) const
+{
+  return this->Image->ComputeOffset(index);
+}
+
+template <typename TImage>
+const typename IncrementalImageGraphCut<TImage>::PhaseTimes& IncrementalImageGraphCut<TImage>::GetPhaseTimes() const
+{
+  return this->Times;
+}
+
+template <typename TImage>
+std::size_t IncrementalImageGraphCut<TImage>::GetMemorySize() const
+{
+  std::size_t memorySize = 0;
+  if(this->Image.IsNotNull())
+    {
+    memorySize += this->Image->GetPixelContainer()->Size() * sizeof(typename TImage::InternalPixelType);
+    memorySize += this->Image->GetLargestPossibleRegion().GetNumberOfPixels(); // The segment mask
+    }
+
+  memorySize += this->Graph.GetMemorySize();
+  memorySize += this->BinIndices.capacity() * sizeof(unsigned int);
+  for(unsigned int level = 0; level < this->Pyramid.size(); ++level)
+    {
+    memorySize += this->Pyramid[level].Pixels.capacity() * sizeof(float);
+    }
+
+  if(this->SuperpixelsAreCurrent)
+    {
+    memorySize += this->Superpixels.GetLabels().capacity() * sizeof(unsigned int);
+    }
+  memorySize += this->SuperpixelEdges.capacity() * sizeof(std::pair<unsigned int, unsigned int>);
+  memorySize += this->SuperpixelEdgeWeights.capacity() * sizeof(float);
+  memorySize += this->SuperpixelBinOffsets.capacity() * sizeof(unsigned int);
+  memorySize += this->SuperpixelBins.capacity() * sizeof(std::pair<unsigned int, unsigned int>);
+  return memorySize;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetTraceRecorder(TraceRecorder* const recorder)
+{
+  this->Trace = recorder;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::PerformSegmentation()
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "PerformSegmentation");
+  this->Aborted = false;
+
+  // Only images have superpixels and a pyramid, volumes are always cut at full resolution
+  if(this->SuperpixelSize > 0 && Dimension == 2)
+    {
+    PerformSuperpixelSegmentation(std::integral_constant<bool, Dimension == 2>());
+    return;
+    }
+
+  if(this->NumberOfResolutionLevels > 1 && Dimension == 2)
+    {
+    PerformMultiResolutionSegmentation(std::integral_constant<bool, Dimension == 2>());
+    return;
+    }
+
+  typedef std::chrono::steady_clock ClockType;
+  this->Times = PhaseTimes();
+  ClockType::time_point start = ClockType::now();
+
+  // The n-links only depend on the image, so the graph (and the flow that has already been
+  // pushed through it) can be reused. Only the t-links are updated for the new seeds/lambda/bins.
+  if(!this->GraphIsCurrent)
+    {
+    CreateGraph();
+    if(this->Aborted)
+      {
+      return;
+      }
+    }
+  else if(!this->Incremental)
+    {
+    this->Graph.ResetFlow();
+    }
+  ClockType::time_point end = ClockType::now();
+  this->Times.NWeights = std::chrono::duration<double>(end - start).count();
+  start = end;
+
+  CreateHistograms();
+  CreateRegionalCosts();
+  if(this->BinIndicesNumberOfHistogramBins != this->NumberOfHistogramBins)
+    {
+    CreateBinIndices();
+    }
+  ReportProgress(CreatingHistograms, 1, 1);
+  end = ClockType::now();
+  this->Times.Histograms = std::chrono::duration<double>(end - start).count();
+  start = end;
+
+  CreateTWeights(this->Lambda);
+  end = ClockType::now();
+  this->Times.TWeights = std::chrono::duration<double>(end - start).count();
+  start = end;
+
+  ComputeMaxFlow(this->Graph);
+  if(this->Graph.GetAborted())
+    {
+    this->Aborted = true;
+    return;
+    }
+  end = ClockType::now();
+  this->Times.MaxFlow = std::chrono::duration<double>(end - start).count();
+  start = end;
+
+  // A single cut invalidates the results of a lambda sweep
+  this->LevelFlips.clear();
+
+  CreateSegmentMask();
+  this->Times.SegmentMask = std::chrono::duration<double>(ClockType::now() - start).count();
+}
+
+template <typename TImage>
+template <typename TPixel>
+float IncrementalImageGraphCut<TImage>::PixelDifference(const TPixel& a, const TPixel& b) const
+{
+  float difference = 0;
+  for(unsigned int component = 0; component < this->Image->GetNumberOfComponentsPerPixel(); ++component)
+    {
+    float componentDifference = static_cast<float>(a[component]) - static_cast<float>(b[component]);
+    difference += componentDifference * componentDifference;
+    }
+  return sqrt(difference);
+}
+
+template <typename TImage>
+float IncrementalImageGraphCut<TImage>::GetNoise()
+{
+  if(!this->NoiseIsCurrent)
+    {
+    this->Noise = ComputeNoise(HasComponentBuffer());
+    this->NoiseIsCurrent = true;
+    }
+  return this->Noise;
+}
+
+template <typename TImage>
+unsigned int IncrementalImageGraphCut<TImage>::GetRowNeighbors(const unsigned int row, const unsigned int dimension,
+                                                               std::size_t& neighborOffset) const
+{
+  const itk::Size<Dimension> size = this->Image->GetLargestPossibleRegion().GetSize();
+
+  // 'row' counts the rows over all the other dimensions, so its coordinate in 'dimension' is a digit of it
+  neighborOffset = 1;
+  unsigned int coordinate = row;
+  for(unsigned int d = 0; d < dimension; ++d)
+    {
+    neighborOffset *= size[d];
+    if(d > 0)
+      {
+      coordinate /= size[d];
+      }
+    }
+
+  if(dimension == 0)
+    {
+    return size[0] - 1;
+    }
+
+  return (coordinate % size[dimension] + 1 < size[dimension]) ? size[0] : 0;
+}
+
+template <typename TImage>
+float IncrementalImageGraphCut<TImage>::ComputeNoise(std::true_type)
+{
+  const unsigned int numberOfComponents = this->Image->GetNumberOfComponentsPerPixel();
+  const unsigned int width = this->Image->GetLargestPossibleRegion().GetSize()[0];
+  const unsigned int numberOfRows = this->Image->GetLargestPossibleRegion().GetNumberOfPixels() / width;
+  const typename PixelTraits::ComponentType* const buffer = PixelTraits::GetBuffer(this->Image.GetPointer());
+
+  double sum = 0;
+  unsigned int numberOfDifferences = 0;
+  for(unsigned int row = 0; row < numberOfRows; ++row)
+    {
+    const typename PixelTraits::ComponentType* pixels =
+      buffer + static_cast<std::size_t>(row) * width * numberOfComponents;
+    for(unsigned int dimension = 0; dimension < Dimension; ++dimension)
+      {
+      std::size_t neighborOffset;
+      unsigned int count = GetRowNeighbors(row, dimension, neighborOffset);
+      sum += WeightKernels::SumPixelDifferences<PixelTraits::NumberOfComponents>(
+               pixels, pixels + neighborOffset * numberOfComponents, count, numberOfComponents);
+      numberOfDifferences += count;
+      }
+    }
+
+  if(numberOfDifferences == 0 || sum == 0)
+    {
+    return 1.0f;
+    }
+
+  return sum / static_cast<double>(numberOfDifferences);
+}
+
+template <typename TImage>
+float IncrementalImageGraphCut<TImage>::ComputeNoise(std::false_type)
+{
+  // Since we use a 4 (6 for a volume) connected neighborhood, we only need to look at each pixel's
+  // right and bottom (and next slice) neighbors.
+  itk::ImageRegion<Dimension> region = this->Image->GetLargestPossibleRegion();
+
+  double sum = 0;
+  unsigned int numberOfDifferences = 0;
+
+  itk::ImageRegionConstIteratorWithIndex<TImage> imageIterator(this->Image, region);
+  while(!imageIterator.IsAtEnd())
+    {
+    IndexType index = imageIterator.GetIndex();
+    for(unsigned int dimension = 0; dimension < Dimension; ++dimension)
+      {
+      IndexType neighbor = index;
+      neighbor[dimension]++;
+      if(region.IsInside(neighbor))
+        {
+        sum += PixelDifference(imageIterator.Get(), this->Image->GetPixel(neighbor));
+        numberOfDifferences++;
+        }
+      }
+    ++imageIterator;
+    }
+
+  if(numberOfDifferences == 0 || sum == 0)
+    {
+    return 1.0f;
+    }
+
+  return sum / static_cast<double>(numberOfDifferences);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateNWeights()
+{
+  CreateNWeights(GetNoise(), HasComponentBuffer());
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateNWeights(const float sigma, std::true_type)
+{
+  const unsigned int numberOfComponents = this->Image->GetNumberOfComponentsPerPixel();
+  const unsigned int width = this->Image->GetLargestPossibleRegion().GetSize()[0];
+  const unsigned int numberOfRows = this->Image->GetLargestPossibleRegion().GetNumberOfPixels() / width;
+  const typename PixelTraits::ComponentType* const buffer = PixelTraits::GetBuffer(this->Image.GetPointer());
+
+  // exp(-d^2 / (2 sigma^2)) of the euclidean distance d, as in the iterator version
+  const float scale = 1.0f / (2.0f * sigma * sigma);
+
+  std::vector<float> weights(width);
+  for(unsigned int row = 0; row < numberOfRows; ++row)
+    {
+    if(UpdateGraphProgress(row, numberOfRows))
+      {
+      return;
+      }
+
+    const typename GraphType::NodeId firstNode = row * width;
+    const typename PixelTraits::ComponentType* pixels =
+      buffer + static_cast<std::size_t>(row) * width * numberOfComponents;
+    for(unsigned int dimension = 0; dimension < Dimension; ++dimension)
+      {
+      std::size_t neighborOffset;
+      unsigned int count = GetRowNeighbors(row, dimension, neighborOffset);
+      WeightKernels::ComputeNWeights<PixelTraits::NumberOfComponents>(
+        pixels, pixels + neighborOffset * numberOfComponents, count, numberOfComponents, scale, &weights[0]);
+      for(unsigned int i = 0; i < count; ++i)
+        {
+        this->Graph.SetEdgeWeight(firstNode + i, static_cast<typename GraphType::Direction>(2 * dimension), weights[i]);
+        }
+      }
+    }
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateNWeights(const float sigma, std::false_type)
+{
+  itk::ImageRegion<Dimension> region = this->Image->GetLargestPossibleRegion();
+
+  // Each pixel sets the n-link to its neighbor in the positive direction (2*dimension) of every dimension:
+  // right, bottom (and next slice). Pixels on those borders have no neighbor there, so their weight stays 0.
+  const unsigned int numberOfRows = region.GetNumberOfPixels() / region.GetSize()[0];
+  itk::ImageRegionConstIteratorWithIndex<TImage> imageIterator(this->Image, region);
+  while(!imageIterator.IsAtEnd())
+    {
+    IndexType index = imageIterator.GetIndex();
+    if(index[0] == region.GetIndex()[0] && UpdateGraphProgress(GetNodeId(index) / region.GetSize()[0], numberOfRows))
+      {
+      return;
+      }
+
+    for(unsigned int dimension = 0; dimension < Dimension; ++dimension)
+      {
+      IndexType neighbor = index;
+      neighbor[dimension]++;
+      if(!region.IsInside(neighbor))
+        {
+        continue;
+        }
+      float pixelDifference = PixelDifference(imageIterator.Get(), this->Image->GetPixel(neighbor));
+      this->Graph.SetEdgeWeight(GetNodeId(index), static_cast<typename GraphType::Direction>(2 * dimension),
+                                exp(-pow(pixelDifference,2)/(2.0*sigma*sigma)));
+      }
+    ++imageIterator;
+    }
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateGraph()
+{
+  // The boundary term only depends on the image, so the n-links are created once and reused by every cut
+  itk::Size<Dimension> size = this->Image->GetLargestPossibleRegion().GetSize();
+  unsigned int gridSize[3] = {1, 1, 1};
+  for(unsigned int dimension = 0; dimension < Dimension; ++dimension)
+    {
+    gridSize[dimension] = size[dimension];
+    }
+  TraceRecorder::ScopedTimer timer(this->Trace, "CreateGraph");
+  this->Graph.Reset(gridSize[0], gridSize[1], gridSize[2]);
+  RecordGraph(this->Graph);
+  CreateNWeights();
+
+  // A graph that was only partly created is created again by the next cut
+  this->GraphIsCurrent = !this->Aborted;
+}
+
+template <typename TImage>
+template <typename TPixel>
+unsigned int IncrementalImageGraphCut<TImage>::ComputeBinIndex(const TPixel& pixel) const
+{
+  // The maximum of a component lands exactly on NumberOfHistogramBins, so it is clamped into the last bin
+  unsigned int binIndex = 0;
+  unsigned int stride = 1;
+  for(unsigned int component = 0; component < this->BinScale.size(); ++component)
+    {
+    int bin = static_cast<int>((pixel[component] - this->ImageMinimum[component]) * this->BinScale[component]);
+    bin = std::max(0, std::min(bin, this->NumberOfHistogramBins - 1));
+    binIndex += bin * stride;
+    stride *= this->NumberOfHistogramBins;
+    }
+  return binIndex;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateBinIndices()
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "CreateBinIndices");
+  this->BinIndices.resize(this->Image->GetLargestPossibleRegion().GetNumberOfPixels());
+  RecordAllocation(this->BinIndices.size() * sizeof(unsigned int));
+  CreateBinIndices(HasComponentBuffer());
+  this->BinIndicesNumberOfHistogramBins = this->NumberOfHistogramBins;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateBinIndices(std::true_type)
+{
+  WeightKernels::ComputeBinIndices<PixelTraits::NumberOfComponents>(
+    PixelTraits::GetBuffer(this->Image.GetPointer()), this->BinIndices.size(),
+    this->Image->GetNumberOfComponentsPerPixel(), &this->ImageMinimum[0], &this->BinScale[0],
+    this->NumberOfHistogramBins, &this->BinIndices[0]);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateBinIndices(std::false_type)
+{
+  itk::ImageRegion<Dimension> region = this->Image->GetLargestPossibleRegion();
+
+  // The iterator visits the pixels in buffer order, which is also node order
+  unsigned int node = 0;
+  itk::ImageRegionConstIterator<TImage> imageIterator(this->Image, region);
+  while(!imageIterator.IsAtEnd())
+    {
+    this->BinIndices[node++] = ComputeBinIndex(imageIterator.Get());
+    ++imageIterator;
+    }
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::ComputeBins(const std::vector<IndexType>& pixels, std::vector<unsigned int>& bins)
+{
+  bins.resize(pixels.size());
+  std::vector<float> pixel(this->Image->GetNumberOfComponentsPerPixel());
+  for(unsigned int i = 0; i < pixels.size(); ++i)
+    {
+    PixelTraits::GetPixel(this->Image.GetPointer(), this->Image->ComputeOffset(pixels[i]), &pixel[0]);
+    bins[i] = ComputeBinIndex(&pixel[0]);
+    }
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateHistograms()
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "CreateHistograms");
+  unsigned int numberOfComponents = this->Image->GetNumberOfComponentsPerPixel();
+
+  // The image can be set after the bins, so they are checked against its components here
+  if(this->NumberOfHistogramBins > RegionalCostTable::GetMaximumNumberOfHistogramBins(numberOfComponents))
+    {
+    itkGenericExceptionMacro(<< this->NumberOfHistogramBins << " histogram bins per component are too many for "
+                             << numberOfComponents << " components, the maximum is "
+                             << RegionalCostTable::GetMaximumNumberOfHistogramBins(numberOfComponents));
+    }
+
+  // Map each component's range onto [0, NumberOfHistogramBins)
+  this->BinScale.assign(numberOfComponents, 0.0f);
+  for(unsigned int component = 0; component < numberOfComponents; ++component)
+    {
+    float range = this->ImageMaximum[component] - this->ImageMinimum[component];
+    if(range > 0)
+      {
+      this->BinScale[component] = this->NumberOfHistogramBins / range;
+      }
+    }
+
+  ComputeBins(this->Seeds.GetPixels(SeedSetType::Source), this->SourceBins);
+  ComputeBins(this->Seeds.GetPixels(SeedSetType::Sink), this->SinkBins);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateRegionalCosts()
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "CreateRegionalCosts");
+  unsigned long long numberOfBins = 1;
+  for(unsigned int component = 0; component < this->Image->GetNumberOfComponentsPerPixel(); ++component)
+    {
+    numberOfBins *= this->NumberOfHistogramBins;
+    }
+
+  // Every pixel in a bin has the same cost, so the logs are only evaluated once per bin
+  this->RegionalCosts.Create(numberOfBins, this->SourceBins, this->SinkBins);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateTWeights(const float lambda)
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "CreateTWeights");
+  // Seeds are attached to their terminal with a weight that is larger than the sum of the n-links of a
+  // node (each is at most 1, and there are 2 per dimension), so they can never be cut off (Boykov and Funka-Lea,
+  // IJCV 2006). A finite value is used so that changing a seed can be applied as a difference to the residual graph.
+  const float hardConstraintWeight = 1.0f + 2.0f * Dimension;
+
+  for(unsigned int node = 0; node < this->Graph.GetNumberOfNodes(); ++node)
+    {
+    const float* binCost = this->RegionalCosts.GetCosts(this->BinIndices[node]);
+    this->Graph.SetTerminalWeights(node, lambda * binCost[0], lambda * binCost[1]);
+    }
+
+  const std::vector<IndexType>& sources = this->Seeds.GetPixels(SeedSetType::Source);
+  const std::vector<IndexType>& sinks = this->Seeds.GetPixels(SeedSetType::Sink);
+  for(unsigned int i = 0; i < sources.size(); ++i)
+    {
+    this->Graph.SetTerminalWeights(GetNodeId(sources[i]), hardConstraintWeight, 0);
+    }
+
+  for(unsigned int i = 0; i < sinks.size(); ++i)
+    {
+    this->Graph.SetTerminalWeights(GetNodeId(sinks[i]), 0, hardConstraintWeight);
+    }
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::PerformParametricSegmentation(const float maximumLambda,
+                                                                     const unsigned int numberOfLevels)
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "PerformParametricSegmentation");
+  this->Aborted = false;
+
+  if(!this->GraphIsCurrent)
+    {
+    CreateGraph();
+    if(this->Aborted)
+      {
+      return;
+      }
+    }
+  else if(!this->Incremental)
+    {
+    this->Graph.ResetFlow();
+    }
+
+  CreateHistograms();
+  CreateRegionalCosts();
+  if(this->BinIndicesNumberOfHistogramBins != this->NumberOfHistogramBins)
+    {
+    CreateBinIndices();
+    }
+  ReportProgress(CreatingHistograms, 1, 1);
+
+  // Solve the levels in increasing order. Only the t-links change from one level to the next, so
+  // each solve continues from the flow of the previous one. The labels that change between
+  // consecutive levels are recorded so that any level can be shown later by toggling them.
+  unsigned int numberOfNodes = this->Graph.GetNumberOfNodes();
+  std::vector<bool> previousIsForeground(numberOfNodes, false);
+  this->LevelFlips.assign(numberOfLevels + 1, std::vector<typename GraphType::NodeId>());
+
+  for(unsigned int level = 1; level <= numberOfLevels; ++level)
+    {
+    CreateTWeights(maximumLambda * static_cast<float>(level) / static_cast<float>(numberOfLevels));
+    ComputeMaxFlow(this->Graph);
+    if(this->Graph.GetAborted())
+      {
+      // The flips of the previous sweep were already replaced, so no level can be shown
+      this->LevelFlips.clear();
+      this->Aborted = true;
+      return;
+      }
+
+    for(unsigned int node = 0; node < numberOfNodes; ++node)
+      {
+      bool isForeground = (this->Graph.GetSegment(node) == GraphType::SOURCE);
+      if(isForeground != previousIsForeground[node] && level > 1)
+        {
+        this->LevelFlips[level].push_back(node);
+        }
+      previousIsForeground[node] = isForeground;
+      }
+    }
+
+  CreateSegmentMask();
+  this->LambdaLevel = numberOfLevels;
+}
+
+template <typename TImage>
+unsigned int IncrementalImageGraphCut<TImage>::GetNumberOfLambdaLevels() const
+{
+  if(this->LevelFlips.empty())
+    {
+    return 0;
+    }
+  return this->LevelFlips.size() - 1;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SetLambdaLevel(const unsigned int level)
+{
+  if(level < 1 || level > GetNumberOfLambdaLevels())
+    {
+    return;
+    }
+
+  // Labels are toggled, so walking in either direction applies the same lists
+  typename MaskType::PixelType* maskBuffer = this->SegmentMask->GetBufferPointer();
+  const typename MaskType::PixelType holeValue = MaskTraits::GetHoleValue(this->SegmentMask);
+  const typename MaskType::PixelType validValue = MaskTraits::GetValidValue(this->SegmentMask);
+
+  while(this->LambdaLevel != level)
+    {
+    unsigned int levelToToggle = this->LambdaLevel;
+    if(level > this->LambdaLevel)
+      {
+      levelToToggle = ++this->LambdaLevel;
+      }
+    else
+      {
+      this->LambdaLevel--;
+      }
+
+    const std::vector<typename GraphType::NodeId>& flips = this->LevelFlips[levelToToggle];
+    for(unsigned int i = 0; i < flips.size(); ++i)
+      {
+      maskBuffer[flips[i]] = (maskBuffer[flips[i]] == holeValue) ? validValue : holeValue;
+      }
+    }
+
+  this->SegmentMask->Modified();
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateSegmentMask()
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "CreateSegmentMask");
+  const typename MaskType::PixelType holeValue = MaskTraits::GetHoleValue(this->SegmentMask);
+  const typename MaskType::PixelType validValue = MaskTraits::GetValidValue(this->SegmentMask);
+
+  itk::ImageRegionIteratorWithIndex<MaskType> maskIterator(this->SegmentMask, this->SegmentMask->GetLargestPossibleRegion());
+  while(!maskIterator.IsAtEnd())
+    {
+    if(this->Graph.GetSegment(GetNodeId(maskIterator.GetIndex())) == GraphType::SOURCE)
+      {
+      maskIterator.Set(holeValue);
+      }
+    else
+      {
+      maskIterator.Set(validValue);
+      }
+    ++maskIterator;
+    }
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::PerformMultiResolutionSegmentation(std::true_type)
+{
+  CreateHistograms();
+  CreateRegionalCosts();
+  ReportProgress(CreatingHistograms, 1, 1);
+  CreatePyramid(this->NumberOfResolutionLevels);
+
+  // The labels (ForegroundLabel/BandLabel bits) of the pixels of the current level. At level 0 this is still one byte
+  // per pixel of the image, besides the graph of the band.
+  std::vector<unsigned char> labels;
+  std::vector<std::size_t> band;
+
+  const unsigned int coarsestLevel = this->NumberOfResolutionLevels - 1;
+  for(int level = coarsestLevel; level >= 0; --level)
+    {
+    const itk::Size<2> size = this->Pyramid[level].Size;
+    if(static_cast<unsigned int>(level) == coarsestLevel)
+      {
+      // Nothing is known yet, so the whole coarsest level is cut
+      labels.assign(size[0] * size[1], BandLabel);
+      band.resize(labels.size());
+      for(std::size_t offset = 0; offset < band.size(); ++offset)
+        {
+        band[offset] = offset;
+        }
+      }
+    else
+      {
+      // Every pixel starts with the label of the pixel of the coarser level that contains it
+      std::vector<unsigned char> coarseLabels;
+      coarseLabels.swap(labels);
+      const std::size_t coarseWidth = this->Pyramid[level + 1].Size[0];
+      labels.resize(size[0] * size[1]);
+      for(unsigned int y = 0; y < size[1]; ++y)
+        {
+        for(unsigned int x = 0; x < size[0]; ++x)
+          {
+          labels[y * size[0] + x] = coarseLabels[(y / 2) * coarseWidth + x / 2];
+          }
+        }
+
+      CreateBand(level, labels, band);
+      }
+
+    SegmentBand(level, labels, band);
+    if(this->Aborted)
+      {
+      return;
+      }
+    }
+
+  CreateSegmentMask(0, labels);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::PerformPreviewSegmentation(const unsigned int level)
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "PerformPreviewSegmentation");
+  this->Aborted = false;
+  PerformPreviewSegmentation(level, std::integral_constant<bool, Dimension == 2>());
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::PerformPreviewSegmentation(const unsigned int level, std::true_type)
+{
+  CreateHistograms();
+  CreateRegionalCosts();
+  ReportProgress(CreatingHistograms, 1, 1);
+  CreatePyramid(level + 1);
+
+  // The whole level is cut, as the coarsest level of PerformMultiResolutionSegmentation()
+  const itk::Size<2> size = this->Pyramid[level].Size;
+  std::vector<unsigned char> labels(size[0] * size[1], BandLabel);
+  std::vector<std::size_t> band(labels.size());
+  for(std::size_t offset = 0; offset < band.size(); ++offset)
+    {
+    band[offset] = offset;
+    }
+
+  SegmentBand(level, labels, band);
+  if(this->Aborted)
+    {
+    return;
+    }
+
+  CreateSegmentMask(level, labels);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateSegmentMask(const unsigned int level, const std::vector<unsigned char>& labels)
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "CreateSegmentMask");
+  const typename MaskType::PixelType holeValue = MaskTraits::GetHoleValue(this->SegmentMask);
+  const typename MaskType::PixelType validValue = MaskTraits::GetValidValue(this->SegmentMask);
+
+  // The offsets of the mask are those of level 0, and pixel (x, y) is in pixel (x, y) / 2^level of 'level'
+  const itk::Size<2> size = this->Pyramid[0].Size;
+  const std::size_t levelWidth = this->Pyramid[level].Size[0];
+  typename MaskType::PixelType* maskBuffer = this->SegmentMask->GetBufferPointer();
+  for(unsigned int y = 0; y < size[1]; ++y)
+    {
+    const unsigned char* levelRow = &labels[(y >> level) * levelWidth];
+    for(unsigned int x = 0; x < size[0]; ++x)
+      {
+      maskBuffer[y * size[0] + x] = (levelRow[x >> level] & ForegroundLabel) ? holeValue : validValue;
+      }
+    }
+  this->SegmentMask->Modified();
+
+  this->LevelFlips.clear();
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::PerformSuperpixelSegmentation(std::true_type)
+{
+  CreateHistograms();
+  CreateRegionalCosts();
+  if(this->BinIndicesNumberOfHistogramBins != this->NumberOfHistogramBins)
+    {
+    CreateBinIndices();
+    this->SuperpixelBinsNumberOfHistogramBins = 0;
+    }
+  ReportProgress(CreatingHistograms, 1, 1);
+
+  if(!this->SuperpixelsAreCurrent)
+    {
+    ReportProgress(CreatingSuperpixels, 0, 1);
+    CreateSuperpixels();
+    ReportProgress(CreatingSuperpixels, 1, 1);
+    }
+  if(this->SuperpixelBinsNumberOfHistogramBins != this->NumberOfHistogramBins)
+    {
+    CreateSuperpixelBins();
+    }
+
+  const std::vector<unsigned int>& superpixelLabels = this->Superpixels.GetLabels();
+  const unsigned int numberOfSuperpixels = this->Superpixels.GetNumberOfSuperpixels();
+
+  MaxFlowGraph graph;
+  graph.SetNumberOfThreads(this->Graph.GetNumberOfThreads());
+  ConnectMaxFlow(graph);
+  graph.Reset(numberOfSuperpixels, this->SuperpixelEdges.size());
+
+  std::vector<float> edgeWeightSums(numberOfSuperpixels, 0.0f);
+  for(unsigned int edge = 0; edge < this->SuperpixelEdges.size(); ++edge)
+    {
+    const std::pair<unsigned int, unsigned int>& superpixels = this->SuperpixelEdges[edge];
+    const float weight = this->SuperpixelEdgeWeights[edge];
+    graph.AddEdge(superpixels.first, superpixels.second, weight, weight);
+    edgeWeightSums[superpixels.first] += weight;
+    edgeWeightSums[superpixels.second] += weight;
+    }
+
+  std::vector<float> sourceWeights(numberOfSuperpixels, 0.0f);
+  std::vector<float> sinkWeights(numberOfSuperpixels, 0.0f);
+  for(unsigned int superpixel = 0; superpixel < numberOfSuperpixels; ++superpixel)
+    {
+    for(unsigned int i = this->SuperpixelBinOffsets[superpixel]; i < this->SuperpixelBinOffsets[superpixel + 1]; ++i)
+      {
+      const float* binCost = this->RegionalCosts.GetCosts(this->SuperpixelBins[i].first);
+      sourceWeights[superpixel] += this->Lambda * this->SuperpixelBins[i].second * binCost[0];
+      sinkWeights[superpixel] += this->Lambda * this->SuperpixelBins[i].second * binCost[1];
+      }
+    }
+
+  // The n-links of a superpixel are not bounded as those of a pixel are, so the weight of a seed is larger than
+  // everything else that is attached to its superpixel. A superpixel with seeds of both kinds is not constrained,
+  // and the refinement cuts its pixels.
+  std::vector<unsigned char> seedLabels(numberOfSuperpixels, SeedSetType::None);
+  const std::vector<IndexType>& sources = this->Seeds.GetPixels(SeedSetType::Source);
+  const std::vector<IndexType>& sinks = this->Seeds.GetPixels(SeedSetType::Sink);
+  for(unsigned int i = 0; i < sources.size(); ++i)
+    {
+    seedLabels[superpixelLabels[GetNodeId(sources[i])]] |= SeedSetType::Source;
+    }
+  for(unsigned int i = 0; i < sinks.size(); ++i)
+    {
+    seedLabels[superpixelLabels[GetNodeId(sinks[i])]] |= SeedSetType::Sink;
+    }
+
+  for(unsigned int superpixel = 0; superpixel < numberOfSuperpixels; ++superpixel)
+    {
+    const float hardConstraintWeight = 1.0f + edgeWeightSums[superpixel] + sourceWeights[superpixel] +
+                                       sinkWeights[superpixel];
+    if(seedLabels[superpixel] == SeedSetType::Source)
+      {
+      graph.SetTerminalWeights(superpixel, hardConstraintWeight, 0);
+      }
+    else if(seedLabels[superpixel] == SeedSetType::Sink)
+      {
+      graph.SetTerminalWeights(superpixel, 0, hardConstraintWeight);
+      }
+    else
+      {
+      graph.SetTerminalWeights(superpixel, sourceWeights[superpixel], sinkWeights[superpixel]);
+      }
+    }
+
+  RecordGraph(graph);
+  ComputeMaxFlow(graph);
+  if(graph.GetAborted())
+    {
+    this->Aborted = true;
+    return;
+    }
+
+  std::vector<unsigned char> labels(superpixelLabels.size());
+  for(unsigned int offset = 0; offset < labels.size(); ++offset)
+    {
+    labels[offset] = (graph.GetSegment(superpixelLabels[offset]) == MaxFlowGraph::SOURCE) ? ForegroundLabel : 0;
+    }
+
+  // Level 0 of the pyramid is the image itself, it only has to be created to cut or copy labels of its size
+  CreatePyramid(1);
+  if(this->SuperpixelRefinement)
+    {
+    std::vector<std::size_t> band;
+    CreateBand(0, labels, band);
+    SegmentBand(0, labels, band);
+    if(this->Aborted)
+      {
+      return;
+      }
+    }
+
+  CreateSegmentMask(0, labels);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateSuperpixels()
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "CreateSuperpixels");
+  this->Superpixels.SetImage(this->Image);
+  this->Superpixels.SetSuperpixelSize(this->SuperpixelSize);
+  const float sigma = GetNoise();
+  this->Superpixels.SetCompactness(this->SuperpixelCompactness * sigma);
+  this->Superpixels.SetNumberOfThreads(this->Graph.GetNumberOfThreads());
+  this->Superpixels.Compute();
+
+  const std::vector<unsigned int>& superpixelLabels = this->Superpixels.GetLabels();
+  const itk::Size<2> size = this->Image->GetLargestPossibleRegion().GetSize();
+  const unsigned int numberOfComponents = this->Image->GetNumberOfComponentsPerPixel();
+
+  // The n-link of every pair of neighboring pixels in different superpixels, keyed by the pair of superpixels
+  std::vector<std::pair<unsigned long long, float> > pixelEdges;
+  std::vector<float> pixel(numberOfComponents);
+  std::vector<float> neighborPixel(numberOfComponents);
+  for(unsigned int y = 0; y < size[1]; ++y)
+    {
+    for(unsigned int x = 0; x < size[0]; ++x)
+      {
+      const unsigned int offset = y * size[0] + x;
+      const unsigned int neighborOffsets[2] = {offset + 1, offset + static_cast<unsigned int>(size[0])};
+      const bool neighborIsInside[2] = {x + 1 < size[0], y + 1 < size[1]};
+      for(unsigned int neighbor = 0; neighbor < 2; ++neighbor)
+        {
+        if(!neighborIsInside[neighbor])
+          {
+          continue;
+          }
+        const unsigned int a = superpixelLabels[offset];
+        const unsigned int b = superpixelLabels[neighborOffsets[neighbor]];
+        if(a == b)
+          {
+          continue;
+          }
+        GetPyramidPixel(0, offset, &pixel[0]);
+        GetPyramidPixel(0, neighborOffsets[neighbor], &neighborPixel[0]);
+        float pixelDifference = PixelDifference(&pixel[0], &neighborPixel[0]);
+        float weight = exp(-pow(pixelDifference,2)/(2.0*sigma*sigma));
+        unsigned long long key = (static_cast<unsigned long long>(std::min(a, b)) << 32) | std::max(a, b);
+        pixelEdges.push_back(std::make_pair(key, weight));
+        }
+      }
+    }
+
+  std::sort(pixelEdges.begin(), pixelEdges.end());
+  this->SuperpixelEdges.clear();
+  this->SuperpixelEdgeWeights.clear();
+  for(unsigned int i = 0; i < pixelEdges.size(); ++i)
+    {
+    if(i == 0 || pixelEdges[i].first != pixelEdges[i - 1].first)
+      {
+      this->SuperpixelEdges.push_back(std::make_pair(static_cast<unsigned int>(pixelEdges[i].first >> 32),
+                                                     static_cast<unsigned int>(pixelEdges[i].first & 0xffffffff)));
+      this->SuperpixelEdgeWeights.push_back(0.0f);
+      }
+    this->SuperpixelEdgeWeights.back() += pixelEdges[i].second;
+    }
+
+  this->SuperpixelsAreCurrent = true;
+  this->SuperpixelBinsNumberOfHistogramBins = 0;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateSuperpixelBins()
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "CreateSuperpixelBins");
+  const std::vector<unsigned int>& superpixelLabels = this->Superpixels.GetLabels();
+  const unsigned int numberOfSuperpixels = this->Superpixels.GetNumberOfSuperpixels();
+
+  // Sort the bins of the pixels by superpixel (a counting sort), then count the pixels of each bin per superpixel
+  std::vector<unsigned int> pixelOffsets(numberOfSuperpixels + 1, 0);
+  for(unsigned int offset = 0; offset < superpixelLabels.size(); ++offset)
+    {
+    pixelOffsets[superpixelLabels[offset] + 1]++;
+    }
+  for(unsigned int superpixel = 0; superpixel < numberOfSuperpixels; ++superpixel)
+    {
+    pixelOffsets[superpixel + 1] += pixelOffsets[superpixel];
+    }
+  std::vector<unsigned int> bins(superpixelLabels.size());
+  std::vector<unsigned int> nextPixel(pixelOffsets.begin(), pixelOffsets.end() - 1);
+  for(unsigned int offset = 0; offset < superpixelLabels.size(); ++offset)
+    {
+    bins[nextPixel[superpixelLabels[offset]]++] = this->BinIndices[offset];
+    }
+
+  this->SuperpixelBinOffsets.resize(numberOfSuperpixels + 1);
+  this->SuperpixelBins.clear();
+  for(unsigned int superpixel = 0; superpixel < numberOfSuperpixels; ++superpixel)
+    {
+    this->SuperpixelBinOffsets[superpixel] = this->SuperpixelBins.size();
+    std::vector<unsigned int>::iterator first = bins.begin() + pixelOffsets[superpixel];
+    std::vector<unsigned int>::iterator last = bins.begin() + pixelOffsets[superpixel + 1];
+    std::sort(first, last);
+    for(std::vector<unsigned int>::iterator bin = first; bin != last; ++bin)
+      {
+      if(bin == first || *bin != *(bin - 1))
+        {
+        this->SuperpixelBins.push_back(std::make_pair(*bin, 0u));
+        }
+      this->SuperpixelBins.back().second++;
+      }
+    }
+  this->SuperpixelBinOffsets[numberOfSuperpixels] = this->SuperpixelBins.size();
+
+  this->SuperpixelBinsNumberOfHistogramBins = this->NumberOfHistogramBins;
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreatePyramid(const unsigned int numberOfLevels)
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "CreatePyramid");
+  if(this->Pyramid.empty())
+    {
+    this->Pyramid.resize(1);
+    this->Pyramid[0].Size = this->Image->GetLargestPossibleRegion().GetSize();
+    this->Pyramid[0].Noise = ComputePyramidNoise(0);
+    }
+
+  const unsigned int numberOfComponents = this->Image->GetNumberOfComponentsPerPixel();
+
+  std::vector<float> finePixel(numberOfComponents);
+  for(unsigned int level = this->Pyramid.size(); level < numberOfLevels; ++level)
+    {
+    const itk::Size<2> fineSize = this->Pyramid[level - 1].Size;
+
+    PyramidLevel pyramidLevel;
+    pyramidLevel.Size[0] = (fineSize[0] + 1) / 2;
+    pyramidLevel.Size[1] = (fineSize[1] + 1) / 2;
+    pyramidLevel.Pixels.assign(pyramidLevel.Size[0] * pyramidLevel.Size[1] * numberOfComponents, 0.0f);
+
+    // Average the (up to, at the right and bottom border) 2x2 pixels of the finer level
+    for(unsigned int y = 0; y < pyramidLevel.Size[1]; ++y)
+      {
+      for(unsigned int x = 0; x < pyramidLevel.Size[0]; ++x)
+        {
+        float* pixel = &pyramidLevel.Pixels[(y * pyramidLevel.Size[0] + x) * numberOfComponents];
+        unsigned int numberOfFinePixels = 0;
+        for(unsigned int fineY = 2 * y; fineY < std::min<unsigned int>(2 * y + 2, fineSize[1]); ++fineY)
+          {
+          for(unsigned int fineX = 2 * x; fineX < std::min<unsigned int>(2 * x + 2, fineSize[0]); ++fineX)
+            {
+            GetPyramidPixel(level - 1, fineY * fineSize[0] + fineX, &finePixel[0]);
+            for(unsigned int component = 0; component < numberOfComponents; ++component)
+              {
+              pixel[component] += finePixel[component];
+              }
+            numberOfFinePixels++;
+            }
+          }
+        for(unsigned int component = 0; component < numberOfComponents; ++component)
+          {
+          pixel[component] /= numberOfFinePixels;
+          }
+        }
+      }
+
+    RecordAllocation(pyramidLevel.Pixels.size() * sizeof(float));
+    this->Pyramid.push_back(pyramidLevel);
+    this->Pyramid[level].Noise = ComputePyramidNoise(level);
+    }
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::GetPyramidPixel(const unsigned int level, const std::size_t offset,
+                                                       float* const pixel) const
+{
+  const unsigned int numberOfComponents = this->Image->GetNumberOfComponentsPerPixel();
+  if(level == 0)
+    {
+    PixelTraits::GetPixel(this->Image.GetPointer(), offset, pixel);
+    }
+  else
+    {
+    std::copy(&this->Pyramid[level].Pixels[offset * numberOfComponents],
+              &this->Pyramid[level].Pixels[offset * numberOfComponents] + numberOfComponents, pixel);
+    }
+}
+
+template <typename TImage>
+std::size_t IncrementalImageGraphCut<TImage>::GetPyramidOffset(const unsigned int level, const itk::Index<2>& index) const
+{
+  return static_cast<std::size_t>(index[1] >> level) * this->Pyramid[level].Size[0] + (index[0] >> level);
+}
+
+template <typename TImage>
+float IncrementalImageGraphCut<TImage>::ComputePyramidNoise(const unsigned int level)
+{
+  if(level == 0)
+    {
+    return GetNoise();
+    }
+
+  const unsigned int numberOfComponents = this->Image->GetNumberOfComponentsPerPixel();
+  const itk::Size<2> size = this->Pyramid[level].Size;
+  const float* pixels = &this->Pyramid[level].Pixels[0];
+
+  double sum = 0;
+  unsigned int numberOfDifferences = 0;
+  for(unsigned int y = 0; y < size[1]; ++y)
+    {
+    for(unsigned int x = 0; x < size[0]; ++x)
+      {
+      const float* pixel = pixels + (y * size[0] + x) * numberOfComponents;
+      if(x + 1 < size[0])
+        {
+        sum += PixelDifference(pixel, pixel + numberOfComponents);
+        numberOfDifferences++;
+        }
+      if(y + 1 < size[1])
+        {
+        sum += PixelDifference(pixel, pixel + size[0] * numberOfComponents);
+        numberOfDifferences++;
+        }
+      }
+    }
+
+  if(numberOfDifferences == 0 || sum == 0)
+    {
+    return 1.0f;
+    }
+
+  return sum / static_cast<double>(numberOfDifferences);
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::CreateBand(const unsigned int level, std::vector<unsigned char>& labels,
+                                                  std::vector<std::size_t>& band)
+{
+  TraceRecorder::ScopedTimer timer(this->Trace, "CreateBand");
+  const int width = this->Pyramid[level].Size[0];
+  const int height = this->Pyramid[level].Size[1];
+
+  // The pixels on either side of a label change. Offsets are std::size_t, a level 0 image can have more
+  // than 2^31 pixels.
+  std::vector<std::size_t> boundary;
+  for(int y = 0; y < height; ++y)
+    {
+    for(int x = 0; x < width; ++x)
+      {
+      std::size_t offset = static_cast<std::size_t>(y) * width + x;
+      if(x + 1 < width && labels[offset] != labels[offset + 1])
+        {
+        boundary.push_back(offset);
+        boundary.push_back(offset + 1);
+        }
+      if(y + 1 < height && labels[offset] != labels[offset + width])
+        {
+        boundary.push_back(offset);
+        boundary.push_back(offset + width);
+        }
+      }
+    }
+
+  // A seed that the coarser level got wrong (e.g. a thin structure that disappeared when it was
+  // downsampled) also needs a band, otherwise it could not change back.
+  const std::vector<IndexType>& sources = this->Seeds.GetPixels(SeedSetType::Source);
+  const std::vector<IndexType>& sinks = this->Seeds.GetPixels(SeedSetType::Sink);
+  for(unsigned int i = 0; i < sources.size(); ++i)
+    {
+    std::size_t offset = GetPyramidOffset(level, sources[i]);
+    if(!(labels[offset] & ForegroundLabel))
+      {
+      boundary.push_back(offset);
+      }
+    }
+  for(unsigned int i = 0; i < sinks.size(); ++i)
+    {
+    std::size_t offset = GetPyramidOffset(level, sinks[i]);
+    if(labels[offset] & ForegroundLabel)
+      {
+      boundary.push_back(offset);
+      }
+    }
+
+  const int radius = this->BandRadius;
+  for(unsigned int i = 0; i < boundary.size(); ++i)
+    {
+    int boundaryX = static_cast<int>(boundary[i] % width);
+    int boundaryY = static_cast<int>(boundary[i] / width);
+    for(int y = std::max(boundaryY - radius, 0); y <= std::min(boundaryY + radius, height - 1); ++y)
+      {
+      for(int x = std::max(boundaryX - radius, 0); x <= std::min(boundaryX + radius, width - 1); ++x)
+        {
+        labels[static_cast<std::size_t>(y) * width + x] |= BandLabel;
+        }
+      }
+    }
+
+  band.clear();
+  for(std::size_t offset = 0; offset < labels.size(); ++offset)
+    {
+    if(labels[offset] & BandLabel)
+      {
+      band.push_back(offset);
+      }
+    }
+}
+
+template <typename TImage>
+void IncrementalImageGraphCut<TImage>::SegmentBand(const unsigned int level, std::vector<unsigned char>& labels,
+                                                   const std::vector<std::size_t>& band)
+{
+  const int width = this->Pyramid[level].Size[0];
+  const int height = this->Pyramid[level].Size[1];
+  const unsigned int numberOfComponents = this->Image->GetNumberOfComponentsPerPixel();
+
+  // As in CreateTWeights()
+  const float hardConstraintWeight = 1.0f + 2.0f * Dimension;
+
+  // A pixel of this level stands for 4^level pixels of the image, but an n-link only for 2^level
+  // n-links, so the regional term is scaled by 2^level relative to the boundary term.
+  const float lambda = this->Lambda * (1 << level);
+
+  const float sigma = this->Pyramid[level].Noise;
+
+  if(band.size() > static_cast<std::size_t>(std::numeric_limits<int>::max()))
+    {
+    itkGenericExceptionMacro(<< "A band of " << band.size() << " pixels does not fit in a graph, use more "
+                             << "resolution levels");
+    }
+
+  MaxFlowGraph graph;
+  graph.SetNumberOfThreads(this->Graph.GetNumberOfThreads());
+  ConnectMaxFlow(graph);
+  graph.Reset(band.size(), 2 * band.size());
+
+  std::vector<float> sourceWeights(band.size());
+  std::vector<float> sinkWeights(band.size());
+
+  std::vector<float> pixel(numberOfComponents);
+  std::vector<float> neighborPixel(numberOfComponents);
+
+  const int neighborX[4] = {1, 0, -1, 0};
+  const int neighborY[4] = {0, 1, 0, -1};
+
+  for(unsigned int node = 0; node < band.size(); ++node)
+    {
+    std::size_t offset = band[node];
+    int x = static_cast<int>(offset % width);
+    int y = static_cast<int>(offset / width);
+
+    GetPyramidPixel(level, offset, &pixel[0]);
+    const float* binCost = this->RegionalCosts.GetCosts(ComputeBinIndex(&pixel[0]));
+    sourceWeights[node] = lambda * binCost[0];
+    sinkWeights[node] = lambda * binCost[1];
+
+    for(unsigned int neighbor = 0; neighbor < 4; ++neighbor)
+      {
+      int nx = x + neighborX[neighbor];
+      int ny = y + neighborY[neighbor];
+      if(nx < 0 || nx >= width || ny < 0 || ny >= height)
+        {
+        continue;
+        }
+      std::size_t neighborOffset = static_cast<std::size_t>(ny) * width + nx;
+      bool neighborIsInBand = labels[neighborOffset] & BandLabel;
+
+      // The edge between two band pixels is added from the pixel on its left/top
+      if(neighborIsInBand && neighbor >= 2)
+        {
+        continue;
+        }
+
+      GetPyramidPixel(level, neighborOffset, &neighborPixel[0]);
+      float pixelDifference = PixelDifference(&pixel[0], &neighborPixel[0]);
+      float weight = exp(-pow(pixelDifference,2)/(2.0*sigma*sigma));
+
+      if(neighborIsInBand)
+        {
+        int neighborNode = std::lower_bound(band.begin(), band.end(), neighborOffset) - band.begin();
+        graph.AddEdge(node, neighborNode, weight, weight);
+        }
+      else if(labels[neighborOffset] & ForegroundLabel)
+        {
+        // The n-link to a fixed pixel is cut if this pixel takes the other label, like a t-link
+        sourceWeights[node] += weight;
+        }
+      else
+        {
+        sinkWeights[node] += weight;
+        }
+      }
+    }
+
+  // Seeds outside of the band already have their label. Where a source and a sink seed fall into the same pixel
+  // of a coarse level the sink wins, and the band around the source separates them again at the finer levels.
+  const std::vector<IndexType>& sources = this->Seeds.GetPixels(SeedSetType::Source);
+  const std::vector<IndexType>& sinks = this->Seeds.GetPixels(SeedSetType::Sink);
+  for(unsigned int i = 0; i < sources.size(); ++i)
+    {
+    std::size_t offset = GetPyramidOffset(level, sources[i]);
+    if(labels[offset] & BandLabel)
+      {
+      int node = std::lower_bound(band.begin(), band.end(), offset) - band.begin();
+      sourceWeights[node] = hardConstraintWeight;
+      sinkWeights[node] = 0;
+      }
+    }
+  for(unsigned int i = 0; i < sinks.size(); ++i)
+    {
+    std::size_t offset = GetPyramidOffset(level, sinks[i]);
+    if(labels[offset] & BandLabel)
+      {
+      int node = std::lower_bound(band.begin(), band.end(), offset) - band.begin();
+      sourceWeights[node] = 0;
+      sinkWeights[node] = hardConstraintWeight;
+      }
+    }
+
+  for(unsigned int node = 0; node < band.size(); ++node)
+    {
+    graph.SetTerminalWeights(node, sourceWeights[node], sinkWeights[node]);
+    }
+
+  RecordGraph(graph);
+  ComputeMaxFlow(graph);
+  if(graph.GetAborted())
+    {
+    this->Aborted = true;
+    return;
+    }
+
+  for(unsigned int node = 0; node < band.size(); ++node)
+    {
+    labels[band[node]] = (graph.GetSegment(node) == MaxFlowGraph::SOURCE) ? ForegroundLabel : 0;
+    }
+}
+
+#endif
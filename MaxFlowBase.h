@@ -0,0 +1,233 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Boykov-Kolmogorov S-T max-flow ("An Experimental Comparison of Min-Cut/Max-Flow
+ * Algorithms for Energy Minimization in Vision", PAMI 2004). This follows the structure
+ * of Kolmogorov's maxflow code, but nodes are plain indices (for an image, the pixel's
+ * offset in the buffer) so no separate node id image is needed.
+ *
+ * The search does not know how the arcs are stored. TGraph derives from this class and provides
+ * (all taking and returning int arc/node indices):
+ *   FirstArc(i), NextArc(a) - iterate over the arcs leaving node i (-1 ends the list)
+ *   Head(a)                 - the node that arc a points to
+ *   Sister(a)               - the reverse arc of a
+ *   ResidualCapacity(a)     - a reference to the residual capacity of a
+ *   GetMaximumArcSpan()     - the largest |i-j| of an arc i->j
+ * MaxFlowGraph stores general adjacency lists, GridMaxFlowGraph computes the arcs of a 4-connected grid.
+ *
+ * The residual graph is kept after MaxFlow() returns. If the terminal weights of some nodes
+ * are then changed with SetTerminalWeights(), the next MaxFlow() continues from the previous
+ * flow instead of starting from zero ("dynamic graph cuts", Kohli and Torr, ICCV 2005).
+ * The change is applied as a reparameterization of the terminal edges, so it is valid for
+ * both increased and decreased weights. Only the difference between the two terminal weights of a node
+ * affects the cut, so that is all that is kept of them.
+ *
+ * The search trees are kept as well, as with reuse_trees in Kolmogorov's code: SetTerminalWeights() marks the
+ * nodes whose terminal capacity changed, and the next MaxFlow() only makes them roots of their new tree (or
+ * orphans), adopts the nodes that lost their parent and grows the trees from there. A re-cut after a small
+ * edit therefore only searches around the edit instead of regrowing the trees over the whole graph. Any other
+ * change of the graph (new edges, ResetFlow()) and an aborted MaxFlow() make the next one start the trees over.
+ *
+ * With more than one thread, the nodes are split into contiguous blocks of ids (for an image,
+ * horizontal strips). The max-flow of each block (ignoring the edges that leave it) is computed
+ * in parallel, then neighboring blocks are merged pairwise and the merged blocks continue from
+ * the flow of their halves, also in parallel, until a single block remains ("Parallel graph-cuts
+ * by adaptive bottom-up merging", Liu and Sun, CVPR 2010). The search trees of the halves are valid
+ * in the merged block, so a merge keeps them and only activates the tree nodes with an arc across
+ * the seam: the search of a merged block starts at its seam instead of at every terminal edge.
+ * Every step pushes a valid flow, and the last step completes the max-flow over the whole graph,
+ * so the cut is the same as with one thread.
+*/
+
+#ifndef MaxFlowBase_H
+#define MaxFlowBase_H
+
+// STL
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <vector>
+
+template <typename TGraph>
+class MaxFlowBase
+{
+public:
+  typedef int NodeId;
+
+  enum SegmentType {SOURCE = 0, SINK = 1};
+
+  MaxFlowBase();
+
+  unsigned int GetNumberOfNodes() const;
+
+  /** Set the weights of the edges SOURCE->i and i->SINK. This replaces (does not add to)
+   *  the weights that were previously set for this node, and may be called after MaxFlow(). */
+  void SetTerminalWeights(const NodeId i, const float sourceWeight, const float sinkWeight);
+
+  /** Compute the maximum flow. If a flow was already computed, the computation continues
+   *  from the residual graph that it left. Returns the total flow, not counting the part of the
+   *  terminal weights of a node that is the same for both of them (it is cut whatever the segment). */
+  float MaxFlow();
+
+  /** The number of threads used by MaxFlow(). The default is 1. */
+  void SetNumberOfThreads(const unsigned int numberOfThreads);
+  unsigned int GetNumberOfThreads() const;
+
+  /** After MaxFlow(), determine which side of the cut a node is on. */
+  SegmentType GetSegment(const NodeId i) const;
+
+  /** The number of augmenting paths found by the last MaxFlow(). */
+  unsigned int GetNumberOfAugmentations() const;
+
+  /** The number of orphans that the last MaxFlow() had to adopt (or free) after its augmentations. */
+  unsigned int GetNumberOfOrphans() const;
+
+  /** If 'abortFlag' is not null, MaxFlow() checks it regularly and returns early once it is true. Every
+   *  augmentation is completed, so the residual graph is still a valid flow and the next MaxFlow() continues
+   *  from it, but GetSegment() is meaningless until a MaxFlow() completes. */
+  void SetAbortFlag(const std::atomic<bool>* const abortFlag);
+
+  /** True if the last MaxFlow() returned early because of the abort flag. */
+  bool GetAborted() const;
+
+  /** Called with the number of augmenting paths found so far by MaxFlow(), every ProgressInterval paths.
+   *  With more than one thread, it is called from the threads of the blocks, possibly at the same time. */
+  typedef std::function<void(unsigned int)> ProgressCallbackType;
+  void SetProgressCallback(const ProgressCallbackType& callback);
+
+  static const unsigned int ProgressInterval = 1024;
+
+protected:
+
+  /** Create 'numberOfNodes' nodes with no terminal weights and no flow. */
+  void ResetNodes(const unsigned int numberOfNodes);
+
+  /** The bytes allocated for the nodes and their terminal weights. */
+  std::size_t GetNodesMemorySize() const;
+
+  static const int NoParent = -1;
+  static const int TerminalParent = -2;
+  static const int OrphanParent = -3;
+
+  static const int NotActive = -1;
+
+  struct Node
+  {
+    /** The arc to the parent in the search tree (NoParent/TerminalParent/OrphanParent are special values). */
+    int Parent;
+
+    /** The next node in the active queue (itself if it is the last one), or NotActive. */
+    int Next;
+
+    /** Timestamp of Distance, used to prefer short paths during adoption. */
+    int TS;
+
+    /** Residual capacity of the terminal edge: >0 is to the source, <0 is to the sink. */
+    float TerminalCapacity;
+
+    /** The distance to the terminal, the tree that the node is in and whether it is in MarkedNodes. They share a
+     *  word, so a node is 20 bytes (a distance is less than the number of nodes, and less than 2^30). */
+    unsigned int Distance : 30;
+    unsigned int IsSink : 1;
+    unsigned int IsMarked : 1;
+  };
+
+  std::vector<Node> Nodes;
+
+  /** The source minus the sink weight that was set by the user, needed to apply later changes as a difference. */
+  std::vector<float> TerminalWeights;
+
+  /** The nodes whose terminal capacity changed since the last MaxFlow(), if SearchTreesAreCurrent. */
+  std::vector<int> MarkedNodes;
+
+  /** False if the next MaxFlow() has to grow the search trees from scratch instead of reusing them. */
+  bool SearchTreesAreCurrent;
+
+  /** The Time of the last search, so that the next one can tell its distance marks from the old ones. */
+  int Time;
+
+  float Flow;
+
+  unsigned int NumberOfAugmentations;
+  unsigned int NumberOfOrphans;
+
+  unsigned int NumberOfThreads;
+
+  const std::atomic<bool>* AbortFlag;
+  bool Aborted;
+
+  ProgressCallbackType ProgressCallback;
+
+  /** The augmentations of all of the blocks of the running MaxFlow(), in steps of ProgressInterval. */
+  std::atomic<unsigned int> ReportedAugmentations;
+
+private:
+
+  TGraph& Self()
+  {
+    return *static_cast<TGraph*>(this);
+  }
+
+  /** The state of a search over the nodes [Begin, End). Arcs to nodes outside of this range are
+   *  ignored, so searches over disjoint ranges can run concurrently. */
+  struct SearchState
+  {
+    SearchState(const int begin, const int end);
+
+    int Begin;
+    int End;
+    int QueueFirst[2];
+    int QueueLast[2];
+    std::deque<int> Orphans;
+    int Time;
+    float Flow;
+    unsigned int NumberOfAugmentations;
+    unsigned int NumberOfOrphans;
+
+    bool Contains(const int i) const
+    {
+      return i >= this->Begin && i < this->End;
+    }
+  };
+
+  /** Run the max-flow on the nodes of 'state', starting from the current residual graph and from the trees, active
+   *  nodes and orphans that the state was initialized with. */
+  void MaxFlow(SearchState& state);
+
+  bool AbortRequested() const
+  {
+    return this->AbortFlag && this->AbortFlag->load(std::memory_order_relaxed);
+  }
+
+  void InitializeSearchTrees(SearchState& state);
+  void ReuseSearchTrees(SearchState& state);
+  void AdoptOrphans(SearchState& state);
+  void SolveBlock(SearchState& state);
+  void MergeBlocks(SearchState& state, const int seam);
+  void SetActive(SearchState& state, const int i);
+  int NextActive(SearchState& state);
+  void SetOrphanFront(SearchState& state, const int i);
+  void SetOrphanRear(SearchState& state, const int i);
+  void Augment(SearchState& state, const int middleArc);
+  void ProcessSourceOrphan(SearchState& state, const int i);
+  void ProcessSinkOrphan(SearchState& state, const int i);
+};
+
+#include "MaxFlowBase.hpp"
+
+#endif
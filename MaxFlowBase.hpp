@@ -0,0 +1,911 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MaxFlowBase_HPP
+#define MaxFlowBase_HPP
+
+#include "MaxFlowBase.h" // Appease syntax parser
+
+// STL
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <thread>
+
+template <typename TGraph>
+MaxFlowBase<TGraph>::MaxFlowBase() : SearchTreesAreCurrent(false), Time(0), Flow(0), NumberOfAugmentations(0), NumberOfOrphans(0), NumberOfThreads(1), AbortFlag(nullptr),
+  Aborted(false), ReportedAugmentations(0)
+{
+}
+
+template <typename TGraph>
+const unsigned int MaxFlowBase<TGraph>::ProgressInterval;
+
+template <typename TGraph>
+MaxFlowBase<TGraph>::SearchState::SearchState(const int begin, const int end) :
+  Begin(begin), End(end), Time(0), Flow(0), NumberOfAugmentations(0), NumberOfOrphans(0)
+{
+  this->QueueFirst[0] = this->QueueFirst[1] = -1;
+  this->QueueLast[0] = this->QueueLast[1] = -1;
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::SetNumberOfThreads(const unsigned int numberOfThreads)
+{
+  this->NumberOfThreads = std::max(numberOfThreads, 1u);
+}
+
+template <typename TGraph>
+unsigned int MaxFlowBase<TGraph>::GetNumberOfThreads() const
+{
+  return this->NumberOfThreads;
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::ResetNodes(const unsigned int numberOfNodes)
+{
+  Node node;
+  node.Parent = NoParent;
+  node.Next = NotActive;
+  node.TS = 0;
+  node.Distance = 0;
+  node.TerminalCapacity = 0;
+  node.IsSink = false;
+  node.IsMarked = false;
+
+  this->Nodes.assign(numberOfNodes, node);
+
+  this->TerminalWeights.assign(numberOfNodes, 0);
+
+  this->MarkedNodes.clear();
+  this->SearchTreesAreCurrent = false;
+
+  this->Flow = 0;
+  this->NumberOfAugmentations = 0;
+  this->NumberOfOrphans = 0;
+}
+
+template <typename TGraph>
+std::size_t MaxFlowBase<TGraph>::GetNodesMemorySize() const
+{
+  return this->Nodes.capacity() * sizeof(Node) + this->TerminalWeights.capacity() * sizeof(float) +
+         this->MarkedNodes.capacity() * sizeof(int);
+}
+
+template <typename TGraph>
+unsigned int MaxFlowBase<TGraph>::GetNumberOfNodes() const
+{
+  return this->Nodes.size();
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::SetTerminalWeights(const NodeId i, const float sourceWeight, const float sinkWeight)
+{
+  // Only the change relative to the previous weights is applied to the residual graph. The node is cut
+  // with a source capacity of max(weight, 0) and a sink capacity of max(-weight, 0). A constant can be
+  // added to both terminal edges of a node without changing the minimum cut, so the (possibly negative)
+  // changes of the two capacities are folded into the single residual terminal capacity, and the part
+  // that they have in common is flow that is already pushed (or, if negative, that is taken back).
+  const float weight = sourceWeight - sinkWeight;
+  const float previousWeight = this->TerminalWeights[i];
+  if(weight == previousWeight)
+    {
+    return;
+    }
+
+  float deltaSource = std::max(weight, 0.0f) - std::max(previousWeight, 0.0f);
+  float deltaSink = std::max(-weight, 0.0f) - std::max(-previousWeight, 0.0f);
+  this->TerminalWeights[i] = weight;
+
+  float residual = this->Nodes[i].TerminalCapacity;
+  if(residual > 0)
+    {
+    deltaSource += residual;
+    }
+  else
+    {
+    deltaSink -= residual;
+    }
+  this->Flow += std::min(deltaSource, deltaSink);
+  this->Nodes[i].TerminalCapacity = deltaSource - deltaSink;
+
+  // The next MaxFlow() has to make the node a root of its new tree, or an orphan
+  if(!this->SearchTreesAreCurrent || this->Nodes[i].IsMarked)
+    {
+    return;
+    }
+  if(this->MarkedNodes.size() >= this->Nodes.size() / 4)
+    {
+    // Regrowing the trees is cheaper than repairing them around this many nodes
+    this->SearchTreesAreCurrent = false;
+    this->MarkedNodes.clear();
+    return;
+    }
+  this->Nodes[i].IsMarked = true;
+  this->MarkedNodes.push_back(i);
+}
+
+template <typename TGraph>
+typename MaxFlowBase<TGraph>::SegmentType MaxFlowBase<TGraph>::GetSegment(const NodeId i) const
+{
+  if(this->Nodes[i].Parent != NoParent && this->Nodes[i].IsSink)
+    {
+    return SINK;
+    }
+  return SOURCE;
+}
+
+template <typename TGraph>
+unsigned int MaxFlowBase<TGraph>::GetNumberOfAugmentations() const
+{
+  return this->NumberOfAugmentations;
+}
+
+template <typename TGraph>
+unsigned int MaxFlowBase<TGraph>::GetNumberOfOrphans() const
+{
+  return this->NumberOfOrphans;
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::SetAbortFlag(const std::atomic<bool>* const abortFlag)
+{
+  this->AbortFlag = abortFlag;
+}
+
+template <typename TGraph>
+bool MaxFlowBase<TGraph>::GetAborted() const
+{
+  return this->Aborted;
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::SetProgressCallback(const ProgressCallbackType& callback)
+{
+  this->ProgressCallback = callback;
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::SetActive(SearchState& state, const int i)
+{
+  if(this->Nodes[i].Next != NotActive)
+    {
+    return;
+    }
+
+  if(state.QueueLast[1] >= 0)
+    {
+    this->Nodes[state.QueueLast[1]].Next = i;
+    }
+  else
+    {
+    state.QueueFirst[1] = i;
+    }
+  state.QueueLast[1] = i;
+  this->Nodes[i].Next = i;
+}
+
+template <typename TGraph>
+int MaxFlowBase<TGraph>::NextActive(SearchState& state)
+{
+  // Nodes are taken from queue 0 while new active nodes are added to queue 1, so that the
+  // search proceeds in (approximately) breadth first order.
+  while(true)
+    {
+    int i = state.QueueFirst[0];
+    if(i < 0)
+      {
+      i = state.QueueFirst[1];
+      state.QueueFirst[0] = state.QueueFirst[1];
+      state.QueueLast[0] = state.QueueLast[1];
+      state.QueueFirst[1] = -1;
+      state.QueueLast[1] = -1;
+      if(i < 0)
+        {
+        return -1;
+        }
+      }
+
+    if(this->Nodes[i].Next == i)
+      {
+      state.QueueFirst[0] = -1;
+      state.QueueLast[0] = -1;
+      }
+    else
+      {
+      state.QueueFirst[0] = this->Nodes[i].Next;
+      }
+    this->Nodes[i].Next = NotActive;
+
+    // A node in the queue is only active if it is still in one of the trees
+    if(this->Nodes[i].Parent != NoParent)
+      {
+      return i;
+      }
+    }
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::SetOrphanFront(SearchState& state, const int i)
+{
+  this->Nodes[i].Parent = OrphanParent;
+  state.Orphans.push_front(i);
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::SetOrphanRear(SearchState& state, const int i)
+{
+  this->Nodes[i].Parent = OrphanParent;
+  state.Orphans.push_back(i);
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::InitializeSearchTrees(SearchState& state)
+{
+  state.QueueFirst[0] = state.QueueFirst[1] = -1;
+  state.QueueLast[0] = state.QueueLast[1] = -1;
+  state.Orphans.clear();
+  state.Time = 0;
+
+  // Every node with residual capacity to a terminal is a root of that terminal's tree. When
+  // continuing from a previous flow, the edge residuals are kept and only the trees are regrown.
+  for(int i = state.Begin; i < state.End; ++i)
+    {
+    Node& node = this->Nodes[i];
+    node.Next = NotActive;
+    node.IsMarked = false;
+    node.TS = state.Time;
+    if(node.TerminalCapacity > 0)
+      {
+      node.IsSink = false;
+      node.Parent = TerminalParent;
+      node.Distance = 1;
+      SetActive(state, i);
+      }
+    else if(node.TerminalCapacity < 0)
+      {
+      node.IsSink = true;
+      node.Parent = TerminalParent;
+      node.Distance = 1;
+      SetActive(state, i);
+      }
+    else
+      {
+      node.Parent = NoParent;
+      }
+    }
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::ReuseSearchTrees(SearchState& state)
+{
+  // The trees of the last search are still valid, except around the marked nodes whose terminal capacity changed
+  for(unsigned int m = 0; m < this->MarkedNodes.size(); ++m)
+    {
+    const int i = this->MarkedNodes[m];
+    if(!state.Contains(i))
+      {
+      continue;
+      }
+    Node& node = this->Nodes[i];
+    node.IsMarked = false;
+    SetActive(state, i);
+
+    if(node.TerminalCapacity == 0)
+      {
+      // The node is no longer a root, so it has to find a new parent (or become free)
+      if(node.Parent != NoParent)
+        {
+        SetOrphanRear(state, i);
+        }
+      continue;
+      }
+
+    // A node that moves to the other tree (or out of no tree) takes its children's parent away, and can now
+    // be reached from its neighbors in the other tree
+    const bool isSink = node.TerminalCapacity < 0;
+    if(node.Parent == NoParent || node.IsSink != isSink)
+      {
+      node.IsSink = isSink;
+      for(int a0 = Self().FirstArc(i); a0 >= 0; a0 = Self().NextArc(a0))
+        {
+        int j = Self().Head(a0);
+        if(!state.Contains(j) || this->Nodes[j].IsMarked)
+          {
+          continue;
+          }
+        if(this->Nodes[j].Parent == Self().Sister(a0))
+          {
+          SetOrphanRear(state, j);
+          }
+        if(this->Nodes[j].Parent != NoParent && this->Nodes[j].IsSink != isSink &&
+           Self().ResidualCapacity(isSink ? Self().Sister(a0) : a0) != 0)
+          {
+          SetActive(state, j);
+          }
+        }
+      }
+    node.Parent = TerminalParent;
+    node.TS = state.Time;
+    node.Distance = 1;
+    }
+
+  AdoptOrphans(state);
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::AdoptOrphans(SearchState& state)
+{
+  while(!state.Orphans.empty())
+    {
+    int orphan = state.Orphans.front();
+    state.Orphans.pop_front();
+    state.NumberOfOrphans++;
+    if(this->Nodes[orphan].IsSink)
+      {
+      ProcessSinkOrphan(state, orphan);
+      }
+    else
+      {
+      ProcessSourceOrphan(state, orphan);
+      }
+    }
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::SolveBlock(SearchState& state)
+{
+  InitializeSearchTrees(state);
+  MaxFlow(state);
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::MergeBlocks(SearchState& state, const int seam)
+{
+  // The trees of the two blocks [Begin, seam) and [seam, End) are valid in the merged block, and the searches of the
+  // blocks were only blind to the arcs across the seam. Only the tree nodes at the end of such an arc can grow.
+  const int span = Self().GetMaximumArcSpan();
+  const int begin = std::max(state.Begin, seam - span);
+  const int end = std::min(state.End, seam + span);
+  for(int i = begin; i < end; ++i)
+    {
+    if(this->Nodes[i].Parent == NoParent)
+      {
+      continue;
+      }
+    for(int a = Self().FirstArc(i); a >= 0; a = Self().NextArc(a))
+      {
+      int j = Self().Head(a);
+      if(state.Contains(j) && (i < seam) != (j < seam))
+        {
+        SetActive(state, i);
+        break;
+        }
+      }
+    }
+
+  MaxFlow(state);
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::Augment(SearchState& state, const int middleArc)
+{
+  // The parent arc of a node points from the node to its parent.
+
+  // Find the bottleneck capacity
+  float bottleneck = Self().ResidualCapacity(middleArc);
+
+  // Source tree
+  int i = Self().Head(Self().Sister(middleArc));
+  while(this->Nodes[i].Parent != TerminalParent)
+    {
+    int a = this->Nodes[i].Parent;
+    bottleneck = std::min(bottleneck, Self().ResidualCapacity(Self().Sister(a)));
+    i = Self().Head(a);
+    }
+  bottleneck = std::min(bottleneck, this->Nodes[i].TerminalCapacity);
+
+  // Sink tree
+  i = Self().Head(middleArc);
+  while(this->Nodes[i].Parent != TerminalParent)
+    {
+    int a = this->Nodes[i].Parent;
+    bottleneck = std::min(bottleneck, Self().ResidualCapacity(a));
+    i = Self().Head(a);
+    }
+  bottleneck = std::min(bottleneck, -this->Nodes[i].TerminalCapacity);
+
+  // Augment
+  Self().ResidualCapacity(Self().Sister(middleArc)) += bottleneck;
+  Self().ResidualCapacity(middleArc) -= bottleneck;
+
+  // Source tree
+  i = Self().Head(Self().Sister(middleArc));
+  while(this->Nodes[i].Parent != TerminalParent)
+    {
+    int a = this->Nodes[i].Parent;
+    Self().ResidualCapacity(a) += bottleneck;
+    Self().ResidualCapacity(Self().Sister(a)) -= bottleneck;
+    int parent = Self().Head(a);
+    if(Self().ResidualCapacity(Self().Sister(a)) == 0)
+      {
+      SetOrphanFront(state, i);
+      }
+    i = parent;
+    }
+  this->Nodes[i].TerminalCapacity -= bottleneck;
+  if(this->Nodes[i].TerminalCapacity == 0)
+    {
+    SetOrphanFront(state, i);
+    }
+
+  // Sink tree
+  i = Self().Head(middleArc);
+  while(this->Nodes[i].Parent != TerminalParent)
+    {
+    int a = this->Nodes[i].Parent;
+    Self().ResidualCapacity(Self().Sister(a)) += bottleneck;
+    Self().ResidualCapacity(a) -= bottleneck;
+    int parent = Self().Head(a);
+    if(Self().ResidualCapacity(a) == 0)
+      {
+      SetOrphanFront(state, i);
+      }
+    i = parent;
+    }
+  this->Nodes[i].TerminalCapacity += bottleneck;
+  if(this->Nodes[i].TerminalCapacity == 0)
+    {
+    SetOrphanFront(state, i);
+    }
+
+  state.Flow += bottleneck;
+  state.NumberOfAugmentations++;
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::ProcessSourceOrphan(SearchState& state, const int i)
+{
+  const int infiniteDistance = std::numeric_limits<int>::max();
+
+  int minArc = -1;
+  int minDistance = infiniteDistance;
+
+  // Try to find a new valid parent
+  for(int a0 = Self().FirstArc(i); a0 >= 0; a0 = Self().NextArc(a0))
+    {
+    int j = Self().Head(a0);
+    if(!state.Contains(j) || Self().ResidualCapacity(Self().Sister(a0)) == 0 ||
+       this->Nodes[j].IsSink || this->Nodes[j].Parent == NoParent)
+      {
+      continue;
+      }
+
+    // Check that j originates from the source, and compute its distance
+    int d = 0;
+    while(true)
+      {
+      if(this->Nodes[j].TS == state.Time)
+        {
+        d += this->Nodes[j].Distance;
+        break;
+        }
+      int a = this->Nodes[j].Parent;
+      d++;
+      if(a == TerminalParent)
+        {
+        this->Nodes[j].TS = state.Time;
+        this->Nodes[j].Distance = 1;
+        break;
+        }
+      if(a == OrphanParent)
+        {
+        d = infiniteDistance;
+        break;
+        }
+      j = Self().Head(a);
+      }
+
+    if(d < infiniteDistance)
+      {
+      if(d < minDistance)
+        {
+        minArc = a0;
+        minDistance = d;
+        }
+      // Set the marks along the path
+      for(j = Self().Head(a0); this->Nodes[j].TS != state.Time; j = Self().Head(this->Nodes[j].Parent))
+        {
+        this->Nodes[j].TS = state.Time;
+        this->Nodes[j].Distance = d--;
+        }
+      }
+    }
+
+  if(minArc >= 0)
+    {
+    this->Nodes[i].Parent = minArc;
+    this->Nodes[i].TS = state.Time;
+    this->Nodes[i].Distance = minDistance + 1;
+    return;
+    }
+
+  // No parent was found, so the node becomes free. Its neighbors that could grow into it are
+  // activated, and its children become orphans.
+  this->Nodes[i].Parent = NoParent;
+  for(int a0 = Self().FirstArc(i); a0 >= 0; a0 = Self().NextArc(a0))
+    {
+    int j = Self().Head(a0);
+    if(!state.Contains(j))
+      {
+      continue;
+      }
+    int a = this->Nodes[j].Parent;
+    if(this->Nodes[j].IsSink || a == NoParent)
+      {
+      continue;
+      }
+    if(Self().ResidualCapacity(Self().Sister(a0)) != 0)
+      {
+      SetActive(state, j);
+      }
+    if(a != TerminalParent && a != OrphanParent && Self().Head(a) == i)
+      {
+      SetOrphanRear(state, j);
+      }
+    }
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::ProcessSinkOrphan(SearchState& state, const int i)
+{
+  const int infiniteDistance = std::numeric_limits<int>::max();
+
+  int minArc = -1;
+  int minDistance = infiniteDistance;
+
+  // Try to find a new valid parent
+  for(int a0 = Self().FirstArc(i); a0 >= 0; a0 = Self().NextArc(a0))
+    {
+    int j = Self().Head(a0);
+    if(!state.Contains(j) || Self().ResidualCapacity(a0) == 0 ||
+       !this->Nodes[j].IsSink || this->Nodes[j].Parent == NoParent)
+      {
+      continue;
+      }
+
+    // Check that j originates from the sink, and compute its distance
+    int d = 0;
+    while(true)
+      {
+      if(this->Nodes[j].TS == state.Time)
+        {
+        d += this->Nodes[j].Distance;
+        break;
+        }
+      int a = this->Nodes[j].Parent;
+      d++;
+      if(a == TerminalParent)
+        {
+        this->Nodes[j].TS = state.Time;
+        this->Nodes[j].Distance = 1;
+        break;
+        }
+      if(a == OrphanParent)
+        {
+        d = infiniteDistance;
+        break;
+        }
+      j = Self().Head(a);
+      }
+
+    if(d < infiniteDistance)
+      {
+      if(d < minDistance)
+        {
+        minArc = a0;
+        minDistance = d;
+        }
+      // Set the marks along the path
+      for(j = Self().Head(a0); this->Nodes[j].TS != state.Time; j = Self().Head(this->Nodes[j].Parent))
+        {
+        this->Nodes[j].TS = state.Time;
+        this->Nodes[j].Distance = d--;
+        }
+      }
+    }
+
+  if(minArc >= 0)
+    {
+    this->Nodes[i].Parent = minArc;
+    this->Nodes[i].TS = state.Time;
+    this->Nodes[i].Distance = minDistance + 1;
+    return;
+    }
+
+  // No parent was found, so the node becomes free.
+  this->Nodes[i].Parent = NoParent;
+  for(int a0 = Self().FirstArc(i); a0 >= 0; a0 = Self().NextArc(a0))
+    {
+    int j = Self().Head(a0);
+    if(!state.Contains(j))
+      {
+      continue;
+      }
+    int a = this->Nodes[j].Parent;
+    if(!this->Nodes[j].IsSink || a == NoParent)
+      {
+      continue;
+      }
+    if(Self().ResidualCapacity(a0) != 0)
+      {
+      SetActive(state, j);
+      }
+    if(a != TerminalParent && a != OrphanParent && Self().Head(a) == i)
+      {
+      SetOrphanRear(state, j);
+      }
+    }
+}
+
+template <typename TGraph>
+void MaxFlowBase<TGraph>::MaxFlow(SearchState& state)
+{
+  int currentNode = -1;
+
+  while(true)
+    {
+    // The trees are consistent here (the orphans of the last augmentation have been adopted), so the
+    // search can stop without undoing anything
+    if((state.Time & 1023) == 0 && AbortRequested())
+      {
+      break;
+      }
+
+    int i = currentNode;
+    if(i >= 0)
+      {
+      this->Nodes[i].Next = NotActive; // Remove the active flag
+      if(this->Nodes[i].Parent == NoParent)
+        {
+        i = -1;
+        }
+      }
+    if(i < 0)
+      {
+      i = NextActive(state);
+      if(i < 0)
+        {
+        break;
+        }
+      }
+
+    // Growth: look for an arc that connects the source tree and the sink tree
+    int middleArc = -1;
+    if(!this->Nodes[i].IsSink)
+      {
+      for(int a = Self().FirstArc(i); a >= 0; a = Self().NextArc(a))
+        {
+        int j = Self().Head(a);
+        if(!state.Contains(j) || Self().ResidualCapacity(a) == 0)
+          {
+          continue;
+          }
+        if(this->Nodes[j].Parent == NoParent)
+          {
+          this->Nodes[j].IsSink = false;
+          this->Nodes[j].Parent = Self().Sister(a);
+          this->Nodes[j].TS = this->Nodes[i].TS;
+          this->Nodes[j].Distance = this->Nodes[i].Distance + 1;
+          SetActive(state, j);
+          }
+        else if(this->Nodes[j].IsSink)
+          {
+          middleArc = a;
+          break;
+          }
+        else if(this->Nodes[j].TS <= this->Nodes[i].TS && this->Nodes[j].Distance > this->Nodes[i].Distance)
+          {
+          // Heuristic: try to make the distance from j to the source shorter
+          this->Nodes[j].Parent = Self().Sister(a);
+          this->Nodes[j].TS = this->Nodes[i].TS;
+          this->Nodes[j].Distance = this->Nodes[i].Distance + 1;
+          }
+        }
+      }
+    else
+      {
+      for(int a = Self().FirstArc(i); a >= 0; a = Self().NextArc(a))
+        {
+        int j = Self().Head(a);
+        if(!state.Contains(j) || Self().ResidualCapacity(Self().Sister(a)) == 0)
+          {
+          continue;
+          }
+        if(this->Nodes[j].Parent == NoParent)
+          {
+          this->Nodes[j].IsSink = true;
+          this->Nodes[j].Parent = Self().Sister(a);
+          this->Nodes[j].TS = this->Nodes[i].TS;
+          this->Nodes[j].Distance = this->Nodes[i].Distance + 1;
+          SetActive(state, j);
+          }
+        else if(!this->Nodes[j].IsSink)
+          {
+          middleArc = Self().Sister(a);
+          break;
+          }
+        else if(this->Nodes[j].TS <= this->Nodes[i].TS && this->Nodes[j].Distance > this->Nodes[i].Distance)
+          {
+          // Heuristic: try to make the distance from j to the sink shorter
+          this->Nodes[j].Parent = Self().Sister(a);
+          this->Nodes[j].TS = this->Nodes[i].TS;
+          this->Nodes[j].Distance = this->Nodes[i].Distance + 1;
+          }
+        }
+      }
+
+    state.Time++;
+
+    if(middleArc < 0)
+      {
+      currentNode = -1;
+      continue;
+      }
+
+    // Keep i active while augmenting so that it is not added to the queue again
+    this->Nodes[i].Next = i;
+    currentNode = i;
+
+    Augment(state, middleArc);
+
+    if(this->ProgressCallback && state.NumberOfAugmentations % ProgressInterval == 0)
+      {
+      this->ProgressCallback(this->ReportedAugmentations += ProgressInterval);
+      }
+
+    AdoptOrphans(state);
+    }
+}
+
+template <typename TGraph>
+float MaxFlowBase<TGraph>::MaxFlow()
+{
+  const int numberOfNodes = this->Nodes.size();
+
+  // Blocks smaller than this are not worth a thread
+  const int minimumNodesPerBlock = 4096;
+  unsigned int numberOfBlocks = std::min<unsigned int>(this->NumberOfThreads,
+                                                       std::max(numberOfNodes / minimumNodesPerBlock, 1));
+
+  // The boundaries of the blocks, as node ids
+  std::vector<int> boundaries;
+  for(unsigned int block = 0; block <= numberOfBlocks; ++block)
+    {
+    boundaries.push_back(static_cast<long long>(numberOfNodes) * block / numberOfBlocks);
+    }
+
+  this->NumberOfAugmentations = 0;
+  this->NumberOfOrphans = 0;
+  this->ReportedAugmentations = 0;
+  this->Aborted = false;
+
+  // The marks of the searches only grow while the trees are reused
+  if(this->Time > std::numeric_limits<int>::max() / 2)
+    {
+    this->SearchTreesAreCurrent = false;
+    }
+
+  if(this->SearchTreesAreCurrent)
+    {
+    // Repairing the trees only touches the graph around the marked nodes, so a re-cut is not split into blocks
+    SearchState state(0, numberOfNodes);
+    state.Time = this->Time + 1;
+    ReuseSearchTrees(state);
+    MaxFlow(state);
+
+    this->Flow += state.Flow;
+    this->NumberOfAugmentations += state.NumberOfAugmentations;
+    this->NumberOfOrphans += state.NumberOfOrphans;
+    this->Time = state.Time;
+    }
+  else
+    {
+    this->Time = 0;
+
+    // Solve the blocks, then merge neighboring blocks pairwise and continue from their flow and trees
+    // until a single block covers the whole graph. Blocks that are being solved at the same time
+    // are disjoint, and so are all of the nodes and arcs that their searches touch.
+    // seams[block] is the boundary between the two halves of a merged block (its End if it has one half).
+    std::vector<int> seams;
+    while(true)
+      {
+      std::vector<SearchState> states;
+      for(unsigned int block = 0; block + 1 < boundaries.size(); ++block)
+        {
+        states.push_back(SearchState(boundaries[block], boundaries[block + 1]));
+        states.back().Time = this->Time + 1;
+        }
+
+      if(states.size() == 1)
+        {
+        if(seams.empty())
+          {
+          SolveBlock(states[0]);
+          }
+        else
+          {
+          MergeBlocks(states[0], seams[0]);
+          }
+        }
+      else
+        {
+        std::vector<std::thread> threads;
+        for(unsigned int block = 0; block < states.size(); ++block)
+          {
+          if(seams.empty())
+            {
+            threads.push_back(std::thread(&MaxFlowBase::SolveBlock, this, std::ref(states[block])));
+            }
+          else
+            {
+            threads.push_back(std::thread(&MaxFlowBase::MergeBlocks, this, std::ref(states[block]), seams[block]));
+            }
+          }
+        for(unsigned int block = 0; block < threads.size(); ++block)
+          {
+          threads[block].join();
+          }
+        }
+
+      for(unsigned int block = 0; block < states.size(); ++block)
+        {
+        this->Flow += states[block].Flow;
+        this->NumberOfAugmentations += states[block].NumberOfAugmentations;
+        this->NumberOfOrphans += states[block].NumberOfOrphans;
+        this->Time = std::max(this->Time, states[block].Time);
+        }
+
+      if(states.size() == 1 || AbortRequested())
+        {
+        break;
+        }
+
+      // Merge pairs of neighboring blocks by dropping every other inner boundary
+      std::vector<int> mergedBoundaries;
+      seams.clear();
+      for(unsigned int boundary = 0; boundary + 1 < boundaries.size(); boundary += 2)
+        {
+        mergedBoundaries.push_back(boundaries[boundary]);
+        seams.push_back(boundaries[boundary + 1]);
+        }
+      mergedBoundaries.push_back(numberOfNodes);
+      boundaries = mergedBoundaries;
+      }
+    }
+
+  this->MarkedNodes.clear();
+  this->Aborted = AbortRequested();
+
+  // An aborted search leaves active nodes and orphans behind, and the trees of unmerged blocks ignore the
+  // edges between them, so the next MaxFlow() grows the trees from scratch
+  this->SearchTreesAreCurrent = !this->Aborted;
+
+  return this->Flow;
+}
+
+#endif
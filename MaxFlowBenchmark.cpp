@@ -0,0 +1,204 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Time the max-flow of a size x size grid on its own, without building an image graph cut:
+ *
+ *   MaxFlowBenchmark [size] [scalingSize]
+ *
+ * The graph is that of a synthetic image (a bright disk on a dark background, both with gaussian noise), with
+ * n-weights from the intensity differences and t-weights from the distance of each pixel to the two intensities.
+ * The default size is 4000.
+ *
+ * After a first cut, a square of background pixels of 1 to 10^6 pixels (up to a quarter of the graph) is made a
+ * source seed and the graph is cut again, which continues from the flow and search trees of the last cut. The seed is
+ * then removed again (an untimed cut).
+ *
+ * Then the graph of a scalingSize x scalingSize image (7072, or 50 megapixels, by default; 0 skips it) is cut from
+ * scratch with 1, 2, 4, 8, 16 and 32 threads. It needs about 2.2 GB.
+ *
+ * The results are written to stdout as CSV: the time of the first cut, one line per edit size with the time of the
+ * cut after the edit, and one line per number of threads.
+*/
+
+// Custom
+#include "GridMaxFlowGraph.h"
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+typedef GridMaxFlowGraph<2> GraphType;
+
+static double SecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** The intensities of the synthetic image, in buffer order. */
+static std::vector<float> CreateImage(const int size)
+{
+  std::mt19937 generator(0);
+  std::normal_distribution<float> noise(0.0f, 20.0f);
+
+  std::vector<float> image(static_cast<std::size_t>(size) * size);
+  const double radius = size / 4.0;
+  for(int y = 0; y < size; ++y)
+    {
+    for(int x = 0; x < size; ++x)
+      {
+      double dx = x - size / 2.0;
+      double dy = y - size / 2.0;
+      image[static_cast<std::size_t>(y) * size + x] = ((dx * dx + dy * dy < radius * radius) ? 200.0f : 50.0f) +
+                                                      noise(generator);
+      }
+    }
+  return image;
+}
+
+/** The t-weights of a pixel of intensity 'value': it is cheaper to cut the terminal of the closer intensity. */
+static float GetSourceWeight(const float value)
+{
+  return std::min(std::abs(value - 50.0f) / 150.0f, 1.0f);
+}
+
+static float GetSinkWeight(const float value)
+{
+  return std::min(std::abs(value - 200.0f) / 150.0f, 1.0f);
+}
+
+/** Set all of the weights of 'graph' from the image. */
+static void CreateGraph(const std::vector<float>& image, const int size, GraphType& graph)
+{
+  graph.Reset(size, size);
+
+  const float sigma = 20.0f;
+  for(int y = 0; y < size; ++y)
+    {
+    for(int x = 0; x < size; ++x)
+      {
+      const int i = y * size + x;
+      graph.SetTerminalWeights(i, GetSourceWeight(image[i]), GetSinkWeight(image[i]));
+      if(x + 1 < size)
+        {
+        float difference = image[i] - image[i + 1];
+        graph.SetEdgeWeight(i, GraphType::RIGHT, std::exp(-difference * difference / (2 * sigma * sigma)));
+        }
+      if(y + 1 < size)
+        {
+        float difference = image[i] - image[i + size];
+        graph.SetEdgeWeight(i, GraphType::DOWN, std::exp(-difference * difference / (2 * sigma * sigma)));
+        }
+      }
+    }
+}
+
+/** Re-cut the graph of a size x size image after edits of growing size. */
+static void RunEdits(const int size)
+{
+  const std::vector<float> image = CreateImage(size);
+  GraphType graph;
+  CreateGraph(image, size, graph);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  graph.MaxFlow();
+  std::cout << "first," << size << "," << size << ",1,0," << SecondsSince(start) << std::endl;
+
+  // The edits are squares in the top left quarter, which is background
+  const int numberOfNodes = size * size;
+  for(int editedPixels = 1; editedPixels <= 1000000 && editedPixels <= numberOfNodes / 4; editedPixels *= 10)
+    {
+    const int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(editedPixels))));
+    const int corner = std::max(size / 4 - side, 0) / 2;
+    std::vector<int> edit;
+    for(int y = corner; y < corner + side; ++y)
+      {
+      for(int x = corner; x < corner + side && static_cast<int>(edit.size()) < editedPixels; ++x)
+        {
+        edit.push_back(y * size + x);
+        }
+      }
+
+    for(unsigned int e = 0; e < edit.size(); ++e)
+      {
+      graph.SetTerminalWeights(edit[e], 1e6f, 0.0f);
+      }
+    start = std::chrono::steady_clock::now();
+    graph.MaxFlow();
+    std::cout << "edit," << size << "," << size << ",1," << edit.size() << "," << SecondsSince(start) << std::endl;
+
+    for(unsigned int e = 0; e < edit.size(); ++e)
+      {
+      graph.SetTerminalWeights(edit[e], GetSourceWeight(image[edit[e]]), GetSinkWeight(image[edit[e]]));
+      }
+    graph.MaxFlow();
+    }
+}
+
+/** Cut the graph of a size x size image from scratch with 1 to 32 threads. */
+static void RunThreads(const int size)
+{
+  GraphType graph;
+  CreateGraph(CreateImage(size), size, graph);
+
+  for(unsigned int numberOfThreads = 1; numberOfThreads <= 32; numberOfThreads *= 2)
+    {
+    graph.ResetFlow();
+    graph.SetNumberOfThreads(numberOfThreads);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    graph.MaxFlow();
+    std::cout << "threads," << size << "," << size << "," << numberOfThreads << ",0," << SecondsSince(start)
+              << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+  int size = 4000;
+  if(argc > 1)
+    {
+    size = atoi(argv[1]);
+    }
+  int scalingSize = 7072;
+  if(argc > 2)
+    {
+    scalingSize = atoi(argv[2]);
+    }
+  if(argc > 3 || size < 16 || (scalingSize != 0 && scalingSize < 16))
+    {
+    std::cerr << "Usage: " << argv[0] << " [size >= 16] [scalingSize >= 16, or 0]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << std::fixed;
+  std::cout.precision(6);
+  std::cout << "cut,width,height,threads,edited_pixels,maxflow_s" << std::endl;
+  std::cerr << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+  RunEdits(size);
+  if(scalingSize > 0)
+    {
+    RunThreads(scalingSize);
+    }
+
+  return EXIT_SUCCESS;
+}
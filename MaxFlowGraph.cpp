@@ -0,0 +1,66 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MaxFlowGraph.h"
+
+// STL
+#include <algorithm>
+#include <cstdlib>
+
+void MaxFlowGraph::Reset(const unsigned int numberOfNodes, const unsigned int expectedNumberOfEdges)
+{
+  ResetNodes(numberOfNodes);
+
+  this->FirstArcs.assign(numberOfNodes, -1);
+
+  this->Arcs.clear();
+  this->Arcs.reserve(2 * expectedNumberOfEdges);
+
+  this->MaximumArcSpan = 0;
+}
+
+void MaxFlowGraph::AddEdge(const NodeId i, const NodeId j, const float capacity, const float reverseCapacity)
+{
+  Arc arc;
+  arc.Head = j;
+  arc.Next = this->FirstArcs[i];
+  arc.ResidualCapacity = capacity;
+  this->FirstArcs[i] = this->Arcs.size();
+  this->Arcs.push_back(arc);
+
+  Arc reverseArc;
+  reverseArc.Head = i;
+  reverseArc.Next = this->FirstArcs[j];
+  reverseArc.ResidualCapacity = reverseCapacity;
+  this->FirstArcs[j] = this->Arcs.size();
+  this->Arcs.push_back(reverseArc);
+
+  this->MaximumArcSpan = std::max(this->MaximumArcSpan, std::abs(i - j));
+
+  // The search trees of the last MaxFlow() do not know about the new arcs
+  this->SearchTreesAreCurrent = false;
+}
+
+unsigned long long MaxFlowGraph::GetNumberOfEdges() const
+{
+  return this->Arcs.size() / 2;
+}
+
+std::size_t MaxFlowGraph::GetMemorySize() const
+{
+  return GetNodesMemorySize() + this->FirstArcs.capacity() * sizeof(int) + this->Arcs.capacity() * sizeof(Arc);
+}
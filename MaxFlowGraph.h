@@ -0,0 +1,98 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* A max-flow graph with an arbitrary set of edges, stored as adjacency lists.
+ * See MaxFlowBase for the algorithm. For a 4-connected image grid, GridMaxFlowGraph
+ * needs much less memory.
+*/
+
+#ifndef MaxFlowGraph_H
+#define MaxFlowGraph_H
+
+#include "MaxFlowBase.h"
+
+// STL
+#include <cstddef>
+#include <vector>
+
+class MaxFlowGraph : public MaxFlowBase<MaxFlowGraph>
+{
+public:
+
+  /** Remove all edges and flow and create 'numberOfNodes' nodes with no terminal weights.
+   *  'expectedNumberOfEdges' only reserves memory. */
+  void Reset(const unsigned int numberOfNodes, const unsigned int expectedNumberOfEdges = 0);
+
+  /** Add an edge i->j with the given capacity and an edge j->i with 'reverseCapacity'. */
+  void AddEdge(const NodeId i, const NodeId j, const float capacity, const float reverseCapacity);
+
+  unsigned long long GetNumberOfEdges() const;
+
+  /** The bytes allocated for the nodes and the arcs. */
+  std::size_t GetMemorySize() const;
+
+private:
+  friend class MaxFlowBase<MaxFlowGraph>;
+
+  struct Arc
+  {
+    int Head;
+    int Next;
+    float ResidualCapacity;
+  };
+
+  /** The first outgoing arc of every node, or -1. */
+  std::vector<int> FirstArcs;
+
+  std::vector<Arc> Arcs;
+
+  /** The largest difference between the ids of the two nodes of an edge. */
+  int MaximumArcSpan;
+
+  int FirstArc(const int i) const
+  {
+    return this->FirstArcs[i];
+  }
+
+  int NextArc(const int a) const
+  {
+    return this->Arcs[a].Next;
+  }
+
+  int Head(const int a) const
+  {
+    return this->Arcs[a].Head;
+  }
+
+  /** Arcs are added in pairs, so the reverse of arc 'a' is 'a^1'. */
+  int Sister(const int a) const
+  {
+    return a ^ 1;
+  }
+
+  float& ResidualCapacity(const int a)
+  {
+    return this->Arcs[a].ResidualCapacity;
+  }
+
+  int GetMaximumArcSpan() const
+  {
+    return this->MaximumArcSpan;
+  }
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PixelRuns.h"
+
+// STL
+#include <algorithm>
+
+namespace PixelRuns
+{
+
+void Encode(const std::vector<unsigned int>& offsets, std::vector<unsigned int>& runs)
+{
+  std::size_t i = 0;
+  while(i < offsets.size())
+    {
+    std::size_t end = i + 1;
+    while(end < offsets.size() && offsets[end] == offsets[end - 1] + 1)
+      {
+      end++;
+      }
+    runs.push_back(offsets[i]);
+    runs.push_back(static_cast<unsigned int>(end - i));
+    i = end;
+    }
+}
+
+void Encode(const unsigned char* const labels, const std::size_t count, const unsigned char label,
+            std::vector<unsigned int>& runs)
+{
+  std::size_t i = 0;
+  while(i < count)
+    {
+    const unsigned char* first = std::find(labels + i, labels + count, label);
+    if(first == labels + count)
+      {
+      break;
+      }
+    const unsigned char* last = std::find_if(first, labels + count,
+                                             [label](unsigned char value) { return value != label; });
+    runs.push_back(static_cast<unsigned int>(first - labels));
+    runs.push_back(static_cast<unsigned int>(last - first));
+    i = last - labels;
+    }
+}
+
+void Decode(const unsigned int* const runs, const std::size_t numberOfRuns, std::vector<unsigned int>& offsets)
+{
+  offsets.reserve(offsets.size() + GetNumberOfPixels(runs, numberOfRuns));
+  for(std::size_t run = 0; run < numberOfRuns; ++run)
+    {
+    for(unsigned int offset = runs[2 * run]; offset < runs[2 * run] + runs[2 * run + 1]; ++offset)
+      {
+      offsets.push_back(offset);
+      }
+    }
+}
+
+void Fill(const unsigned int* const runs, const std::size_t numberOfRuns, const unsigned char label,
+          unsigned char* const labels)
+{
+  for(std::size_t run = 0; run < numberOfRuns; ++run)
+    {
+    std::fill(labels + runs[2 * run], labels + runs[2 * run] + runs[2 * run + 1], label);
+    }
+}
+
+std::size_t GetNumberOfPixels(const unsigned int* const runs, const std::size_t numberOfRuns)
+{
+  std::size_t numberOfPixels = 0;
+  for(std::size_t run = 0; run < numberOfRuns; ++run)
+    {
+    numberOfPixels += runs[2 * run + 1];
+    }
+  return numberOfPixels;
+}
+
+} // namespace PixelRuns
@@ -0,0 +1,52 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* A set of pixels as runs of consecutive offsets (in buffer order). A stroke or a segment covers long horizontal
+ * spans of pixels, so it takes one run (two numbers) per row that it crosses instead of one number per pixel, and
+ * a run is decoded without visiting any other pixel.
+ *
+ * The runs are stored as (first offset, length) pairs in a flat array.
+*/
+
+#ifndef PixelRuns_H
+#define PixelRuns_H
+
+// STL
+#include <cstddef>
+#include <vector>
+
+namespace PixelRuns
+{
+  /** Append the runs of 'offsets', which must be sorted and distinct, to 'runs'. */
+  void Encode(const std::vector<unsigned int>& offsets, std::vector<unsigned int>& runs);
+
+  /** Append the runs of the pixels of 'labels' (one byte per pixel, 'count' pixels) that are 'label' to 'runs'. */
+  void Encode(const unsigned char* const labels, const std::size_t count, const unsigned char label,
+              std::vector<unsigned int>& runs);
+
+  /** Append the offsets of the 'numberOfRuns' runs of 'runs' to 'offsets'. */
+  void Decode(const unsigned int* const runs, const std::size_t numberOfRuns, std::vector<unsigned int>& offsets);
+
+  /** Set the pixels of the runs to 'label' in 'labels'. */
+  void Fill(const unsigned int* const runs, const std::size_t numberOfRuns, const unsigned char label,
+            unsigned char* const labels);
+
+  /** The number of pixels in the runs. */
+  std::size_t GetNumberOfPixels(const unsigned int* const runs, const std::size_t numberOfRuns);
+}
+
+#endif
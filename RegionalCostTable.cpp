@@ -0,0 +1,191 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "RegionalCostTable.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const unsigned long long RegionalCostTable::MaximumNumberOfDenseBins;
+
+const unsigned long long RegionalCostTable::MaximumNumberOfBins;
+
+const unsigned int RegionalCostTable::EmptySlot;
+
+RegionalCostTable::RegionalCostTable() : Sparse(false), SlotMask(1), HashShift(31)
+{
+  this->EmptyBinCosts[0] = 0;
+  this->EmptyBinCosts[1] = 0;
+}
+
+bool RegionalCostTable::IsSparse() const
+{
+  return this->Sparse;
+}
+
+int RegionalCostTable::GetMaximumNumberOfHistogramBins(const unsigned int numberOfComponents)
+{
+  if(numberOfComponents <= 1)
+    {
+    return std::numeric_limits<int>::max();
+    }
+
+  // Start from the root and correct its rounding, counting the bins without overflowing the product
+  unsigned long long bins = static_cast<unsigned long long>(
+    std::pow(static_cast<double>(MaximumNumberOfBins), 1.0 / numberOfComponents));
+  while(bins > 1 && CountBins(bins, numberOfComponents) > MaximumNumberOfBins)
+    {
+    bins--;
+    }
+  while(CountBins(bins + 1, numberOfComponents) <= MaximumNumberOfBins)
+    {
+    bins++;
+    }
+  return static_cast<int>(bins);
+}
+
+unsigned long long RegionalCostTable::CountBins(const unsigned long long bins, const unsigned int numberOfComponents)
+{
+  // Stop as soon as the product exceeds MaximumNumberOfBins, so it never overflows
+  unsigned long long numberOfBins = 1;
+  for(unsigned int component = 0; component < numberOfComponents && numberOfBins <= MaximumNumberOfBins; ++component)
+    {
+    numberOfBins *= bins;
+    }
+  return numberOfBins;
+}
+
+RegionalCostTable::HistogramType RegionalCostTable::CreateHistogram(const std::vector<unsigned int>& bins)
+{
+  std::vector<unsigned int> sortedBins(bins);
+  std::sort(sortedBins.begin(), sortedBins.end());
+
+  HistogramType histogram;
+  for(unsigned int i = 0; i < sortedBins.size(); ++i)
+    {
+    if(i == 0 || sortedBins[i] != sortedBins[i - 1])
+      {
+      histogram.push_back(std::make_pair(sortedBins[i], 0u));
+      }
+    histogram.back().second++;
+    }
+  return histogram;
+}
+
+void RegionalCostTable::Create(const unsigned long long numberOfBins, const std::vector<unsigned int>& sourceBins,
+                               const std::vector<unsigned int>& sinkBins)
+{
+  CreateFromHistograms(numberOfBins, CreateHistogram(sourceBins), CreateHistogram(sinkBins));
+}
+
+void RegionalCostTable::CreateFromHistograms(const unsigned long long numberOfBins,
+                                             const HistogramType& sourceHistogram, const HistogramType& sinkHistogram)
+{
+  // We can't use log(0), so use a tiny probability for colors that do not appear in a histogram
+  const float tinyValue = 1e-10;
+  this->EmptyBinCosts[0] = -log(tinyValue);
+  this->EmptyBinCosts[1] = -log(tinyValue);
+
+  double foregroundCount = 0;
+  for(unsigned int i = 0; i < sourceHistogram.size(); ++i)
+    {
+    foregroundCount += sourceHistogram[i].second;
+    }
+  double backgroundCount = 0;
+  for(unsigned int i = 0; i < sinkHistogram.size(); ++i)
+    {
+    backgroundCount += sinkHistogram[i].second;
+    }
+  float foregroundTotal = std::max(static_cast<float>(foregroundCount), 1.0f);
+  float backgroundTotal = std::max(static_cast<float>(backgroundCount), 1.0f);
+
+  // The number of distinct bins of the seeds bounds the number of slots that are used
+  unsigned int numberOfSeedBins = sourceHistogram.size() + sinkHistogram.size();
+
+  this->Sparse = numberOfBins > MaximumNumberOfDenseBins;
+  if(this->Sparse)
+    {
+    unsigned int numberOfSlots = 2;
+    this->HashShift = 31;
+    while(numberOfSlots < 2 * numberOfSeedBins)
+      {
+      numberOfSlots *= 2;
+      this->HashShift--;
+      }
+    this->SlotMask = numberOfSlots - 1;
+    this->Bins.assign(numberOfSlots, EmptySlot);
+    this->Costs.resize(2 * numberOfSlots);
+    }
+  else
+    {
+    this->Bins.clear();
+    this->Costs.resize(2 * numberOfBins);
+    for(unsigned int bin = 0; bin < numberOfBins; ++bin)
+      {
+      this->Costs[2 * bin] = this->EmptyBinCosts[0];
+      this->Costs[2 * bin + 1] = this->EmptyBinCosts[1];
+      }
+    }
+
+  // Walk both histograms at once, visiting every bin that has a seed once with its count in each histogram
+  unsigned int source = 0;
+  unsigned int sink = 0;
+  while(source < sourceHistogram.size() || sink < sinkHistogram.size())
+    {
+    unsigned int bin;
+    if(sink == sinkHistogram.size() ||
+       (source < sourceHistogram.size() && sourceHistogram[source].first < sinkHistogram[sink].first))
+      {
+      bin = sourceHistogram[source].first;
+      }
+    else
+      {
+      bin = sinkHistogram[sink].first;
+      }
+
+    unsigned int foregroundBinCount = 0;
+    if(source < sourceHistogram.size() && sourceHistogram[source].first == bin)
+      {
+      foregroundBinCount = sourceHistogram[source].second;
+      source++;
+      }
+    unsigned int backgroundBinCount = 0;
+    if(sink < sinkHistogram.size() && sinkHistogram[sink].first == bin)
+      {
+      backgroundBinCount = sinkHistogram[sink].second;
+      sink++;
+      }
+
+    unsigned int index = bin;
+    if(this->Sparse)
+      {
+      index = Hash(bin);
+      while(this->Bins[index] != EmptySlot)
+        {
+        index = (index + 1) & this->SlotMask;
+        }
+      this->Bins[index] = bin;
+      }
+
+    float sinkHistogramValue = std::max(backgroundBinCount / backgroundTotal, tinyValue);
+    float sourceHistogramValue = std::max(foregroundBinCount / foregroundTotal, tinyValue);
+    this->Costs[2 * index] = -log(sinkHistogramValue);
+    this->Costs[2 * index + 1] = -log(sourceHistogramValue);
+    }
+}
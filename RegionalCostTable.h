@@ -0,0 +1,116 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* The regional term of every histogram bin: the source weight of a pixel in a bin is the -log probability of the
+ * bin under the background histogram, and its sink weight the -log probability under the foreground histogram.
+ *
+ * Only the bins that a seed falls into have other costs than an empty bin, and there are NumberOfHistogramBins^3
+ * bins for a color image, so at high bin counts almost all of them are empty. Up to MaximumNumberOfDenseBins bins
+ * the costs are stored in an array indexed by bin. Above that only the bins of the seeds are stored, in an open
+ * addressing hash table, and all the other bins get the costs of an empty bin. Either way the histograms themselves
+ * are never stored, so the memory and the time to create the table depend on the number of seeds rather than on
+ * the number of bins.
+*/
+
+#ifndef RegionalCostTable_H
+#define RegionalCostTable_H
+
+// STL
+#include <utility>
+#include <vector>
+
+class RegionalCostTable
+{
+public:
+  RegionalCostTable();
+
+  /** The (bin, number of seed pixels) of the bins of a histogram that are not empty, in increasing order of bin. */
+  typedef std::vector<std::pair<unsigned int, unsigned int> > HistogramType;
+
+  /** Compute the costs of 'numberOfBins' bins from the bins of the source and sink seeds (one per seed pixel). */
+  void Create(const unsigned long long numberOfBins, const std::vector<unsigned int>& sourceBins,
+              const std::vector<unsigned int>& sinkBins);
+
+  /** Compute the costs of 'numberOfBins' bins from the histograms of the source and sink seeds. */
+  void CreateFromHistograms(const unsigned long long numberOfBins, const HistogramType& sourceHistogram,
+                            const HistogramType& sinkHistogram);
+
+  /** The histogram of 'bins' (one per seed pixel). */
+  static HistogramType CreateHistogram(const std::vector<unsigned int>& bins);
+
+  /** The source and sink weight of a pixel in 'bin', before they are multiplied by lambda. */
+  const float* GetCosts(const unsigned int bin) const
+  {
+    if(!this->Sparse)
+      {
+      return &this->Costs[2 * bin];
+      }
+
+    for(unsigned int slot = Hash(bin); ; slot = (slot + 1) & this->SlotMask)
+      {
+      if(this->Bins[slot] == bin)
+        {
+        return &this->Costs[2 * slot];
+        }
+      if(this->Bins[slot] == EmptySlot)
+        {
+        return this->EmptyBinCosts;
+        }
+      }
+  }
+
+  /** True if the table only stores the bins of the seeds. */
+  bool IsSparse() const;
+
+  /** 2 MB of costs. */
+  static const unsigned long long MaximumNumberOfDenseBins = 1 << 18;
+
+  /** A bin is an unsigned int, and the largest one is reserved for the empty slots of the hash table. */
+  static const unsigned long long MaximumNumberOfBins = 0xffffffff;
+
+  /** The largest number of bins per component for which the NumberOfHistogramBins^numberOfComponents bins of a
+   *  pixel with 'numberOfComponents' components do not exceed MaximumNumberOfBins. */
+  static int GetMaximumNumberOfHistogramBins(const unsigned int numberOfComponents);
+
+protected:
+
+  /** The first slot to look for 'bin' in (Fibonacci hashing, so that neighboring bins are spread out). */
+  unsigned int Hash(const unsigned int bin) const
+  {
+    return (bin * 2654435769u) >> this->HashShift;
+  }
+
+  static const unsigned int EmptySlot = 0xffffffff;
+
+  /** bins^numberOfComponents, or some number above MaximumNumberOfBins if that is larger. */
+  static unsigned long long CountBins(const unsigned long long bins, const unsigned int numberOfComponents);
+
+  bool Sparse;
+
+  /** The source (2*i) and sink (2*i+1) cost of bin i, or of the bin in slot i if Sparse. */
+  std::vector<float> Costs;
+
+  /** If Sparse, the bin in every slot (EmptySlot if none). The number of slots is a power of 2 and at least
+   *  twice the number of bins of the seeds, so a lookup usually only probes one or two slots. */
+  std::vector<unsigned int> Bins;
+  unsigned int SlotMask;
+  unsigned int HashShift;
+
+  float EmptyBinCosts[2];
+};
+
+#endif
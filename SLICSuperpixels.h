@@ -0,0 +1,109 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Over-segment an image into superpixels with SLIC ("SLIC Superpixels Compared to State-of-the-art Superpixel
+ * Methods", Achanta et al., PAMI 2012). The centers start on a grid with a spacing of SuperpixelSize pixels, and
+ * every iteration assigns each pixel to the closest of the centers of its own and the 8 surrounding grid cells,
+ * then moves each center to the mean of its pixels. Looking up the centers by grid cell (instead of visiting a
+ * window around every center) makes each pixel independent, so the rows are assigned by several threads.
+ *
+ * Afterwards every superpixel is connected: pieces smaller than a quarter of a grid cell are merged into a
+ * neighboring superpixel, and larger pieces become superpixels of their own.
+*/
+
+#ifndef SLICSuperpixels_H
+#define SLICSuperpixels_H
+
+// STL
+#include <functional>
+#include <vector>
+
+template <typename TImage>
+class SLICSuperpixels
+{
+public:
+  SLICSuperpixels();
+
+  void SetImage(TImage* const image);
+
+  /** The spacing of the initial centers, so a superpixel has about size*size pixels. The default is 16. */
+  void SetSuperpixelSize(const unsigned int size);
+
+  /** The weight of the distance between pixels relative to the difference of their colors, in the units of
+   *  the image components. Larger values give more regular superpixels. The default is 10. */
+  void SetCompactness(const float compactness);
+
+  /** The default is 10. */
+  void SetNumberOfIterations(const unsigned int numberOfIterations);
+
+  /** The default is 1. */
+  void SetNumberOfThreads(const unsigned int numberOfThreads);
+
+  void Compute();
+
+  unsigned int GetNumberOfSuperpixels() const;
+
+  /** The superpixel (0..GetNumberOfSuperpixels()-1) of every pixel, in buffer order. */
+  const std::vector<unsigned int>& GetLabels() const;
+
+protected:
+
+  /** Call function(beginRow, endRow, thread) for NumberOfThreads disjoint blocks of rows, concurrently. */
+  void ParallelForRows(const unsigned int numberOfRows,
+                       const std::function<void(unsigned int, unsigned int, unsigned int)>& function) const;
+
+  /** Move every center to the pixel with the smallest gradient in its 3x3 neighborhood, so that it does
+   *  not start on an edge. */
+  void PerturbCenters();
+
+  void AssignPixels();
+
+  void UpdateCenters();
+
+  void EnforceConnectivity();
+
+  float ComputeColorDistance(const float* const a, const float* const b) const;
+
+  typename TImage::Pointer Image;
+
+  unsigned int SuperpixelSize;
+  float Compactness;
+  unsigned int NumberOfIterations;
+  unsigned int NumberOfThreads;
+
+  unsigned int Width;
+  unsigned int Height;
+  unsigned int NumberOfComponents;
+
+  /** The number of grid cells in each direction. Center c starts in cell (c % GridWidth, c / GridWidth). */
+  unsigned int GridWidth;
+  unsigned int GridHeight;
+
+  /** The components of every pixel, only kept during Compute(). */
+  std::vector<float> Pixels;
+
+  /** x, y and the components of each center. */
+  std::vector<float> Centers;
+
+  std::vector<unsigned int> Labels;
+
+  unsigned int NumberOfSuperpixels;
+};
+
+#include "SLICSuperpixels.hpp"
+
+#endif
@@ -0,0 +1,386 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SLICSuperpixels_HPP
+#define SLICSuperpixels_HPP
+
+#include "SLICSuperpixels.h" // Appease syntax parser
+
+// Custom
+#include "ImagePixelTraits.h"
+
+// STL
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <thread>
+
+template <typename TImage>
+SLICSuperpixels<TImage>::SLICSuperpixels() : SuperpixelSize(16), Compactness(10.0f), NumberOfIterations(10),
+  NumberOfThreads(1), Width(0), Height(0), NumberOfComponents(0), GridWidth(0), GridHeight(0), NumberOfSuperpixels(0)
+{
+}
+
+template <typename TImage>
+void SLICSuperpixels<TImage>::SetImage(TImage* const image)
+{
+  this->Image = image;
+}
+
+template <typename TImage>
+void SLICSuperpixels<TImage>::SetSuperpixelSize(const unsigned int size)
+{
+  this->SuperpixelSize = std::max(size, 1u);
+}
+
+template <typename TImage>
+void SLICSuperpixels<TImage>::SetCompactness(const float compactness)
+{
+  this->Compactness = compactness;
+}
+
+template <typename TImage>
+void SLICSuperpixels<TImage>::SetNumberOfIterations(const unsigned int numberOfIterations)
+{
+  this->NumberOfIterations = numberOfIterations;
+}
+
+template <typename TImage>
+void SLICSuperpixels<TImage>::SetNumberOfThreads(const unsigned int numberOfThreads)
+{
+  this->NumberOfThreads = std::max(numberOfThreads, 1u);
+}
+
+template <typename TImage>
+unsigned int SLICSuperpixels<TImage>::GetNumberOfSuperpixels() const
+{
+  return this->NumberOfSuperpixels;
+}
+
+template <typename TImage>
+const std::vector<unsigned int>& SLICSuperpixels<TImage>::GetLabels() const
+{
+  return this->Labels;
+}
+
+template <typename TImage>
+void SLICSuperpixels<TImage>::ParallelForRows(const unsigned int numberOfRows,
+  const std::function<void(unsigned int, unsigned int, unsigned int)>& function) const
+{
+  const unsigned int numberOfThreads = std::min(this->NumberOfThreads, numberOfRows);
+  if(numberOfThreads <= 1)
+    {
+    function(0, numberOfRows, 0);
+    return;
+    }
+
+  std::vector<std::thread> threads;
+  for(unsigned int thread = 0; thread < numberOfThreads; ++thread)
+    {
+    threads.push_back(std::thread(function, thread * numberOfRows / numberOfThreads,
+                                  (thread + 1) * numberOfRows / numberOfThreads, thread));
+    }
+  for(unsigned int thread = 0; thread < numberOfThreads; ++thread)
+    {
+    threads[thread].join();
+    }
+}
+
+template <typename TImage>
+float SLICSuperpixels<TImage>::ComputeColorDistance(const float* const a, const float* const b) const
+{
+  float distance = 0;
+  for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+    {
+    float difference = a[component] - b[component];
+    distance += difference * difference;
+    }
+  return distance;
+}
+
+template <typename TImage>
+void SLICSuperpixels<TImage>::Compute()
+{
+  this->Width = this->Image->GetLargestPossibleRegion().GetSize()[0];
+  this->Height = this->Image->GetLargestPossibleRegion().GetSize()[1];
+  this->NumberOfComponents = this->Image->GetNumberOfComponentsPerPixel();
+
+  // The pixels are visited many times, so they are copied into one float buffer once
+  this->Pixels.resize(static_cast<std::size_t>(this->Width) * this->Height * this->NumberOfComponents);
+  for(std::size_t offset = 0; offset < static_cast<std::size_t>(this->Width) * this->Height; ++offset)
+    {
+    ImagePixelTraits<TImage>::GetPixel(this->Image.GetPointer(), offset,
+                                       &this->Pixels[offset * this->NumberOfComponents]);
+    }
+
+  const unsigned int size = this->SuperpixelSize;
+  this->GridWidth = (this->Width + size - 1) / size;
+  this->GridHeight = (this->Height + size - 1) / size;
+
+  const unsigned int centerSize = 2 + this->NumberOfComponents;
+  this->Centers.resize(this->GridWidth * this->GridHeight * centerSize);
+  for(unsigned int gridY = 0; gridY < this->GridHeight; ++gridY)
+    {
+    for(unsigned int gridX = 0; gridX < this->GridWidth; ++gridX)
+      {
+      float* center = &this->Centers[(gridY * this->GridWidth + gridX) * centerSize];
+      center[0] = std::min(gridX * size + size / 2, this->Width - 1);
+      center[1] = std::min(gridY * size + size / 2, this->Height - 1);
+      }
+    }
+  PerturbCenters();
+
+  this->Labels.resize(this->Width * this->Height);
+  for(unsigned int iteration = 0; iteration < this->NumberOfIterations; ++iteration)
+    {
+    AssignPixels();
+    UpdateCenters();
+    }
+  AssignPixels();
+
+  EnforceConnectivity();
+
+  std::vector<float>().swap(this->Pixels);
+}
+
+template <typename TImage>
+void SLICSuperpixels<TImage>::PerturbCenters()
+{
+  const unsigned int centerSize = 2 + this->NumberOfComponents;
+  const unsigned int numberOfCenters = this->GridWidth * this->GridHeight;
+
+  for(unsigned int c = 0; c < numberOfCenters; ++c)
+    {
+    float* center = &this->Centers[c * centerSize];
+    int bestX = center[0];
+    int bestY = center[1];
+    float bestGradient = std::numeric_limits<float>::max();
+    for(int y = static_cast<int>(center[1]) - 1; y <= static_cast<int>(center[1]) + 1; ++y)
+      {
+      for(int x = static_cast<int>(center[0]) - 1; x <= static_cast<int>(center[0]) + 1; ++x)
+        {
+        if(x < 1 || y < 1 || x + 1 >= static_cast<int>(this->Width) || y + 1 >= static_cast<int>(this->Height))
+          {
+          continue;
+          }
+        const float* pixel = &this->Pixels[(static_cast<std::size_t>(y) * this->Width + x) * this->NumberOfComponents];
+        const std::size_t rowSize = static_cast<std::size_t>(this->Width) * this->NumberOfComponents;
+        float gradient = ComputeColorDistance(pixel - this->NumberOfComponents, pixel + this->NumberOfComponents) +
+                         ComputeColorDistance(pixel - rowSize, pixel + rowSize);
+        if(gradient < bestGradient)
+          {
+          bestGradient = gradient;
+          bestX = x;
+          bestY = y;
+          }
+        }
+      }
+
+    center[0] = bestX;
+    center[1] = bestY;
+    const float* pixel =
+      &this->Pixels[(static_cast<std::size_t>(bestY) * this->Width + bestX) * this->NumberOfComponents];
+    std::copy(pixel, pixel + this->NumberOfComponents, center + 2);
+    }
+}
+
+template <typename TImage>
+void SLICSuperpixels<TImage>::AssignPixels()
+{
+  const unsigned int size = this->SuperpixelSize;
+  const unsigned int centerSize = 2 + this->NumberOfComponents;
+
+  // The spatial distance is measured in grid cells, weighted by the compactness
+  const float spatialWeight = (this->Compactness / size) * (this->Compactness / size);
+
+  ParallelForRows(this->Height, [this, size, centerSize, spatialWeight](unsigned int beginRow, unsigned int endRow,
+                                                                        unsigned int)
+    {
+    for(unsigned int y = beginRow; y < endRow; ++y)
+      {
+      const unsigned int gridY = y / size;
+      const unsigned int firstGridY = (gridY > 0) ? gridY - 1 : 0;
+      const unsigned int lastGridY = std::min(gridY + 1, this->GridHeight - 1);
+      for(unsigned int x = 0; x < this->Width; ++x)
+        {
+        const unsigned int gridX = x / size;
+        const unsigned int firstGridX = (gridX > 0) ? gridX - 1 : 0;
+        const unsigned int lastGridX = std::min(gridX + 1, this->GridWidth - 1);
+        const float* pixel = &this->Pixels[(static_cast<std::size_t>(y) * this->Width + x) * this->NumberOfComponents];
+
+        unsigned int bestCenter = 0;
+        float bestDistance = std::numeric_limits<float>::max();
+        for(unsigned int cellY = firstGridY; cellY <= lastGridY; ++cellY)
+          {
+          for(unsigned int cellX = firstGridX; cellX <= lastGridX; ++cellX)
+            {
+            const unsigned int c = cellY * this->GridWidth + cellX;
+            const float* center = &this->Centers[c * centerSize];
+            float dx = x - center[0];
+            float dy = y - center[1];
+            float distance = ComputeColorDistance(pixel, center + 2) + spatialWeight * (dx * dx + dy * dy);
+            if(distance < bestDistance)
+              {
+              bestDistance = distance;
+              bestCenter = c;
+              }
+            }
+          }
+        this->Labels[y * this->Width + x] = bestCenter;
+        }
+      }
+    });
+}
+
+template <typename TImage>
+void SLICSuperpixels<TImage>::UpdateCenters()
+{
+  const unsigned int numberOfCenters = this->GridWidth * this->GridHeight;
+  const unsigned int centerSize = 2 + this->NumberOfComponents;
+
+  // Every thread sums its rows (count, x, y and the components per center), then the sums are added up
+  const unsigned int sumSize = 1 + centerSize;
+  std::vector<std::vector<double> > sums(std::min(this->NumberOfThreads, this->Height));
+  ParallelForRows(this->Height, [this, &sums, sumSize](unsigned int beginRow, unsigned int endRow, unsigned int thread)
+    {
+    std::vector<double>& threadSums = sums[thread];
+    threadSums.assign(this->GridWidth * this->GridHeight * sumSize, 0.0);
+    for(unsigned int y = beginRow; y < endRow; ++y)
+      {
+      for(unsigned int x = 0; x < this->Width; ++x)
+        {
+        const unsigned int offset = y * this->Width + x;
+        double* sum = &threadSums[this->Labels[offset] * sumSize];
+        sum[0]++;
+        sum[1] += x;
+        sum[2] += y;
+        const float* pixel = &this->Pixels[static_cast<std::size_t>(offset) * this->NumberOfComponents];
+        for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+          {
+          sum[3 + component] += pixel[component];
+          }
+        }
+      }
+    });
+
+  for(unsigned int thread = 1; thread < sums.size(); ++thread)
+    {
+    for(unsigned int i = 0; i < sums[0].size(); ++i)
+      {
+      sums[0][i] += sums[thread][i];
+      }
+    }
+
+  // A center without pixels stays where it is
+  for(unsigned int c = 0; c < numberOfCenters; ++c)
+    {
+    const double* sum = &sums[0][c * sumSize];
+    if(sum[0] == 0)
+      {
+      continue;
+      }
+    float* center = &this->Centers[c * centerSize];
+    for(unsigned int i = 0; i < centerSize; ++i)
+      {
+      center[i] = sum[1 + i] / sum[0];
+      }
+    }
+}
+
+template <typename TImage>
+void SLICSuperpixels<TImage>::EnforceConnectivity()
+{
+  const unsigned int numberOfPixels = this->Width * this->Height;
+  const unsigned int unlabeled = std::numeric_limits<unsigned int>::max();
+  const unsigned int minimumSize = std::max(this->SuperpixelSize * this->SuperpixelSize / 4, 1u);
+
+  std::vector<unsigned int> labels(numberOfPixels, unlabeled);
+  std::vector<unsigned int> component;
+  unsigned int numberOfLabels = 0;
+  for(unsigned int start = 0; start < numberOfPixels; ++start)
+    {
+    if(labels[start] != unlabeled)
+      {
+      continue;
+      }
+
+    // The pixels are visited in buffer order, so the left and upper neighbors are already labeled
+    const unsigned int x = start % this->Width;
+    unsigned int adjacentLabel = unlabeled;
+    if(x > 0)
+      {
+      adjacentLabel = labels[start - 1];
+      }
+    else if(start >= this->Width)
+      {
+      adjacentLabel = labels[start - this->Width];
+      }
+
+    // Flood fill the connected pixels of the same superpixel
+    component.assign(1, start);
+    labels[start] = numberOfLabels;
+    for(unsigned int i = 0; i < component.size(); ++i)
+      {
+      const unsigned int offset = component[i];
+      const unsigned int offsetX = offset % this->Width;
+      unsigned int neighbors[4];
+      unsigned int numberOfNeighbors = 0;
+      if(offsetX > 0)
+        {
+        neighbors[numberOfNeighbors++] = offset - 1;
+        }
+      if(offsetX + 1 < this->Width)
+        {
+        neighbors[numberOfNeighbors++] = offset + 1;
+        }
+      if(offset >= this->Width)
+        {
+        neighbors[numberOfNeighbors++] = offset - this->Width;
+        }
+      if(offset + this->Width < numberOfPixels)
+        {
+        neighbors[numberOfNeighbors++] = offset + this->Width;
+        }
+      for(unsigned int n = 0; n < numberOfNeighbors; ++n)
+        {
+        const unsigned int neighbor = neighbors[n];
+        if(labels[neighbor] == unlabeled && this->Labels[neighbor] == this->Labels[start])
+          {
+          labels[neighbor] = numberOfLabels;
+          component.push_back(neighbor);
+          }
+        }
+      }
+
+    if(component.size() < minimumSize && adjacentLabel != unlabeled)
+      {
+      for(unsigned int i = 0; i < component.size(); ++i)
+        {
+        labels[component[i]] = adjacentLabel;
+        }
+      }
+    else
+      {
+      numberOfLabels++;
+      }
+    }
+
+  this->Labels.swap(labels);
+  this->NumberOfSuperpixels = numberOfLabels;
+}
+
+#endif
@@ -0,0 +1,96 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* The source and sink seeds of an image. Every pixel has at most one label, stored in one byte per pixel,
+ * so adding a pixel that is already a seed does nothing and the number of seeds is bounded by the size of
+ * the image, no matter how often the same pixels are scribbled over. The seeds of each label are also kept
+ * in a list, so iterating over them does not visit the whole image.
+ *
+ * Adding a pixel with the other label moves it: the newest label wins. A pixel that is moved or removed stays in
+ * the list of its old label until the list is read, so changing the seeds takes time proportional to the number of
+ * pixels that change, however many seeds there are.
+*/
+
+#ifndef SeedSet_H
+#define SeedSet_H
+
+// ITK
+#include <itkImageRegion.h>
+#include <itkIndex.h>
+
+// STL
+#include <vector>
+
+template <unsigned int VDimension>
+class SeedSet
+{
+public:
+  typedef itk::Index<VDimension> IndexType;
+
+  enum Label {None = 0, Source = 1, Sink = 2};
+
+  SeedSet();
+
+  /** Set the region of the image, and remove all of the seeds. */
+  void SetRegion(const itk::ImageRegion<VDimension>& region);
+  const itk::ImageRegion<VDimension>& GetRegion() const;
+
+  /** Give the pixels of 'pixels' that are inside the region 'label' (Source or Sink). */
+  void Add(const std::vector<IndexType>& pixels, const Label label);
+
+  /** Make the pixels of 'pixels' that are inside the region no seed. */
+  void Remove(const std::vector<IndexType>& pixels);
+
+  /** Remove all of the seeds of 'label' (Source or Sink). */
+  void Clear(const Label label);
+
+  /** Remove all of the seeds. */
+  void Clear();
+
+  Label GetLabel(const IndexType& index) const;
+
+  /** The distinct pixels of 'label' (Source or Sink), in the order they were added. This removes the pixels
+   *  that have been moved or removed from the list, so it must not be called by several threads at once. */
+  const std::vector<IndexType>& GetPixels(const Label label) const;
+
+protected:
+
+  /** The bits of Labels: the label itself, and whether the pixel is in each list. A pixel that
+   *  changes label stays in its old list until RemoveStalePixels(). */
+  static const unsigned char LabelBits = 3;
+  static const unsigned char InSourcesBit = 4;
+  static const unsigned char InSinksBit = 8;
+
+  unsigned int GetOffset(const IndexType& index) const;
+
+  /** Remove the pixels whose label is no longer 'label' from its list. */
+  void RemoveStalePixels(const Label label) const;
+
+  itk::ImageRegion<VDimension> Region;
+
+  /** One byte per pixel of Region, in buffer order. The list bits change when GetPixels() removes the stale
+   *  pixels from a list. */
+  mutable std::vector<unsigned char> Labels;
+
+  /** The pixels of each label, indexed by Label - 1, and whether they may have stale pixels. */
+  mutable std::vector<IndexType> Pixels[2];
+  mutable bool HasStalePixels[2];
+};
+
+#include "SeedSet.hpp"
+
+#endif
@@ -0,0 +1,183 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SeedSet_HPP
+#define SeedSet_HPP
+
+#include "SeedSet.h" // Appease syntax parser
+
+template <unsigned int VDimension>
+const unsigned char SeedSet<VDimension>::LabelBits;
+
+template <unsigned int VDimension>
+const unsigned char SeedSet<VDimension>::InSourcesBit;
+
+template <unsigned int VDimension>
+const unsigned char SeedSet<VDimension>::InSinksBit;
+
+template <unsigned int VDimension>
+SeedSet<VDimension>::SeedSet()
+{
+  this->HasStalePixels[0] = false;
+  this->HasStalePixels[1] = false;
+}
+
+template <unsigned int VDimension>
+void SeedSet<VDimension>::SetRegion(const itk::ImageRegion<VDimension>& region)
+{
+  this->Region = region;
+  this->Labels.assign(region.GetNumberOfPixels(), None);
+  this->Pixels[0].clear();
+  this->Pixels[1].clear();
+  this->HasStalePixels[0] = false;
+  this->HasStalePixels[1] = false;
+}
+
+template <unsigned int VDimension>
+const itk::ImageRegion<VDimension>& SeedSet<VDimension>::GetRegion() const
+{
+  return this->Region;
+}
+
+template <unsigned int VDimension>
+unsigned int SeedSet<VDimension>::GetOffset(const IndexType& index) const
+{
+  unsigned int offset = 0;
+  unsigned int stride = 1;
+  for(unsigned int dimension = 0; dimension < VDimension; ++dimension)
+    {
+    offset += (index[dimension] - this->Region.GetIndex()[dimension]) * stride;
+    stride *= this->Region.GetSize()[dimension];
+    }
+  return offset;
+}
+
+template <unsigned int VDimension>
+void SeedSet<VDimension>::Add(const std::vector<IndexType>& pixels, const Label label)
+{
+  const unsigned char inListBit = (label == Source) ? InSourcesBit : InSinksBit;
+  const Label otherLabel = (label == Source) ? Sink : Source;
+
+  for(unsigned int i = 0; i < pixels.size(); ++i)
+    {
+    if(!this->Region.IsInside(pixels[i]))
+      {
+      continue;
+      }
+
+    unsigned char& pixelLabel = this->Labels[GetOffset(pixels[i])];
+    if((pixelLabel & LabelBits) == otherLabel)
+      {
+      this->HasStalePixels[otherLabel - 1] = true;
+      }
+    if(!(pixelLabel & inListBit))
+      {
+      this->Pixels[label - 1].push_back(pixels[i]);
+      }
+    pixelLabel = (pixelLabel & ~LabelBits) | inListBit | label;
+    }
+}
+
+template <unsigned int VDimension>
+void SeedSet<VDimension>::Remove(const std::vector<IndexType>& pixels)
+{
+  for(unsigned int i = 0; i < pixels.size(); ++i)
+    {
+    if(!this->Region.IsInside(pixels[i]))
+      {
+      continue;
+      }
+
+    unsigned char& pixelLabel = this->Labels[GetOffset(pixels[i])];
+    if((pixelLabel & LabelBits) != None)
+      {
+      this->HasStalePixels[(pixelLabel & LabelBits) - 1] = true;
+      }
+    pixelLabel &= ~LabelBits;
+    }
+}
+
+template <unsigned int VDimension>
+void SeedSet<VDimension>::RemoveStalePixels(const Label label) const
+{
+  const unsigned char inListBit = (label == Source) ? InSourcesBit : InSinksBit;
+
+  std::vector<IndexType>& pixels = this->Pixels[label - 1];
+  unsigned int numberOfPixels = 0;
+  for(unsigned int i = 0; i < pixels.size(); ++i)
+    {
+    unsigned char& pixelLabel = this->Labels[GetOffset(pixels[i])];
+    if((pixelLabel & LabelBits) == label)
+      {
+      pixels[numberOfPixels++] = pixels[i];
+      }
+    else
+      {
+      pixelLabel &= ~inListBit;
+      }
+    }
+  pixels.resize(numberOfPixels);
+  this->HasStalePixels[label - 1] = false;
+}
+
+template <unsigned int VDimension>
+void SeedSet<VDimension>::Clear(const Label label)
+{
+  const unsigned char inListBit = (label == Source) ? InSourcesBit : InSinksBit;
+
+  std::vector<IndexType>& pixels = this->Pixels[label - 1];
+  for(unsigned int i = 0; i < pixels.size(); ++i)
+    {
+    unsigned char& pixelLabel = this->Labels[GetOffset(pixels[i])];
+    pixelLabel &= ~inListBit;
+    if((pixelLabel & LabelBits) == label)
+      {
+      pixelLabel &= ~LabelBits;
+      }
+    }
+  pixels.clear();
+  this->HasStalePixels[label - 1] = false;
+}
+
+template <unsigned int VDimension>
+void SeedSet<VDimension>::Clear()
+{
+  Clear(Source);
+  Clear(Sink);
+}
+
+template <unsigned int VDimension>
+typename SeedSet<VDimension>::Label SeedSet<VDimension>::GetLabel(const IndexType& index) const
+{
+  if(!this->Region.IsInside(index))
+    {
+    return None;
+    }
+  return static_cast<Label>(this->Labels[GetOffset(index)] & LabelBits);
+}
+
+template <unsigned int VDimension>
+const std::vector<typename SeedSet<VDimension>::IndexType>& SeedSet<VDimension>::GetPixels(const Label label) const
+{
+  if(this->HasStalePixels[label - 1])
+    {
+    RemoveStalePixels(label);
+    }
+  return this->Pixels[label - 1];
+}
+
+#endif
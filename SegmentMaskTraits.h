@@ -0,0 +1,63 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* The type of the result of a cut. The segment mask of an image is a Mask (from the submodule), whose holes
+ * are the foreground. Mask is two dimensional, so a volume gets a plain binary image with the foreground at 255.
+*/
+
+#ifndef SegmentMaskTraits_H
+#define SegmentMaskTraits_H
+
+// Submodules
+#include "Mask/Mask.h"
+
+// ITK
+#include <itkImage.h>
+
+template <unsigned int VDimension>
+struct SegmentMaskTraits
+{
+  typedef itk::Image<unsigned char, VDimension> MaskType;
+
+  static unsigned char GetHoleValue(MaskType* const)
+  {
+    return 255;
+  }
+
+  static unsigned char GetValidValue(MaskType* const)
+  {
+    return 0;
+  }
+};
+
+template <>
+struct SegmentMaskTraits<2>
+{
+  typedef Mask MaskType;
+
+  static Mask::PixelType GetHoleValue(Mask* const mask)
+  {
+    return mask->GetHoleValue();
+  }
+
+  static Mask::PixelType GetValidValue(Mask* const mask)
+  {
+    return mask->GetValidValue();
+  }
+};
+
+#endif
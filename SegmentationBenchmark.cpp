@@ -0,0 +1,312 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Time each phase of a full resolution cut, on the bundled soldier image (with its foreground and background
+ * seeds) and on synthetic images of 1 to 100 megapixels, in each of the pixel types of ImageFormat:
+ *
+ *   SegmentationBenchmark dataDirectory [maximumMegapixels] [numberOfThreads] [outputDirectory]
+ *
+ * The synthetic images are a bright disk on a dark background, both with gaussian noise, with sources in a small
+ * square at the center of the disk and sinks on the first and last row. Their sizes are 1, 4, 16, 64 and 100
+ * megapixels, up to maximumMegapixels (100 by default, which needs about 7 GB).
+ *
+ * Every image is cut once as 8 bit RGB (rgb8), 8 and 16 bit gray (gray8, gray16) and as the 3-component float
+ * itk::VectorImage that other images are read into (float). The soldier image is converted to each type by the
+ * reader. The synthetic gray images have the same disk and noise in their one component, and their 16 bit values
+ * span the 16 bit range.
+ *
+ * The results are written to stdout as CSV, one line per image and pixel type after a header line. All times are in
+ * seconds:
+ * load is the time to read the image (or to create a synthetic one), the next four are the phases of
+ * IncrementalImageGraphCut::PerformSegmentation() (see GetPhaseTimes()), and export is the time to write the segment
+ * mask to outputDirectory (the current directory by default). peak_rss_bytes is the peak resident set size of the
+ * process after the image was exported; the images are run from small to large, so it is the peak of the largest
+ * image so far.
+*/
+
+// Custom
+#include "ImageFormat.h"
+#include "ImagePixelTraits.h"
+#include "IncrementalImageGraphCut.h"
+
+// ITK
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+/** One image to segment, with its seeds. */
+template <typename TImage>
+struct BenchmarkCase
+{
+  std::string Name;
+  typename TImage::Pointer Image;
+  std::vector<itk::Index<2> > Sources;
+  std::vector<itk::Index<2> > Sinks;
+  double LoadTime;
+};
+
+/** The peak resident set size of this process in bytes, or 0 if it is not known on this platform. */
+static double GetPeakMemory()
+{
+#ifdef __unix__
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return 1024.0 * usage.ru_maxrss; // kilobytes on Linux
+#else
+  return 0;
+#endif
+}
+
+static double SecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** The non-zero pixels of a seed mask. */
+static std::vector<itk::Index<2> > ReadSeeds(const std::string& fileName)
+{
+  typedef itk::Image<unsigned char, 2> SeedImageType;
+  typedef itk::ImageFileReader<SeedImageType> ReaderType;
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(fileName);
+  reader->Update();
+
+  std::vector<itk::Index<2> > seeds;
+  itk::ImageRegionConstIteratorWithIndex<SeedImageType> seedIterator(reader->GetOutput(),
+                                                                     reader->GetOutput()->GetLargestPossibleRegion());
+  while(!seedIterator.IsAtEnd())
+    {
+    if(seedIterator.Get() != 0)
+      {
+      seeds.push_back(seedIterator.GetIndex());
+      }
+    ++seedIterator;
+    }
+  return seeds;
+}
+
+template <typename TImage>
+static BenchmarkCase<TImage> ReadCase(const std::string& dataDirectory)
+{
+  BenchmarkCase<TImage> benchmarkCase;
+  benchmarkCase.Name = "soldier";
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  typedef itk::ImageFileReader<TImage> ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(dataDirectory + "/soldier.png");
+  reader->Update();
+  benchmarkCase.Image = reader->GetOutput();
+  benchmarkCase.LoadTime = SecondsSince(start);
+
+  benchmarkCase.Sources = ReadSeeds(dataDirectory + "/foreground.png");
+  benchmarkCase.Sinks = ReadSeeds(dataDirectory + "/background.png");
+  return benchmarkCase;
+}
+
+/** A synthetic value on the 8 bit scale as a TComponent: clamped to 8 bits, and scaled to 16 bits for a 16 bit
+ *  component. A float keeps the value. */
+template <typename TComponent>
+static TComponent ToComponent(const float value)
+{
+  return static_cast<TComponent>(std::max(0.0f, std::min(value, 255.0f)) *
+                                 (std::numeric_limits<TComponent>::max() / 255));
+}
+
+template <>
+float ToComponent<float>(const float value)
+{
+  return value;
+}
+
+/** A square image of about 'megapixels' million pixels, with 3 components unless TImage is a gray image. */
+template <typename TImage>
+static BenchmarkCase<TImage> CreateCase(const unsigned int megapixels)
+{
+  typedef ImagePixelTraits<TImage> PixelTraits;
+  typedef typename PixelTraits::ComponentType ComponentType;
+
+  BenchmarkCase<TImage> benchmarkCase;
+  benchmarkCase.Name = "synthetic_" + std::to_string(megapixels) + "MP";
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  const int size = static_cast<int>(std::sqrt(megapixels * 1e6) + 0.5);
+  benchmarkCase.Image = TImage::New();
+  itk::Size<2> imageSize = {{static_cast<itk::SizeValueType>(size), static_cast<itk::SizeValueType>(size)}};
+  benchmarkCase.Image->SetRegions(itk::ImageRegion<2>(imageSize));
+  benchmarkCase.Image->SetNumberOfComponentsPerPixel(PixelTraits::NumberOfComponents == 1 ? 1 : 3);
+  benchmarkCase.Image->Allocate();
+
+  std::mt19937 generator(0);
+  std::normal_distribution<float> noise(0.0f, 20.0f);
+
+  // Every pixel type has its components in one buffer, in buffer order
+  const unsigned int numberOfComponents = PixelTraits::GetNumberOfComponents(benchmarkCase.Image.GetPointer());
+  ComponentType* component = PixelTraits::GetBuffer(benchmarkCase.Image.GetPointer());
+  const double radius = size / 4.0;
+  for(int y = 0; y < size; ++y)
+    {
+    for(int x = 0; x < size; ++x)
+      {
+      double dx = x - size / 2.0;
+      double dy = y - size / 2.0;
+      float value = (dx * dx + dy * dy < radius * radius) ? 200.0f : 50.0f;
+      for(unsigned int c = 0; c < numberOfComponents; ++c)
+        {
+        *component++ = ToComponent<ComponentType>(value + noise(generator));
+        }
+      }
+    }
+  benchmarkCase.LoadTime = SecondsSince(start);
+
+  const int center = size / 2;
+  const int halfWidth = std::max(size / 64, 2);
+  for(int y = center - halfWidth; y <= center + halfWidth; ++y)
+    {
+    for(int x = center - halfWidth; x <= center + halfWidth; ++x)
+      {
+      itk::Index<2> index = {{x, y}};
+      benchmarkCase.Sources.push_back(index);
+      }
+    }
+  for(int x = 0; x < size; ++x)
+    {
+    itk::Index<2> top = {{x, 0}};
+    itk::Index<2> bottom = {{x, size - 1}};
+    benchmarkCase.Sinks.push_back(top);
+    benchmarkCase.Sinks.push_back(bottom);
+    }
+
+  return benchmarkCase;
+}
+
+/** Cut 'benchmarkCase', write its mask and print its line of the results. The graph cut only lives for this
+ *  call, so the memory of one case is released before the next one is created. */
+template <typename TImage>
+static void RunCase(BenchmarkCase<TImage>& benchmarkCase, const std::string& pixelType,
+                    const unsigned int numberOfThreads, const std::string& outputDirectory)
+{
+  typedef IncrementalImageGraphCut<TImage> GraphCutType;
+  GraphCutType graphCut;
+  graphCut.SetNumberOfThreads(numberOfThreads);
+  graphCut.SetImage(benchmarkCase.Image);
+  graphCut.SetSources(benchmarkCase.Sources);
+  graphCut.SetSinks(benchmarkCase.Sinks);
+  graphCut.PerformSegmentation();
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  typedef itk::ImageFileWriter<typename GraphCutType::MaskType> WriterType;
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetFileName(outputDirectory + "/" + benchmarkCase.Name + "_" + pixelType + "_mask.png");
+  writer->SetInput(graphCut.GetSegmentMask());
+  writer->Update();
+  double exportTime = SecondsSince(start);
+
+  const itk::Size<2> size = benchmarkCase.Image->GetLargestPossibleRegion().GetSize();
+  const typename GraphCutType::PhaseTimes& times = graphCut.GetPhaseTimes();
+  std::cout << benchmarkCase.Name << "," << pixelType << "," << size[0] << "," << size[1] << "," << numberOfThreads << ","
+            << benchmarkCase.LoadTime << "," << times.Histograms << "," << times.NWeights << ","
+            << times.TWeights << "," << times.MaxFlow << "," << exportTime << ","
+            << static_cast<unsigned long long>(GetPeakMemory()) << std::endl;
+}
+
+/** Run the synthetic image of 'megapixels', or the soldier image if it is 0, as a TImage. */
+template <typename TImage>
+static void RunCase(const unsigned int megapixels, const std::string& pixelType, const std::string& dataDirectory,
+                    const unsigned int numberOfThreads, const std::string& outputDirectory)
+{
+  BenchmarkCase<TImage> benchmarkCase = megapixels == 0 ? ReadCase<TImage>(dataDirectory) :
+                                                          CreateCase<TImage>(megapixels);
+  RunCase(benchmarkCase, pixelType, numberOfThreads, outputDirectory);
+}
+
+/** Run the image of 'megapixels' (see above) in every pixel type, so that each size is done before the next one. */
+static void RunPixelTypes(const unsigned int megapixels, const std::string& dataDirectory,
+                          const unsigned int numberOfThreads, const std::string& outputDirectory)
+{
+  RunCase<ImageFormat::RGBImageType>(megapixels, "rgb8", dataDirectory, numberOfThreads, outputDirectory);
+  RunCase<ImageFormat::GrayImageType>(megapixels, "gray8", dataDirectory, numberOfThreads, outputDirectory);
+  RunCase<ImageFormat::Gray16ImageType>(megapixels, "gray16", dataDirectory, numberOfThreads, outputDirectory);
+  RunCase<ImageFormat::VectorImageType>(megapixels, "float", dataDirectory, numberOfThreads, outputDirectory);
+}
+
+int main(int argc, char** argv)
+{
+  if(argc < 2 || argc > 5)
+    {
+    std::cerr << "Usage: " << argv[0] << " dataDirectory [maximumMegapixels] [numberOfThreads] [outputDirectory]"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const std::string dataDirectory = argv[1];
+  unsigned int maximumMegapixels = 100;
+  if(argc > 2)
+    {
+    maximumMegapixels = atoi(argv[2]);
+    }
+  unsigned int numberOfThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  if(argc > 3)
+    {
+    numberOfThreads = std::max(atoi(argv[3]), 1);
+    }
+  std::string outputDirectory = ".";
+  if(argc > 4)
+    {
+    outputDirectory = argv[4];
+    }
+
+  std::cout << std::fixed;
+  std::cout.precision(6);
+  std::cout << "image,pixel_type,width,height,threads,load_s,histograms_s,nweights_s,tweights_s,maxflow_s,export_s,peak_rss_bytes"
+            << std::endl;
+
+  try
+    {
+    RunPixelTypes(0, dataDirectory, numberOfThreads, outputDirectory);
+
+    const unsigned int megapixels[] = {1, 4, 16, 64, 100};
+    for(unsigned int i = 0; i < sizeof(megapixels) / sizeof(megapixels[0]) && megapixels[i] <= maximumMegapixels; ++i)
+      {
+      RunPixelTypes(megapixels[i], dataDirectory, numberOfThreads, outputDirectory);
+      }
+    }
+  catch(itk::ExceptionObject& e)
+    {
+    std::cerr << e << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
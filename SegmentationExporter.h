@@ -0,0 +1,130 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Create the files that a segmentation is exported to, from the image and its segment mask, in one pass over the
+ * image: the mask, the cut-out (the foreground on a transparent background) and the overlay (the image with the
+ * foreground tinted). The rows are split between NumberOfThreads threads, and every row is composed from the
+ * image and mask buffers directly.
+ *
+ * With KeepLargestComponent on, only the largest 4-connected foreground region is exported, as with
+ * Mask::KeepLargestHole(). Its components are labeled in parallel: each thread joins the foreground pixels of a strip
+ * of rows with a union-find over the pixel offsets, then the strips are joined along their borders.
+ *
+ * TImage is an image with a buffer of interleaved components (see ImagePixelTraits), e.g. an
+ * itk::VectorImage<float, 2> or an itk::Image<itk::RGBPixel<unsigned char>, 2>. The first three components are the
+ * colors (a single component is gray), clamped to [0, 255].
+*/
+
+#ifndef SegmentationExporter_H
+#define SegmentationExporter_H
+
+// Custom
+#include "ImagePixelTraits.h"
+
+// ITK
+#include <itkImage.h>
+#include <itkRGBAPixel.h>
+#include <itkRGBPixel.h>
+
+// STL
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+template <typename TImage>
+class SegmentationExporter
+{
+public:
+  typedef itk::Image<unsigned char, 2> MaskType;
+  typedef itk::Image<itk::RGBAPixel<unsigned char>, 2> CutOutType;
+  typedef itk::Image<itk::RGBPixel<unsigned char>, 2> OverlayType;
+
+  enum Output {MaskOutput = 1, CutOutOutput = 2, OverlayOutput = 4};
+
+  SegmentationExporter();
+
+  void SetImage(TImage* const image);
+
+  /** The segment mask of the image. Its foreground pixels are 'holeValue' and the others 'validValue' (as in a
+   *  Mask), and the exported mask uses the same values. */
+  void SetMask(MaskType* const mask, const unsigned char holeValue, const unsigned char validValue);
+
+  /** Only export the largest 4-connected region of the foreground. The default is off. */
+  void SetKeepLargestComponent(const bool keep);
+
+  /** The default is 1. */
+  void SetNumberOfThreads(const unsigned int numberOfThreads);
+
+  /** The outputs that Compute() creates, a combination of Output values. The default is all of them. */
+  void SetOutputs(const unsigned int outputs);
+
+  void Compute();
+
+  /** The outputs of the last Compute(), or null if it did not create them. */
+  MaskType* GetMaskOutput();
+  CutOutType* GetCutOut();
+  OverlayType* GetOverlay();
+
+  /** Compute the outputs that have a file name and write them, each file from its own thread. */
+  void Write(const std::string& maskFileName, const std::string& cutOutFileName, const std::string& overlayFileName);
+
+  /** The color that the foreground is tinted with in the overlay, and how much. */
+  static const unsigned char TintColor[3];
+  static const float TintOpacity;
+
+protected:
+
+  /** Call function(beginRow, endRow) for NumberOfThreads disjoint blocks of rows, concurrently. */
+  void ParallelForRows(const unsigned int numberOfRows,
+                       const std::function<void(unsigned int, unsigned int)>& function) const;
+
+  /** Set Foreground to the largest 4-connected component of the holes of the mask. */
+  void FindLargestComponent();
+
+  /** The root of the tree of 'offset' in Parents. */
+  unsigned int FindRoot(unsigned int offset) const;
+
+  void Join(const unsigned int a, const unsigned int b);
+
+  /** Write 'image' to 'fileName', storing an exception in 'error' instead of throwing it. */
+  template <typename TOutput>
+  static void WriteImage(TOutput* const image, const std::string& fileName, std::exception_ptr* const error);
+
+  typename TImage::Pointer Image;
+  MaskType::Pointer Mask;
+  unsigned char HoleValue;
+  unsigned char ValidValue;
+
+  bool KeepLargestComponent;
+  unsigned int NumberOfThreads;
+  unsigned int Outputs;
+
+  /** For KeepLargestComponent, 1 for the pixels of the largest component. */
+  std::vector<unsigned char> Foreground;
+
+  /** The union-find forest of the foreground pixels, by offset. Only used by FindLargestComponent(). */
+  std::vector<unsigned int> Parents;
+
+  MaskType::Pointer MaskOutputImage;
+  CutOutType::Pointer CutOutImage;
+  OverlayType::Pointer OverlayImage;
+};
+
+#include "SegmentationExporter.hpp"
+
+#endif
@@ -0,0 +1,384 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SegmentationExporter_HPP
+#define SegmentationExporter_HPP
+
+#include "SegmentationExporter.h" // Appease syntax parser
+
+// ITK
+#include <itkImageFileWriter.h>
+
+// STL
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+template <typename TImage>
+const unsigned char SegmentationExporter<TImage>::TintColor[3] = {0, 255, 0};
+
+template <typename TImage>
+const float SegmentationExporter<TImage>::TintOpacity = 0.5f;
+
+template <typename TImage>
+SegmentationExporter<TImage>::SegmentationExporter() : HoleValue(255), ValidValue(0), KeepLargestComponent(false),
+  NumberOfThreads(1), Outputs(MaskOutput | CutOutOutput | OverlayOutput)
+{
+}
+
+template <typename TImage>
+void SegmentationExporter<TImage>::SetImage(TImage* const image)
+{
+  this->Image = image;
+}
+
+template <typename TImage>
+void SegmentationExporter<TImage>::SetMask(MaskType* const mask, const unsigned char holeValue,
+                                           const unsigned char validValue)
+{
+  this->Mask = mask;
+  this->HoleValue = holeValue;
+  this->ValidValue = validValue;
+}
+
+template <typename TImage>
+void SegmentationExporter<TImage>::SetKeepLargestComponent(const bool keep)
+{
+  this->KeepLargestComponent = keep;
+}
+
+template <typename TImage>
+void SegmentationExporter<TImage>::SetNumberOfThreads(const unsigned int numberOfThreads)
+{
+  this->NumberOfThreads = std::max(numberOfThreads, 1u);
+}
+
+template <typename TImage>
+void SegmentationExporter<TImage>::SetOutputs(const unsigned int outputs)
+{
+  this->Outputs = outputs;
+}
+
+template <typename TImage>
+typename SegmentationExporter<TImage>::MaskType* SegmentationExporter<TImage>::GetMaskOutput()
+{
+  return this->MaskOutputImage;
+}
+
+template <typename TImage>
+typename SegmentationExporter<TImage>::CutOutType* SegmentationExporter<TImage>::GetCutOut()
+{
+  return this->CutOutImage;
+}
+
+template <typename TImage>
+typename SegmentationExporter<TImage>::OverlayType* SegmentationExporter<TImage>::GetOverlay()
+{
+  return this->OverlayImage;
+}
+
+template <typename TImage>
+void SegmentationExporter<TImage>::ParallelForRows(const unsigned int numberOfRows,
+  const std::function<void(unsigned int, unsigned int)>& function) const
+{
+  const unsigned int numberOfThreads = std::min(this->NumberOfThreads, numberOfRows);
+  if(numberOfThreads <= 1)
+    {
+    function(0, numberOfRows);
+    return;
+    }
+
+  std::vector<std::thread> threads;
+  for(unsigned int thread = 0; thread < numberOfThreads; ++thread)
+    {
+    threads.push_back(std::thread(function, thread * numberOfRows / numberOfThreads,
+                                  (thread + 1) * numberOfRows / numberOfThreads));
+    }
+  for(unsigned int thread = 0; thread < numberOfThreads; ++thread)
+    {
+    threads[thread].join();
+    }
+}
+
+template <typename TImage>
+unsigned int SegmentationExporter<TImage>::FindRoot(unsigned int offset) const
+{
+  while(this->Parents[offset] != offset)
+    {
+    offset = this->Parents[offset];
+    }
+  return offset;
+}
+
+template <typename TImage>
+void SegmentationExporter<TImage>::Join(const unsigned int a, const unsigned int b)
+{
+  // The smaller offset becomes the root, so a root is always the first pixel of its component in buffer order
+  unsigned int rootA = FindRoot(a);
+  unsigned int rootB = FindRoot(b);
+  if(rootA < rootB)
+    {
+    this->Parents[rootB] = rootA;
+    }
+  else if(rootB < rootA)
+    {
+    this->Parents[rootA] = rootB;
+    }
+
+  // Shorten the paths that were followed, so later searches from these pixels are short
+  this->Parents[a] = this->Parents[b] = std::min(rootA, rootB);
+}
+
+template <typename TImage>
+void SegmentationExporter<TImage>::FindLargestComponent()
+{
+  const unsigned int width = this->Mask->GetLargestPossibleRegion().GetSize()[0];
+  const unsigned int height = this->Mask->GetLargestPossibleRegion().GetSize()[1];
+  const unsigned char* mask = this->Mask->GetBufferPointer();
+
+  this->Parents.resize(static_cast<std::size_t>(width) * height);
+
+  // Every thread labels its own strip of rows. A join only follows parents within the strip (the roots of a strip
+  // are in the strip, since they are the smallest offsets of their trees), so the strips are independent.
+  const unsigned int numberOfStrips = std::max(std::min(this->NumberOfThreads, height), 1u);
+  ParallelForRows(height, [this, width, mask](unsigned int beginRow, unsigned int endRow)
+    {
+    for(unsigned int y = beginRow; y < endRow; ++y)
+      {
+      for(unsigned int x = 0; x < width; ++x)
+        {
+        const unsigned int offset = y * width + x;
+        this->Parents[offset] = offset;
+        if(mask[offset] != this->HoleValue)
+          {
+          continue;
+          }
+        if(x > 0 && mask[offset - 1] == this->HoleValue)
+          {
+          Join(offset, offset - 1);
+          }
+        if(y > beginRow && mask[offset - width] == this->HoleValue)
+          {
+          Join(offset, offset - width);
+          }
+        }
+      }
+    });
+
+  // Join the strips along their borders (the first row of every strip but the first)
+  for(unsigned int strip = 1; strip < numberOfStrips; ++strip)
+    {
+    const unsigned int y = strip * height / numberOfStrips;
+    for(unsigned int x = 0; x < width; ++x)
+      {
+      const unsigned int offset = y * width + x;
+      if(mask[offset] == this->HoleValue && mask[offset - width] == this->HoleValue)
+        {
+        Join(offset, offset - width);
+        }
+      }
+    }
+
+  // A parent always has a smaller offset than its child, so in buffer order the parent of a pixel has already
+  // been replaced by the label of its component when the pixel is reached. The roots get consecutive labels.
+  std::vector<unsigned int> sizes;
+  for(unsigned int offset = 0; offset < this->Parents.size(); ++offset)
+    {
+    if(mask[offset] != this->HoleValue)
+      {
+      continue;
+      }
+    if(this->Parents[offset] == offset)
+      {
+      this->Parents[offset] = sizes.size();
+      sizes.push_back(0);
+      }
+    else
+      {
+      this->Parents[offset] = this->Parents[this->Parents[offset]];
+      }
+    sizes[this->Parents[offset]]++;
+    }
+
+  const unsigned int largestLabel = std::max_element(sizes.begin(), sizes.end()) - sizes.begin();
+
+  this->Foreground.resize(this->Parents.size());
+  ParallelForRows(height, [this, width, mask, largestLabel](unsigned int beginRow, unsigned int endRow)
+    {
+    for(unsigned int offset = beginRow * width; offset < endRow * width; ++offset)
+      {
+      this->Foreground[offset] = mask[offset] == this->HoleValue && this->Parents[offset] == largestLabel;
+      }
+    });
+
+  this->Parents.clear();
+  this->Parents.shrink_to_fit();
+}
+
+template <typename TImage>
+void SegmentationExporter<TImage>::Compute()
+{
+  const itk::ImageRegion<2> region = this->Mask->GetLargestPossibleRegion();
+  const unsigned int width = region.GetSize()[0];
+  const unsigned int height = region.GetSize()[1];
+  const unsigned int numberOfComponents = this->Image->GetNumberOfComponentsPerPixel();
+
+  if(this->KeepLargestComponent)
+    {
+    FindLargestComponent();
+    }
+
+  this->MaskOutputImage = nullptr;
+  this->CutOutImage = nullptr;
+  this->OverlayImage = nullptr;
+  unsigned char* maskOutput = nullptr;
+  itk::RGBAPixel<unsigned char>* cutOut = nullptr;
+  itk::RGBPixel<unsigned char>* overlay = nullptr;
+  if(this->Outputs & MaskOutput)
+    {
+    this->MaskOutputImage = MaskType::New();
+    this->MaskOutputImage->SetRegions(region);
+    this->MaskOutputImage->Allocate();
+    maskOutput = this->MaskOutputImage->GetBufferPointer();
+    }
+  if(this->Outputs & CutOutOutput)
+    {
+    this->CutOutImage = CutOutType::New();
+    this->CutOutImage->SetRegions(region);
+    this->CutOutImage->Allocate();
+    cutOut = this->CutOutImage->GetBufferPointer();
+    }
+  if(this->Outputs & OverlayOutput)
+    {
+    this->OverlayImage = OverlayType::New();
+    this->OverlayImage->SetRegions(region);
+    this->OverlayImage->Allocate();
+    overlay = this->OverlayImage->GetBufferPointer();
+    }
+
+  // The colors of a gray image are its only component
+  unsigned int colorComponents[3];
+  for(unsigned int color = 0; color < 3; ++color)
+    {
+    colorComponents[color] = std::min(color, numberOfComponents - 1);
+    }
+
+  typedef ImagePixelTraits<TImage> PixelTraits;
+  const typename PixelTraits::ComponentType* const image = PixelTraits::GetBuffer(this->Image.GetPointer());
+  const unsigned char* const mask = this->Mask->GetBufferPointer();
+  ParallelForRows(height, [&](unsigned int beginRow, unsigned int endRow)
+    {
+    unsigned char color[3];
+    for(std::size_t offset = static_cast<std::size_t>(beginRow) * width;
+        offset < static_cast<std::size_t>(endRow) * width; ++offset)
+      {
+      const bool isForeground = this->KeepLargestComponent ? this->Foreground[offset] != 0 :
+                                                             mask[offset] == this->HoleValue;
+      const typename PixelTraits::ComponentType* pixel = image + offset * numberOfComponents;
+      for(unsigned int component = 0; component < 3; ++component)
+        {
+        float value = static_cast<float>(pixel[colorComponents[component]]);
+        color[component] = static_cast<unsigned char>(std::max(0.0f, std::min(value, 255.0f)));
+        }
+
+      if(maskOutput)
+        {
+        maskOutput[offset] = isForeground ? this->HoleValue : this->ValidValue;
+        }
+
+      if(cutOut)
+        {
+        // The background is transparent black
+        cutOut[offset].Set(isForeground ? color[0] : 0, isForeground ? color[1] : 0, isForeground ? color[2] : 0,
+                           isForeground ? 255 : 0);
+        }
+
+      if(overlay)
+        {
+        for(unsigned int component = 0; component < 3; ++component)
+          {
+          overlay[offset][component] = isForeground ?
+            static_cast<unsigned char>((1.0f - TintOpacity) * color[component] + TintOpacity * TintColor[component]) :
+            color[component];
+          }
+        }
+      }
+    });
+
+  this->Foreground.clear();
+}
+
+template <typename TImage>
+void SegmentationExporter<TImage>::Write(const std::string& maskFileName, const std::string& cutOutFileName,
+                                         const std::string& overlayFileName)
+{
+  SetOutputs((maskFileName.empty() ? 0 : MaskOutput) | (cutOutFileName.empty() ? 0 : CutOutOutput) |
+             (overlayFileName.empty() ? 0 : OverlayOutput));
+  Compute();
+
+  // Most of the time of writing a file is spent compressing it, which is independent for every file. An exception
+  // of a writer is passed on to the caller once all of the writers are done.
+  std::exception_ptr errors[3];
+  std::vector<std::thread> threads;
+  if(!maskFileName.empty())
+    {
+    threads.push_back(std::thread(&WriteImage<MaskType>, this->MaskOutputImage.GetPointer(),
+                                  std::cref(maskFileName), &errors[0]));
+    }
+  if(!cutOutFileName.empty())
+    {
+    threads.push_back(std::thread(&WriteImage<CutOutType>, this->CutOutImage.GetPointer(),
+                                  std::cref(cutOutFileName), &errors[1]));
+    }
+  if(!overlayFileName.empty())
+    {
+    threads.push_back(std::thread(&WriteImage<OverlayType>, this->OverlayImage.GetPointer(),
+                                  std::cref(overlayFileName), &errors[2]));
+    }
+  for(unsigned int thread = 0; thread < threads.size(); ++thread)
+    {
+    threads[thread].join();
+    }
+
+  for(unsigned int output = 0; output < 3; ++output)
+    {
+    if(errors[output])
+      {
+      std::rethrow_exception(errors[output]);
+      }
+    }
+}
+
+template <typename TImage>
+template <typename TOutput>
+void SegmentationExporter<TImage>::WriteImage(TOutput* const image, const std::string& fileName,
+                                              std::exception_ptr* const error)
+{
+  try
+    {
+    typename itk::ImageFileWriter<TOutput>::Pointer writer = itk::ImageFileWriter<TOutput>::New();
+    writer->SetFileName(fileName);
+    writer->SetInput(image);
+    writer->Update();
+    }
+  catch(...)
+    {
+    *error = std::current_exception();
+    }
+}
+
+#endif
@@ -0,0 +1,903 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* A local segmentation service, so that a web frontend (or any other program) can drive the cuts instead of the Qt
+ * window. It listens on a Unix domain socket; every request is one line of words and gets one reply line, in order:
+ *
+ *   load session image           -> ok width height
+ *   seeds session fg|bg x y ...  -> ok
+ *   erase session x y ...        -> ok
+ *   clear session                -> ok
+ *   cut session lambda bins      -> ok numberOfRuns first length first length ...
+ *   close session                -> ok
+ *   stats                        -> ok images bytes budget hits misses evictions
+ *
+ * A session is a named set of seeds on an image, so one connection can serve many annotators. "load" starts a session
+ * on an image (with no seeds), "seeds" gives pixels the foreground (fg) or background (bg) label, "erase" removes their
+ * label, and "cut" returns the foreground as runs of pixels in buffer order (see PixelRuns). A request that fails gets
+ * "error message" instead.
+ *
+ * The loads and cuts run on a fixed pool of worker threads. The images are kept in an LRU cache together with what the
+ * cuts keep of them (the graph with its n-links, the bin indices, the pyramid), so a cut of an image that is in the
+ * cache only computes the t-links and the max-flow, whichever session it is for. The least recently used images are
+ * evicted when the cache takes more than its memory budget.
+ *
+ * The requests that a connection sends at once (before it reads the replies) are a batch: they are queued together,
+ * and a worker takes all of the queued requests of an image at once and runs them one after the other while the image
+ * is locked, so they share one lookup and a warm graph. Cuts of the same session with the same parameters in one batch
+ * are only computed once.
+*/
+
+// Custom
+#include "ImageFormat.h"
+#include "ImageGraphCutInterface.h"
+#include "PixelRuns.h"
+#include "RegionalCostTable.h"
+#include "SeedSet.h"
+
+// ITK
+#include <itkImageFileReader.h>
+#include <itkImageIOFactory.h>
+#include <itkMultiThreader.h>
+
+// STL
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// POSIX
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/** The seeds of a client on an image. */
+struct Session
+{
+  Session() : Loaded(false) {}
+
+  std::string ImageFileName;
+
+  /** False until the image has been loaded, so that the seeds have its region. */
+  bool Loaded;
+
+  SeedSet<2> Seeds;
+
+  std::mutex Mutex;
+};
+
+/** An image and everything that its cuts keep. GraphCut is null until the image has been loaded. The worker that
+ *  loads or cuts the image holds Mutex. */
+struct CachedImage
+{
+  CachedImage() : NumberOfComponents(0), MemorySize(0) {}
+
+  std::string FileName;
+  std::unique_ptr<ImageGraphCutInterface> GraphCut;
+  itk::ImageRegion<2> Region;
+  unsigned int NumberOfComponents;
+
+  /** The bytes that the cache counts for the image (see IncrementalImageGraphCut::GetMemorySize()). */
+  std::size_t MemorySize;
+
+  std::mutex Mutex;
+};
+
+/** The images by file name, the most recently used first. */
+class ImageCache
+{
+public:
+  ImageCache(const std::size_t memoryBudget) : MemorySize(0), MemoryBudget(memoryBudget), Hits(0), Misses(0),
+                                               Evictions(0)
+  {
+  }
+
+  /** The image of 'fileName', which becomes the most recently used one. If it is not in the cache, an entry without
+   *  a GraphCut is added for the caller to load. */
+  std::shared_ptr<CachedImage> Get(const std::string& fileName)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    std::map<std::string, ListType::iterator>::iterator entry = this->Entries.find(fileName);
+    if(entry != this->Entries.end())
+      {
+      this->Hits++;
+      this->Images.splice(this->Images.begin(), this->Images, entry->second);
+      return entry->second->second;
+      }
+
+    this->Misses++;
+    std::shared_ptr<CachedImage> image = std::make_shared<CachedImage>();
+    image->FileName = fileName;
+    this->Images.push_front(std::make_pair(fileName, image));
+    this->Entries[fileName] = this->Images.begin();
+    return image;
+  }
+
+  /** Count 'memorySize' bytes for 'image', which the caller has just used, and evict the least recently used images
+   *  until the cache fits its budget. Images that a worker is using are not evicted, and neither is 'image', however
+   *  large it is. */
+  void Update(const std::shared_ptr<CachedImage>& image, const std::size_t memorySize)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+
+    // The image may have been removed while it was used
+    std::map<std::string, ListType::iterator>::iterator entry = this->Entries.find(image->FileName);
+    if(entry == this->Entries.end() || entry->second->second != image)
+      {
+      return;
+      }
+
+    this->MemorySize += memorySize;
+    this->MemorySize -= image->MemorySize;
+    image->MemorySize = memorySize;
+
+    ListType::iterator candidate = this->Images.end();
+    while(this->MemorySize > this->MemoryBudget && candidate != this->Images.begin())
+      {
+      --candidate;
+
+      // Only the cache holds an image that no worker uses
+      if(candidate->second == image || candidate->second.use_count() > 1)
+        {
+        continue;
+        }
+
+      this->MemorySize -= candidate->second->MemorySize;
+      this->Evictions++;
+      this->Entries.erase(candidate->first);
+      candidate = this->Images.erase(candidate);
+      }
+  }
+
+  /** Forget the image of 'fileName', e.g. because it could not be loaded. */
+  void Remove(const std::string& fileName)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    std::map<std::string, ListType::iterator>::iterator entry = this->Entries.find(fileName);
+    if(entry != this->Entries.end())
+      {
+      this->MemorySize -= entry->second->second->MemorySize;
+      this->Images.erase(entry->second);
+      this->Entries.erase(entry);
+      }
+  }
+
+  /** "images bytes budget hits misses evictions" */
+  std::string GetStatistics()
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    std::stringstream ss;
+    ss << this->Images.size() << " " << this->MemorySize << " " << this->MemoryBudget << " " << this->Hits << " "
+       << this->Misses << " " << this->Evictions;
+    return ss.str();
+  }
+
+protected:
+  typedef std::list<std::pair<std::string, std::shared_ptr<CachedImage> > > ListType;
+  ListType Images;
+  std::map<std::string, ListType::iterator> Entries;
+
+  std::size_t MemorySize;
+  std::size_t MemoryBudget;
+
+  unsigned long long Hits;
+  unsigned long long Misses;
+  unsigned long long Evictions;
+
+  std::mutex Mutex;
+};
+
+/** A load or a cut, for a worker. The connection that sent it waits for Reply. */
+struct Request
+{
+  enum Type {Load, Cut};
+
+  Type RequestType;
+  std::shared_ptr<Session> ClientSession;
+  std::string ImageFileName;
+
+  /** Only for a cut. */
+  float Lambda;
+  int NumberOfHistogramBins;
+
+  std::promise<std::string> Reply;
+};
+
+/** Read 'fileName' as a TImage into 'image'. */
+template <typename TImage>
+static void LoadImage(const std::string& fileName, CachedImage& image)
+{
+  typedef itk::ImageFileReader<TImage> ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(fileName);
+  reader->Update();
+
+  ImageGraphCutAdapter<TImage>* graphCut = new ImageGraphCutAdapter<TImage>;
+  graphCut->GetGraphCut().SetImage(reader->GetOutput());
+  image.Region = reader->GetOutput()->GetLargestPossibleRegion();
+  image.NumberOfComponents = reader->GetOutput()->GetNumberOfComponentsPerPixel();
+  image.GraphCut.reset(graphCut);
+}
+
+/** Read 'fileName' in the pixel type that ImageFormat chooses for it. */
+static void LoadImage(const std::string& fileName, CachedImage& image)
+{
+  switch(ImageFormat::ReadPixelFormat(fileName))
+    {
+    case ImageFormat::RGB:
+      LoadImage<ImageFormat::RGBImageType>(fileName, image);
+      break;
+    case ImageFormat::Gray:
+      LoadImage<ImageFormat::GrayImageType>(fileName, image);
+      break;
+    case ImageFormat::Gray16:
+      LoadImage<ImageFormat::Gray16ImageType>(fileName, image);
+      break;
+    default:
+      LoadImage<ImageFormat::VectorImageType>(fileName, image);
+      break;
+    }
+}
+
+/** Cut 'image' with the seeds of 'session'. The reply is the foreground as PixelRuns. */
+static std::string Cut(CachedImage& image, Session& session, const float lambda, const int numberOfHistogramBins)
+{
+  {
+  std::lock_guard<std::mutex> lock(session.Mutex);
+  if(!session.Loaded || session.ImageFileName != image.FileName)
+    {
+    return "error the image of the session has changed";
+    }
+  image.GraphCut->SetSeeds(session.Seeds);
+  }
+
+  // The bins of all the components of a pixel have to fit in the keys of the RegionalCostTable
+  const int maximumNumberOfHistogramBins = RegionalCostTable::GetMaximumNumberOfHistogramBins(image.NumberOfComponents);
+  if(numberOfHistogramBins > maximumNumberOfHistogramBins)
+    {
+    std::stringstream ss;
+    ss << "error at most " << maximumNumberOfHistogramBins << " bins for " << image.NumberOfComponents
+       << " components";
+    return ss.str();
+    }
+
+  image.GraphCut->SetLambda(lambda);
+  image.GraphCut->SetNumberOfHistogramBins(numberOfHistogramBins);
+  image.GraphCut->PerformSegmentation();
+
+  Mask* segmentMask = image.GraphCut->GetSegmentMask();
+  std::vector<unsigned int> runs;
+  PixelRuns::Encode(segmentMask->GetBufferPointer(), image.Region.GetNumberOfPixels(), segmentMask->GetHoleValue(),
+                    runs);
+
+  std::stringstream ss;
+  ss << "ok " << runs.size() / 2;
+  for(unsigned int i = 0; i < runs.size(); ++i)
+    {
+    ss << " " << runs[i];
+    }
+  return ss.str();
+}
+
+/** "error message" on one line (the message of an itk::ExceptionObject has several). */
+static std::string ErrorReply(std::string message)
+{
+  std::replace(message.begin(), message.end(), '\n', ' ');
+  return "error " + message;
+}
+
+/** A fixed number of threads that run the loads and cuts. */
+class WorkerPool
+{
+public:
+  WorkerPool(const unsigned int numberOfWorkers, ImageCache& cache) : Stopping(false), Cache(cache)
+  {
+    for(unsigned int worker = 0; worker < numberOfWorkers; ++worker)
+      {
+      this->Workers.push_back(std::thread(&WorkerPool::Work, this));
+      }
+  }
+
+  ~WorkerPool()
+  {
+    {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Stopping = true;
+    }
+    this->QueueChanged.notify_all();
+    for(unsigned int worker = 0; worker < this->Workers.size(); ++worker)
+      {
+      this->Workers[worker].join();
+      }
+  }
+
+  /** Queue the requests of a batch. */
+  void Submit(const std::vector<std::shared_ptr<Request> >& requests)
+  {
+    {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Queue.insert(this->Queue.end(), requests.begin(), requests.end());
+    }
+    this->QueueChanged.notify_all();
+  }
+
+protected:
+
+  void Work()
+  {
+    while(true)
+      {
+      // Take the oldest request and every other queued request of its image
+      std::vector<std::shared_ptr<Request> > batch;
+      {
+      std::unique_lock<std::mutex> lock(this->Mutex);
+      this->QueueChanged.wait(lock, [this]() { return this->Stopping || !this->Queue.empty(); });
+      if(this->Queue.empty())
+        {
+        return;
+        }
+
+      const std::string fileName = this->Queue.front()->ImageFileName;
+      std::deque<std::shared_ptr<Request> >::iterator request = this->Queue.begin();
+      while(request != this->Queue.end())
+        {
+        if((*request)->ImageFileName == fileName)
+          {
+          batch.push_back(*request);
+          request = this->Queue.erase(request);
+          }
+        else
+          {
+          ++request;
+          }
+        }
+      }
+
+      RunBatch(batch);
+      }
+  }
+
+  /** Run the requests of 'batch', which are all for the same image, in order. */
+  void RunBatch(const std::vector<std::shared_ptr<Request> >& batch)
+  {
+    const std::string& fileName = batch[0]->ImageFileName;
+    std::shared_ptr<CachedImage> image = this->Cache.Get(fileName);
+
+    std::unique_lock<std::mutex> lock(image->Mutex);
+    if(!image->GraphCut)
+      {
+      // Every request of the batch has to get a reply, whatever the load throws (e.g. std::bad_alloc)
+      std::string error;
+      try
+        {
+        LoadImage(fileName, *image);
+        image->GraphCut->SetNumberOfThreads(1);
+        }
+      catch(itk::ExceptionObject&)
+        {
+        error = "error could not read " + fileName;
+        }
+      catch(std::exception& e)
+        {
+        error = ErrorReply("could not load " + fileName + ": " + e.what());
+        }
+      catch(...)
+        {
+        error = "error could not load " + fileName;
+        }
+      if(!error.empty())
+        {
+        image->GraphCut.reset();
+        lock.unlock();
+        this->Cache.Remove(fileName);
+        for(unsigned int i = 0; i < batch.size(); ++i)
+          {
+          batch[i]->Reply.set_value(error);
+          }
+        return;
+        }
+      }
+
+    std::vector<bool> replied(batch.size(), false);
+    for(unsigned int i = 0; i < batch.size(); ++i)
+      {
+      if(replied[i])
+        {
+        continue;
+        }
+
+      Request& request = *batch[i];
+      if(request.RequestType == Request::Load)
+        {
+        std::lock_guard<std::mutex> sessionLock(request.ClientSession->Mutex);
+        if(request.ClientSession->ImageFileName == fileName)
+          {
+          request.ClientSession->Seeds.SetRegion(image->Region);
+          request.ClientSession->Loaded = true;
+          }
+        std::stringstream ss;
+        ss << "ok " << image->Region.GetSize()[0] << " " << image->Region.GetSize()[1];
+        request.Reply.set_value(ss.str());
+        continue;
+        }
+
+      std::string reply;
+      try
+        {
+        reply = Cut(*image, *request.ClientSession, request.Lambda, request.NumberOfHistogramBins);
+        }
+      catch(std::exception& e)
+        {
+        reply = ErrorReply(e.what());
+        }
+      catch(...)
+        {
+        reply = "error the cut failed";
+        }
+
+      // The same cut later in the batch would give the same segment, unless the session is loaded again before it
+      for(unsigned int j = i; j < batch.size() && !(batch[j]->RequestType == Request::Load &&
+                                                    batch[j]->ClientSession == request.ClientSession); ++j)
+        {
+        if(batch[j]->RequestType == Request::Cut && batch[j]->ClientSession == request.ClientSession &&
+           batch[j]->Lambda == request.Lambda && batch[j]->NumberOfHistogramBins == request.NumberOfHistogramBins)
+          {
+          batch[j]->Reply.set_value(reply);
+          replied[j] = true;
+          }
+        }
+      }
+
+    const std::size_t memorySize = image->GraphCut->GetMemorySize();
+    lock.unlock();
+    this->Cache.Update(image, memorySize);
+  }
+
+  std::deque<std::shared_ptr<Request> > Queue;
+  std::mutex Mutex;
+  std::condition_variable QueueChanged;
+  bool Stopping;
+
+  std::vector<std::thread> Workers;
+  ImageCache& Cache;
+};
+
+/** The sessions of all of the connections, by name. */
+class SessionRegistry
+{
+public:
+  /** The session 'name', which is created if it does not exist. */
+  std::shared_ptr<Session> Open(const std::string& name)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    std::shared_ptr<Session>& session = this->Sessions[name];
+    if(!session)
+      {
+      session = std::make_shared<Session>();
+      }
+    return session;
+  }
+
+  /** The session 'name', or null if there is none. */
+  std::shared_ptr<Session> Find(const std::string& name)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    std::map<std::string, std::shared_ptr<Session> >::iterator session = this->Sessions.find(name);
+    return (session == this->Sessions.end()) ? std::shared_ptr<Session>() : session->second;
+  }
+
+  void Close(const std::string& name)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Sessions.erase(name);
+  }
+
+protected:
+  std::map<std::string, std::shared_ptr<Session> > Sessions;
+  std::mutex Mutex;
+};
+
+/** Read the pixels "x y x y ..." that follow the words of a request that have already been read from 'ss'. Returns
+ *  false if they are not pairs of numbers. */
+static bool ReadPixels(std::stringstream& ss, std::vector<itk::Index<2> >& pixels)
+{
+  itk::Index<2> pixel;
+  while(ss >> pixel[0])
+    {
+    if(!(ss >> pixel[1]))
+      {
+      return false;
+      }
+    pixels.push_back(pixel);
+    }
+  return ss.eof();
+}
+
+/** The number of connections that are being served, so that there is a bounded number of connection threads. */
+class ConnectionLimit
+{
+public:
+  ConnectionLimit(const unsigned int maximumNumberOfConnections) :
+    MaximumNumberOfConnections(maximumNumberOfConnections), NumberOfConnections(0)
+  {
+  }
+
+  /** Wait until fewer than the maximum number of connections are served, and count one more. */
+  void Acquire()
+  {
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    this->Changed.wait(lock, [this]() { return this->NumberOfConnections < this->MaximumNumberOfConnections; });
+    this->NumberOfConnections++;
+  }
+
+  /** A connection was closed. */
+  void Release()
+  {
+    {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->NumberOfConnections--;
+    }
+    this->Changed.notify_one();
+  }
+
+protected:
+  const unsigned int MaximumNumberOfConnections;
+  unsigned int NumberOfConnections;
+  std::mutex Mutex;
+  std::condition_variable Changed;
+};
+
+/** What a connection does with one request line: either reply to it at once, or create a Request for the workers. */
+class Connection
+{
+public:
+  Connection(const int socket, SessionRegistry& sessions, WorkerPool& pool, ImageCache& cache) :
+    Socket(socket), Sessions(sessions), Pool(pool), Cache(cache)
+  {
+  }
+
+  /** Read and answer requests until the client closes the connection. */
+  void Serve()
+  {
+    std::string buffer;
+    char data[65536];
+    while(true)
+      {
+      const ssize_t numberOfBytes = recv(this->Socket, data, sizeof(data), 0);
+      if(numberOfBytes <= 0)
+        {
+        break;
+        }
+      buffer.append(data, numberOfBytes);
+
+      // Every complete line that has arrived is part of the batch
+      std::string::size_type lineStart = 0;
+      std::string::size_type lineEnd;
+      while((lineEnd = buffer.find('\n', lineStart)) != std::string::npos)
+        {
+        HandleLine(buffer.substr(lineStart, lineEnd - lineStart));
+        lineStart = lineEnd + 1;
+        }
+      buffer.erase(0, lineStart);
+
+      if(!Flush() || buffer.size() > MaximumLineLength)
+        {
+        break;
+        }
+      }
+    Flush();
+    close(this->Socket);
+  }
+
+protected:
+
+  /** Answer 'line', or queue it if it is a load or a cut. */
+  void HandleLine(const std::string& line)
+  {
+    std::stringstream ss(line);
+    std::string command;
+    std::string sessionName;
+    if(!(ss >> command))
+      {
+      return;
+      }
+
+    if(command == "stats")
+      {
+      Reply("ok " + this->Cache.GetStatistics());
+      return;
+      }
+
+    if(command != "load" && command != "seeds" && command != "erase" && command != "clear" && command != "cut" &&
+       command != "close")
+      {
+      Reply("error unknown request " + command);
+      return;
+      }
+
+    if(!(ss >> sessionName))
+      {
+      Reply("error expected '" + command + " session ...'");
+      return;
+      }
+
+    if(command == "load")
+      {
+      std::string imageFileName;
+      if(!(ss >> imageFileName))
+        {
+        Reply("error expected 'load session image'");
+        return;
+        }
+
+      std::shared_ptr<Session> session = this->Sessions.Open(sessionName);
+      {
+      std::lock_guard<std::mutex> lock(session->Mutex);
+      session->ImageFileName = imageFileName;
+      session->Loaded = false;
+      }
+      Queue(Request::Load, session, 0, 0);
+      return;
+      }
+
+    if(command == "close")
+      {
+      this->Sessions.Close(sessionName);
+      Reply("ok");
+      return;
+      }
+
+    std::shared_ptr<Session> session = this->Sessions.Find(sessionName);
+    if(!session)
+      {
+      Reply("error no session " + sessionName);
+      return;
+      }
+
+    if(command == "cut")
+      {
+      float lambda;
+      int numberOfHistogramBins;
+      if(!(ss >> lambda >> numberOfHistogramBins) || lambda <= 0 || numberOfHistogramBins <= 0)
+        {
+        Reply("error expected 'cut session lambda bins' with lambda > 0 and bins > 0");
+        return;
+        }
+      Queue(Request::Cut, session, lambda, numberOfHistogramBins);
+      return;
+      }
+
+    // The seeds change in the order of the requests, so the queued loads and cuts of this connection run first
+    Flush();
+
+    std::string labelName;
+    if(command == "seeds" && !(ss >> labelName && (labelName == "fg" || labelName == "bg")))
+      {
+      Reply("error expected 'seeds session fg|bg x y ...'");
+      return;
+      }
+
+    std::vector<itk::Index<2> > pixels;
+    if((command == "seeds" || command == "erase") && !ReadPixels(ss, pixels))
+      {
+      Reply("error expected pairs of pixel coordinates");
+      return;
+      }
+
+    std::lock_guard<std::mutex> lock(session->Mutex);
+    if(!session->Loaded)
+      {
+      Reply("error the image of session " + sessionName + " is not loaded");
+      }
+    else if(command == "seeds")
+      {
+      session->Seeds.Add(pixels, labelName == "fg" ? SeedSet<2>::Source : SeedSet<2>::Sink);
+      Reply("ok");
+      }
+    else if(command == "erase")
+      {
+      session->Seeds.Remove(pixels);
+      Reply("ok");
+      }
+    else
+      {
+      session->Seeds.Clear();
+      Reply("ok");
+      }
+  }
+
+  void Queue(const Request::Type type, const std::shared_ptr<Session>& session, const float lambda,
+             const int numberOfHistogramBins)
+  {
+    std::shared_ptr<Request> request = std::make_shared<Request>();
+    request->RequestType = type;
+    request->ClientSession = session;
+    {
+    std::lock_guard<std::mutex> lock(session->Mutex);
+    request->ImageFileName = session->ImageFileName;
+    }
+    request->Lambda = lambda;
+    request->NumberOfHistogramBins = numberOfHistogramBins;
+
+    this->Replies.push_back(request->Reply.get_future());
+    this->Batch.push_back(request);
+  }
+
+  /** A reply that is known at once still has to wait for the replies to the requests before it. */
+  void Reply(const std::string& reply)
+  {
+    std::promise<std::string> promise;
+    promise.set_value(reply);
+    this->Replies.push_back(promise.get_future());
+  }
+
+  /** Submit the batch, wait for all of the replies and send them. Returns false if they could not be sent. */
+  bool Flush()
+  {
+    if(!this->Batch.empty())
+      {
+      this->Pool.Submit(this->Batch);
+      this->Batch.clear();
+      }
+
+    std::string replies;
+    for(unsigned int i = 0; i < this->Replies.size(); ++i)
+      {
+      replies += this->Replies[i].get() + "\n";
+      }
+    this->Replies.clear();
+
+    std::string::size_type sent = 0;
+    while(sent < replies.size())
+      {
+      const ssize_t numberOfBytes = send(this->Socket, replies.data() + sent, replies.size() - sent, 0);
+      if(numberOfBytes <= 0)
+        {
+        return false;
+        }
+      sent += numberOfBytes;
+      }
+    return true;
+  }
+
+  /** A longer line (e.g. with millions of seeds) closes the connection. */
+  static const std::string::size_type MaximumLineLength = 1 << 28;
+
+  int Socket;
+  SessionRegistry& Sessions;
+  WorkerPool& Pool;
+  ImageCache& Cache;
+
+  /** The loads and cuts that have not been submitted yet. */
+  std::vector<std::shared_ptr<Request> > Batch;
+
+  /** The replies to the requests that have been read, in order. */
+  std::vector<std::future<std::string> > Replies;
+};
+
+static void Usage(const char* programName)
+{
+  std::cerr << "Usage: " << programName << " socketPath [numberOfWorkers] [cacheMegabytes] [maximumConnections]"
+            << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  if(argc < 2 || argc > 5)
+    {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+    }
+
+  const std::string socketPath = argv[1];
+
+  unsigned int numberOfWorkers = std::thread::hardware_concurrency();
+  if(argc >= 3)
+    {
+    numberOfWorkers = atoi(argv[2]);
+    }
+  if(numberOfWorkers == 0)
+    {
+    numberOfWorkers = 1;
+    }
+
+  std::size_t cacheMegabytes = 1024;
+  if(argc >= 4)
+    {
+    cacheMegabytes = atoi(argv[3]);
+    }
+
+  int maximumConnections = 64;
+  if(argc == 5)
+    {
+    maximumConnections = atoi(argv[4]);
+    }
+  if(maximumConnections <= 0)
+    {
+    std::cerr << "maximumConnections must be > 0" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  sockaddr_un address;
+  if(socketPath.size() >= sizeof(address.sun_path))
+    {
+    std::cerr << "The socket path is too long: " << socketPath << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The parallelism is across requests, so don't let ITK filters spawn their own threads as well.
+  itk::MultiThreader::SetGlobalDefaultNumberOfThreads(1);
+
+  // Register the ImageIO factories once from this thread instead of racing on them from the workers.
+  itk::ImageIOFactory::CreateImageIO("", itk::ImageIOFactory::ReadMode);
+
+  // A client that disconnects before its replies are sent must not stop the server
+  signal(SIGPIPE, SIG_IGN);
+
+  const int listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  address.sun_family = AF_UNIX;
+  std::copy(socketPath.begin(), socketPath.end(), address.sun_path);
+  address.sun_path[socketPath.size()] = '\0';
+  unlink(socketPath.c_str());
+  if(listenSocket < 0 || bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+     listen(listenSocket, SOMAXCONN) != 0)
+    {
+    std::cerr << "Could not listen on " << socketPath << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  ImageCache cache(cacheMegabytes << 20);
+  WorkerPool pool(numberOfWorkers, cache);
+  SessionRegistry sessions;
+  ConnectionLimit connectionLimit(maximumConnections);
+
+  std::cout << "Listening on " << socketPath << " with " << numberOfWorkers << " workers, a cache of "
+            << cacheMegabytes << " MB and at most " << maximumConnections << " connections." << std::endl;
+
+  while(true)
+    {
+    // Once the limit is reached, new clients wait in the backlog of the socket until a connection is closed
+    connectionLimit.Acquire();
+    const int clientSocket = accept(listenSocket, NULL, NULL);
+    if(clientSocket < 0)
+      {
+      connectionLimit.Release();
+      continue;
+      }
+
+    // A connection mostly waits for its client or for the workers, so it gets a thread of its own
+    std::thread([clientSocket, &sessions, &pool, &cache, &connectionLimit]()
+      {
+      Connection connection(clientSocket, sessions, pool, cache);
+      connection.Serve();
+      connectionLimit.Release();
+      }).detach();
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,287 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SessionFile.h"
+
+// STL
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char SessionFile::Magic[8] = {'G', 'C', 'S', 'E', 'S', 'S', 'N', '\0'};
+
+const unsigned int SessionFile::Version;
+
+const unsigned int SessionFile::ByteOrder;
+
+const unsigned long long SessionFile::SectionAlignment;
+
+SessionFile::SessionFile() : Data(NULL), DataSize(0)
+{
+  std::memset(&this->OpenContents, 0, sizeof(Contents));
+}
+
+SessionFile::~SessionFile()
+{
+  Close();
+}
+
+bool SessionFile::Write(const std::string& fileName, const Contents& contents)
+{
+  const unsigned long long numberOfPixels = static_cast<unsigned long long>(contents.Width) * contents.Height;
+
+  Header header;
+  std::memset(&header, 0, sizeof(Header));
+  std::memcpy(header.Magic, Magic, sizeof(Magic));
+  header.Version = Version;
+  header.ByteOrder = ByteOrder;
+  header.PixelFormat = contents.PixelFormat;
+  header.NumberOfComponents = contents.NumberOfComponents;
+  header.Width = contents.Width;
+  header.Height = contents.Height;
+  header.CutSettings = contents.CutSettings;
+
+  // Lay the sections out one after the other
+  const void* sectionData[5] = {contents.ImageBuffer, contents.SourceRuns, contents.SinkRuns, contents.SegmentRuns,
+                                contents.NWeights};
+  Section* sections[5] = {&header.Image, &header.SourceRuns, &header.SinkRuns, &header.SegmentRuns, &header.NWeights};
+  sections[0]->Size = numberOfPixels * contents.NumberOfComponents *
+                      ImageFormat::GetComponentSize(contents.PixelFormat);
+  sections[1]->Size = 2 * contents.NumberOfSourceRuns * sizeof(unsigned int);
+  sections[2]->Size = 2 * contents.NumberOfSinkRuns * sizeof(unsigned int);
+  sections[3]->Size = 2 * contents.NumberOfSegmentRuns * sizeof(unsigned int);
+  sections[4]->Size = contents.NWeights ? 2 * numberOfPixels * sizeof(float) : 0;
+
+  unsigned long long offset = sizeof(Header);
+  for(unsigned int section = 0; section < 5; ++section)
+    {
+    offset = (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+    sections[section]->Offset = offset;
+    offset += sections[section]->Size;
+    }
+
+  // The contents can point into the map of 'fileName' (e.g. the image of a session that was opened from it), so the
+  // file is written next to it and then replaces it. The map keeps the old file until it is closed.
+  const std::string temporaryFileName = fileName + ".tmp";
+  std::ofstream file(temporaryFileName.c_str(), std::ios::binary);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+  const char padding[SectionAlignment] = {0};
+  unsigned long long position = sizeof(Header);
+  for(unsigned int section = 0; section < 5; ++section)
+    {
+    file.write(padding, sections[section]->Offset - position);
+    file.write(static_cast<const char*>(sectionData[section]), sections[section]->Size);
+    position = sections[section]->Offset + sections[section]->Size;
+    }
+  file.close();
+  if(file.fail())
+    {
+    std::remove(temporaryFileName.c_str());
+    return false;
+    }
+
+#if !(defined(__unix__) || defined(__APPLE__))
+  // rename() does not replace an existing file on Windows. Nothing maps it there (Open() reads a copy).
+  std::remove(fileName.c_str());
+#endif
+  if(std::rename(temporaryFileName.c_str(), fileName.c_str()) != 0)
+    {
+    std::remove(temporaryFileName.c_str());
+    return false;
+    }
+  return true;
+}
+
+bool SessionFile::IsSessionFile(const std::string& fileName)
+{
+  char magic[sizeof(Magic)];
+  std::ifstream file(fileName.c_str(), std::ios::binary);
+  return file.read(magic, sizeof(magic)) && std::memcmp(magic, Magic, sizeof(Magic)) == 0;
+}
+
+bool SessionFile::IsValid(const Header& header, const char* const data, const unsigned long long fileSize)
+{
+  if(std::memcmp(header.Magic, Magic, sizeof(Magic)) != 0 || header.Version != Version ||
+     header.ByteOrder != ByteOrder || header.PixelFormat > ImageFormat::Vector || header.NumberOfComponents == 0)
+    {
+    return false;
+    }
+
+  const unsigned long long numberOfPixels = static_cast<unsigned long long>(header.Width) * header.Height;
+  if(numberOfPixels == 0 || numberOfPixels > 0xffffffffull)
+    {
+    return false;
+    }
+
+  const Section* sections[5] = {&header.Image, &header.SourceRuns, &header.SinkRuns, &header.SegmentRuns,
+                                &header.NWeights};
+  for(unsigned int section = 0; section < 5; ++section)
+    {
+    if(sections[section]->Offset % SectionAlignment != 0 || sections[section]->Offset > fileSize ||
+       sections[section]->Size > fileSize - sections[section]->Offset)
+      {
+      return false;
+      }
+    }
+
+  // Only a VectorImage has a number of components of its own
+  const ImageFormat::PixelFormat format = static_cast<ImageFormat::PixelFormat>(header.PixelFormat);
+  if(format != ImageFormat::Vector && header.NumberOfComponents != (format == ImageFormat::RGB ? 3u : 1u))
+    {
+    return false;
+    }
+
+  // The image has to fit in the file, which also keeps its size from overflowing
+  const unsigned long long pixelSize = static_cast<unsigned long long>(header.NumberOfComponents) *
+                                       ImageFormat::GetComponentSize(format);
+  if(pixelSize > fileSize / numberOfPixels)
+    {
+    return false;
+    }
+  const unsigned long long imageSize = numberOfPixels * pixelSize;
+  if(header.Image.Size != imageSize ||
+     (header.NWeights.Size != 0 && header.NWeights.Size != 2 * numberOfPixels * sizeof(float)))
+    {
+    return false;
+    }
+
+  // A run outside of the image would be written outside of the buffers of the seeds and the segment
+  for(unsigned int section = 1; section < 4; ++section)
+    {
+    if(sections[section]->Size % (2 * sizeof(unsigned int)) != 0)
+      {
+      return false;
+      }
+    const unsigned int* runs = reinterpret_cast<const unsigned int*>(data + sections[section]->Offset);
+    for(std::size_t run = 0; run < sections[section]->Size / (2 * sizeof(unsigned int)); ++run)
+      {
+      if(static_cast<unsigned long long>(runs[2 * run]) + runs[2 * run + 1] > numberOfPixels)
+        {
+        return false;
+        }
+      }
+    }
+
+  // The n-weights go into the graph as they are, and a NaN, infinite or negative capacity breaks the max-flow
+  const float* nWeights = reinterpret_cast<const float*>(data + header.NWeights.Offset);
+  for(std::size_t weight = 0; weight < header.NWeights.Size / sizeof(float); ++weight)
+    {
+    if(!std::isfinite(nWeights[weight]) || nWeights[weight] < 0)
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+bool SessionFile::Open(const std::string& fileName)
+{
+  void* data = NULL;
+  std::size_t dataSize = 0;
+  std::vector<unsigned long long> dataCopy;
+
+#if defined(__unix__) || defined(__APPLE__)
+  int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+  if(fileDescriptor < 0)
+    {
+    return false;
+    }
+  struct stat status;
+  if(fstat(fileDescriptor, &status) == 0 && status.st_size >= static_cast<off_t>(sizeof(Header)))
+    {
+    dataSize = status.st_size;
+    data = mmap(NULL, dataSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0);
+    }
+  close(fileDescriptor);
+  if(data == NULL || data == MAP_FAILED)
+    {
+    return false;
+    }
+#else
+  std::ifstream file(fileName.c_str(), std::ios::binary | std::ios::ate);
+  if(!file || static_cast<std::size_t>(file.tellg()) < sizeof(Header))
+    {
+    return false;
+    }
+  dataSize = file.tellg();
+  dataCopy.resize((dataSize + sizeof(unsigned long long) - 1) / sizeof(unsigned long long));
+  file.seekg(0);
+  if(!file.read(reinterpret_cast<char*>(&dataCopy[0]), dataSize))
+    {
+    return false;
+    }
+  data = &dataCopy[0];
+#endif
+
+  const Header& header = *static_cast<const Header*>(data);
+  if(!IsValid(header, static_cast<const char*>(data), dataSize))
+    {
+#if defined(__unix__) || defined(__APPLE__)
+    munmap(data, dataSize);
+#endif
+    return false;
+    }
+
+  Close();
+  this->Data = data;
+  this->DataSize = dataSize;
+  this->DataCopy.swap(dataCopy);
+
+  char* bytes = static_cast<char*>(this->Data);
+  this->OpenContents.PixelFormat = static_cast<ImageFormat::PixelFormat>(header.PixelFormat);
+  this->OpenContents.Width = header.Width;
+  this->OpenContents.Height = header.Height;
+  this->OpenContents.NumberOfComponents = header.NumberOfComponents;
+  this->OpenContents.ImageBuffer = bytes + header.Image.Offset;
+  this->OpenContents.CutSettings = header.CutSettings;
+  this->OpenContents.SourceRuns = reinterpret_cast<const unsigned int*>(bytes + header.SourceRuns.Offset);
+  this->OpenContents.NumberOfSourceRuns = header.SourceRuns.Size / (2 * sizeof(unsigned int));
+  this->OpenContents.SinkRuns = reinterpret_cast<const unsigned int*>(bytes + header.SinkRuns.Offset);
+  this->OpenContents.NumberOfSinkRuns = header.SinkRuns.Size / (2 * sizeof(unsigned int));
+  this->OpenContents.SegmentRuns = reinterpret_cast<const unsigned int*>(bytes + header.SegmentRuns.Offset);
+  this->OpenContents.NumberOfSegmentRuns = header.SegmentRuns.Size / (2 * sizeof(unsigned int));
+  this->OpenContents.NWeights = header.NWeights.Size ? reinterpret_cast<const float*>(bytes + header.NWeights.Offset) :
+                                                       NULL;
+  return true;
+}
+
+const SessionFile::Contents& SessionFile::GetContents() const
+{
+  return this->OpenContents;
+}
+
+void SessionFile::Close()
+{
+#if defined(__unix__) || defined(__APPLE__)
+  if(this->Data)
+    {
+    munmap(this->Data, this->DataSize);
+    }
+#endif
+  this->Data = NULL;
+  this->DataSize = 0;
+  this->DataCopy.clear();
+  std::memset(&this->OpenContents, 0, sizeof(Contents));
+}
@@ -0,0 +1,141 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* A binary file with everything that is needed to continue segmenting an image: the pixels of the image, the seeds,
+ * the settings of the cut, the last segment and, if the graph had been created, its n-links.
+ *
+ * The file is a Header followed by its sections, each of which starts on a multiple of SectionAlignment bytes. The
+ * image is the buffer of the image as it is in memory (interleaved components of the size of its ImageFormat), and
+ * the seeds and the segment are stored as PixelRuns. Open() maps the file into memory instead of reading it, so the
+ * image is used where it is in the file: opening a session only touches the pages that are read, and there is
+ * nothing to decode. The map is private, so writing to the image does not change the file.
+ *
+ * The numbers are stored in the byte order of the machine that wrote the file, and Open() rejects files of the
+ * other byte order or of another Version.
+*/
+
+#ifndef SessionFile_H
+#define SessionFile_H
+
+// Custom
+#include "ImageFormat.h"
+
+// STL
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class SessionFile
+{
+public:
+  /** The settings of the cut, as the GUI shows them: lambda is LambdaPercent% of LambdaMax. */
+  struct Settings
+  {
+    double LambdaMax;
+    int LambdaPercent;
+    int NumberOfHistogramBins;
+    unsigned int NumberOfResolutionLevels;
+    unsigned int SuperpixelSize;
+  };
+
+  /** What a session holds. The runs are (first offset, length) pairs of PixelRuns. NWeights (see
+   *  IncrementalImageGraphCut::GetNWeights()) is null if the session has none. */
+  struct Contents
+  {
+    ImageFormat::PixelFormat PixelFormat;
+    unsigned int Width;
+    unsigned int Height;
+    unsigned int NumberOfComponents;
+    void* ImageBuffer;
+
+    Settings CutSettings;
+
+    const unsigned int* SourceRuns;
+    std::size_t NumberOfSourceRuns;
+    const unsigned int* SinkRuns;
+    std::size_t NumberOfSinkRuns;
+    const unsigned int* SegmentRuns;
+    std::size_t NumberOfSegmentRuns;
+
+    const float* NWeights;
+  };
+
+  static const unsigned int Version = 1;
+
+  SessionFile();
+  ~SessionFile();
+
+  /** Write 'contents' to 'fileName'. The file is written to fileName.tmp first and then renamed, so 'contents' may
+   *  point into the open map of 'fileName'. Returns false if the file could not be written. */
+  static bool Write(const std::string& fileName, const Contents& contents);
+
+  /** True if 'fileName' starts like a session file. */
+  static bool IsSessionFile(const std::string& fileName);
+
+  /** Map 'fileName' into memory. Returns false if it could not be opened or is not a valid session of this
+   *  Version, in which case the file that was open before is still open. */
+  bool Open(const std::string& fileName);
+
+  /** The contents of the open file. The buffers point into the map, so they are valid until the next Open() or
+   *  until this is destroyed. */
+  const Contents& GetContents() const;
+
+protected:
+
+  struct Section
+  {
+    unsigned long long Offset;
+    unsigned long long Size;
+  };
+
+  struct Header
+  {
+    char Magic[8];
+    unsigned int Version;
+    unsigned int ByteOrder;
+    unsigned int PixelFormat;
+    unsigned int NumberOfComponents;
+    unsigned int Width;
+    unsigned int Height;
+    Settings CutSettings;
+    Section Image;
+    Section SourceRuns;
+    Section SinkRuns;
+    Section SegmentRuns;
+    Section NWeights;
+  };
+
+  static const char Magic[8];
+  static const unsigned int ByteOrder = 0x01020304;
+  static const unsigned long long SectionAlignment = 64;
+
+  /** Check that the sections of 'header' fit in a file of 'fileSize' bytes and have the sizes of its image, that
+   *  the runs of 'data' are inside the image and that its n-weights are finite and not negative. */
+  static bool IsValid(const Header& header, const char* const data, const unsigned long long fileSize);
+
+  /** Unmap the open file. */
+  void Close();
+
+  /** The map of the file, or (where there is no mmap) a copy of it. */
+  void* Data;
+  std::size_t DataSize;
+  std::vector<unsigned long long> DataCopy;
+
+  Contents OpenContents;
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Segment a single image that may be larger than memory, tile by tile (see StreamingImageGraphCut).
+ * The arguments are the same as a line of the BatchGraphCutSegmentation manifest, plus the tile size:
+ *
+ *   image foreground background lambda bins output [tileSize] [overlap] [numberOfThreads]
+ *
+ * Use a format that ITK can stream (e.g. .mha) for the image, the seed masks and the output.
+*/
+
+// Custom
+#include "StreamingImageGraphCut.h"
+
+// ITK
+#include <itkVectorImage.h>
+
+// STL
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+typedef itk::VectorImage<float,2> ImageType;
+
+static void Usage(const char* programName)
+{
+  std::cerr << "Usage: " << programName
+            << " image foreground background lambda bins output [tileSize] [overlap] [numberOfThreads]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  if(argc < 7 || argc > 10)
+    {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+    }
+
+  float lambda = atof(argv[4]);
+  if(lambda <= 0)
+    {
+    std::cerr << "lambda must be > 0" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  int bins = atoi(argv[5]);
+  if(bins <= 0)
+    {
+    std::cerr << "bins must be > 0" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  StreamingImageGraphCut<ImageType> graphCut;
+  graphCut.SetImageFileName(argv[1]);
+  graphCut.SetSourcesFileName(argv[2]);
+  graphCut.SetSinksFileName(argv[3]);
+  graphCut.SetLambda(lambda);
+  graphCut.SetNumberOfHistogramBins(bins);
+  graphCut.SetOutputFileName(argv[6]);
+
+  if(argc > 7)
+    {
+    graphCut.SetTileSize(atoi(argv[7]));
+    }
+  if(argc > 8)
+    {
+    graphCut.SetTileOverlap(atoi(argv[8]));
+    }
+
+  unsigned int numberOfThreads = std::thread::hardware_concurrency();
+  if(argc > 9)
+    {
+    numberOfThreads = atoi(argv[9]);
+    }
+  graphCut.SetNumberOfThreads(std::max(numberOfThreads, 1u));
+
+  try
+    {
+    graphCut.PerformSegmentation();
+    }
+  catch(itk::ExceptionObject& e)
+    {
+    std::cerr << argv[1] << " failed: " << e << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
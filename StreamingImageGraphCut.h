@@ -0,0 +1,189 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Segment an image that is too large to be held in memory. The image, the seed masks and the output
+ * mask are never loaded as a whole: every step asks the ITK readers for one tile (the requested region),
+ * and the output is written tile by tile (a paste into the output file), so memory depends on the tile size.
+ *
+ * The energy is the same as IncrementalImageGraphCut. A first pass over the tiles finds the range of
+ * the image and the noise (sigma of the boundary term), and a second one counts the seeds of every histogram
+ * bin, so the histograms and n-weights are the same as if the whole image had been loaded. Only the counts are
+ * kept, and each tile reads its seeds from the seed masks again. The tiles are then cut in raster order:
+ * - The graph of a tile also covers TileOverlap pixels to the right and below it, so the cut near those
+ *   edges sees the image on the other side. Only the labels of the tile itself are written.
+ * - The tiles above and to the left are already written. Their labels are fixed, and the n-links to them
+ *   become t-links of the pixels on the seam, so the cut continues across the seam without a visible edge.
+ *
+ * The streaming only saves memory if the file formats support it (e.g. .mha, .nrrd). A reader that can not
+ * stream reads its whole file once. If the output format can not be pasted into (e.g. .png), the mask is
+ * assembled in memory (one byte per pixel) and written at the end.
+*/
+
+#ifndef StreamingImageGraphCut_H
+#define StreamingImageGraphCut_H
+
+// Custom
+#include "GridMaxFlowGraph.h"
+#include "RegionalCostTable.h"
+
+// Submodules
+#include "Mask/Mask.h"
+
+// ITK
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+
+// STL
+#include <map>
+#include <string>
+#include <vector>
+
+template <typename TImage>
+class StreamingImageGraphCut
+{
+public:
+  StreamingImageGraphCut();
+
+  /** The image to segment. */
+  void SetImageFileName(const std::string& fileName);
+
+  /** Foreground/background seed masks of the same size as the image (any non-zero pixel is a seed). */
+  void SetSourcesFileName(const std::string& fileName);
+  void SetSinksFileName(const std::string& fileName);
+
+  /** The segment mask. The foreground pixels are its holes. */
+  void SetOutputFileName(const std::string& fileName);
+
+  /** Set the weight of the regional term relative to the boundary term. */
+  void SetLambda(const float lambda);
+
+  /** Set the number of bins per dimension of the foreground and background histograms. It must be > 0, and
+   *  a cut throws if it exceeds RegionalCostTable::GetMaximumNumberOfHistogramBins() for the image's components. */
+  void SetNumberOfHistogramBins(const int bins);
+
+  /** The width and height of the tiles that are written. The default is 1024. */
+  void SetTileSize(const unsigned int tileSize);
+
+  /** The number of pixels that the graph of a tile extends to the right and below the tile. The default is 32. */
+  void SetTileOverlap(const unsigned int overlap);
+
+  /** The number of threads used by the max-flow of each tile. The default is 1. */
+  void SetNumberOfThreads(const unsigned int numberOfThreads);
+
+  /** Read, cut and write the image. Throws an itk::ExceptionObject if a file can not be read or written. */
+  void PerformSegmentation();
+
+protected:
+
+  typedef itk::ImageFileReader<TImage> ImageReaderType;
+  typedef itk::ImageFileReader<Mask> MaskReaderType;
+  typedef itk::ImageFileWriter<Mask> MaskWriterType;
+  typedef GridMaxFlowGraph<2> GraphType;
+
+  /** Make 'region' the buffered region of the output of 'reader'. Only the requested region is read if
+   *  the file format supports it, and nothing is read if it is already buffered. */
+  template <typename TReader>
+  void ReadRegion(TReader* const reader, const itk::ImageRegion<2>& region);
+
+  /** Set the hard constraints of the seeds of the mask read by 'reader' in the graph of 'graphRegion'. */
+  void SetSeedWeights(MaskReaderType* const reader, const itk::ImageRegion<2>& graphRegion, const bool sources,
+                      std::vector<float>& sourceWeights, std::vector<float>& sinkWeights);
+
+  /** A reader for a seed mask, checked to be the size of the image. */
+  typename MaskReaderType::Pointer CreateSeedReader(const std::string& fileName);
+
+  /** The tiles of the image, in raster order. */
+  std::vector<itk::ImageRegion<2> > GetTiles() const;
+
+  /** The passes over the tiles before the cut: the range and noise of the image, then the histograms of the seeds. */
+  void ComputeImageStatistics();
+
+  /** Add the bins of the seeds of the mask read by 'reader' in 'tile' to 'histogram' (bin -> number of seeds).
+   *  The image must have 'tile' buffered. */
+  void AddSeedsToHistogram(MaskReaderType* const reader, const itk::ImageRegion<2>& tile,
+                           std::map<unsigned int, unsigned int>& histogram);
+
+  /** The histogram bin of a pixel (anything with operator[] over its components). */
+  template <typename TPixel>
+  unsigned int ComputeBinIndex(const TPixel& pixel) const;
+
+  /** Compute the -log probability of every bin under the background and foreground histograms into RegionalCosts. */
+  void CreateRegionalCosts(const std::map<unsigned int, unsigned int>& sourceHistogram,
+                           const std::map<unsigned int, unsigned int>& sinkHistogram);
+
+  /** The euclidean distance between two pixels. */
+  template <typename TPixel>
+  float PixelDifference(const TPixel& a, const TPixel& b) const;
+
+  /** The boundary term of two neighboring pixels. */
+  template <typename TPixel>
+  float ComputeNWeight(const TPixel& a, const TPixel& b) const;
+
+  /** Cut 'tile' and write its labels. 'rowAbove' holds the labels of the row above the tile and 'columnLeft'
+   *  those of the column to the left of the graph of the tile. Both are updated for the following tiles. */
+  void SegmentTile(const itk::ImageRegion<2>& tile, std::vector<unsigned char>& rowAbove,
+                   std::vector<unsigned char>& columnLeft);
+
+  /** Write the labels of 'tile' from Graph, whose node 0 is pixel 'graphCorner'. */
+  void WriteTile(const itk::ImageRegion<2>& tile, const itk::Index<2>& graphCorner);
+
+  std::string ImageFileName;
+  std::string SourcesFileName;
+  std::string SinksFileName;
+  std::string OutputFileName;
+
+  float Lambda;
+  int NumberOfHistogramBins;
+  unsigned int TileSize;
+  unsigned int TileOverlap;
+
+  typename ImageReaderType::Pointer ImageReader;
+
+  /** The seed masks. Like the image, they are read one tile at a time. */
+  typename MaskReaderType::Pointer SourcesReader;
+  typename MaskReaderType::Pointer SinksReader;
+
+  /** Writes the tiles into OutputFileName, if its format can be pasted into. */
+  typename MaskWriterType::Pointer OutputWriter;
+
+  /** The whole output, if its format can not be pasted into. */
+  Mask::Pointer OutputMask;
+
+  itk::ImageRegion<2> ImageRegion;
+  unsigned int NumberOfComponents;
+
+  /** The per-component range of the image, used as the histogram range. */
+  std::vector<float> ImageMinimum;
+  std::vector<float> ImageMaximum;
+
+  /** The number of bins per unit of each component. */
+  std::vector<float> BinScale;
+
+  /** The t-link weights of a pixel in each bin, before they are multiplied by lambda. */
+  RegionalCostTable RegionalCosts;
+
+  /** The sigma of the boundary term, from the whole image. */
+  float Sigma;
+
+  /** The graph of the current tile. It is reused so that its memory is only allocated once. */
+  GraphType Graph;
+};
+
+#include "StreamingImageGraphCut.hpp"
+
+#endif
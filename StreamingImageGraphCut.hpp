@@ -0,0 +1,559 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef StreamingImageGraphCut_HPP
+#define StreamingImageGraphCut_HPP
+
+#include "StreamingImageGraphCut.h" // Appease syntax parser
+
+// ITK
+#include <itkImageIOFactory.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+template <typename TImage>
+StreamingImageGraphCut<TImage>::StreamingImageGraphCut() :
+  Lambda(0.01), NumberOfHistogramBins(10), TileSize(1024), TileOverlap(32), NumberOfComponents(0), Sigma(1.0f)
+{
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::SetImageFileName(const std::string& fileName)
+{
+  this->ImageFileName = fileName;
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::SetSourcesFileName(const std::string& fileName)
+{
+  this->SourcesFileName = fileName;
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::SetSinksFileName(const std::string& fileName)
+{
+  this->SinksFileName = fileName;
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::SetOutputFileName(const std::string& fileName)
+{
+  this->OutputFileName = fileName;
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::SetLambda(const float lambda)
+{
+  this->Lambda = lambda;
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::SetNumberOfHistogramBins(const int bins)
+{
+  if(bins <= 0)
+    {
+    itkGenericExceptionMacro(<< "The number of histogram bins must be > 0, not " << bins);
+    }
+  this->NumberOfHistogramBins = bins;
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::SetTileSize(const unsigned int tileSize)
+{
+  this->TileSize = std::max(tileSize, 1u);
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::SetTileOverlap(const unsigned int overlap)
+{
+  this->TileOverlap = overlap;
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::SetNumberOfThreads(const unsigned int numberOfThreads)
+{
+  this->Graph.SetNumberOfThreads(numberOfThreads);
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::PerformSegmentation()
+{
+  this->ImageReader = ImageReaderType::New();
+  this->ImageReader->SetFileName(this->ImageFileName);
+  this->ImageReader->UpdateOutputInformation();
+  this->ImageRegion = this->ImageReader->GetOutput()->GetLargestPossibleRegion();
+
+  ComputeImageStatistics();
+
+  itk::ImageIOBase::Pointer outputIO =
+    itk::ImageIOFactory::CreateImageIO(this->OutputFileName.c_str(), itk::ImageIOFactory::WriteMode);
+  if(outputIO.IsNull())
+    {
+    itkGenericExceptionMacro(<< "No ImageIO can write " << this->OutputFileName);
+    }
+
+  if(outputIO->CanStreamWrite())
+    {
+    // A paste into an existing file keeps its header, which may be of another image
+    std::remove(this->OutputFileName.c_str());
+
+    this->OutputWriter = MaskWriterType::New();
+    this->OutputWriter->SetFileName(this->OutputFileName);
+    this->OutputMask = NULL;
+    }
+  else
+    {
+    this->OutputWriter = NULL;
+    this->OutputMask = Mask::New();
+    this->OutputMask->SetRegions(this->ImageRegion);
+    this->OutputMask->Allocate();
+    }
+
+  // The labels (1 is foreground) of the pixels just above the current row of tiles, and just to the left of the
+  // graph of the current tile. The image is read from a file, so its region starts at index 0.
+  std::vector<unsigned char> rowAbove(this->ImageRegion.GetSize(0), 0);
+  std::vector<unsigned char> columnLeft;
+
+  const std::vector<itk::ImageRegion<2> > tiles = GetTiles();
+  for(unsigned int tileId = 0; tileId < tiles.size(); ++tileId)
+    {
+    SegmentTile(tiles[tileId], rowAbove, columnLeft);
+    }
+
+  if(this->OutputMask.IsNotNull())
+    {
+    typename MaskWriterType::Pointer writer = MaskWriterType::New();
+    writer->SetFileName(this->OutputFileName);
+    writer->SetInput(this->OutputMask);
+    writer->Update();
+    this->OutputMask = NULL;
+    }
+
+  // Release the last tile
+  this->ImageReader = NULL;
+  this->SourcesReader = NULL;
+  this->SinksReader = NULL;
+  this->OutputWriter = NULL;
+  this->Graph.Reset(0, 0);
+}
+
+template <typename TImage>
+template <typename TReader>
+void StreamingImageGraphCut<TImage>::ReadRegion(TReader* const reader, const itk::ImageRegion<2>& region)
+{
+  reader->GetOutput()->SetRequestedRegion(region);
+  reader->GetOutput()->Update();
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::SetSeedWeights(MaskReaderType* const reader, const itk::ImageRegion<2>& graphRegion,
+                                                    const bool sources, std::vector<float>& sourceWeights,
+                                                    std::vector<float>& sinkWeights)
+{
+  // As in IncrementalImageGraphCut::CreateTWeights()
+  const float hardConstraintWeight = 1.0f + 4.0f;
+
+  ReadRegion(reader, graphRegion);
+
+  const itk::Index<2> corner = graphRegion.GetIndex();
+  const unsigned int width = graphRegion.GetSize(0);
+
+  itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(reader->GetOutput(), graphRegion);
+  while(!maskIterator.IsAtEnd())
+    {
+    if(maskIterator.Get() != 0)
+      {
+      const itk::Index<2> index = maskIterator.GetIndex();
+      typename GraphType::NodeId node = (index[1] - corner[1]) * width + index[0] - corner[0];
+      sourceWeights[node] = sources ? hardConstraintWeight : 0;
+      sinkWeights[node] = sources ? 0 : hardConstraintWeight;
+      }
+    ++maskIterator;
+    }
+}
+
+template <typename TImage>
+typename StreamingImageGraphCut<TImage>::MaskReaderType::Pointer
+StreamingImageGraphCut<TImage>::CreateSeedReader(const std::string& fileName)
+{
+  typename MaskReaderType::Pointer reader = MaskReaderType::New();
+  reader->SetFileName(fileName);
+  reader->UpdateOutputInformation();
+
+  if(reader->GetOutput()->GetLargestPossibleRegion() != this->ImageRegion)
+    {
+    itkGenericExceptionMacro(<< fileName << " is not the size of " << this->ImageFileName);
+    }
+
+  return reader;
+}
+
+template <typename TImage>
+std::vector<itk::ImageRegion<2> > StreamingImageGraphCut<TImage>::GetTiles() const
+{
+  std::vector<itk::ImageRegion<2> > tiles;
+
+  const itk::Size<2> size = this->ImageRegion.GetSize();
+  for(unsigned int y = 0; y < size[1]; y += this->TileSize)
+    {
+    for(unsigned int x = 0; x < size[0]; x += this->TileSize)
+      {
+      itk::Index<2> corner = {{static_cast<itk::IndexValueType>(x), static_cast<itk::IndexValueType>(y)}};
+      itk::Size<2> tileSize = {{std::min<unsigned int>(this->TileSize, size[0] - x),
+                                std::min<unsigned int>(this->TileSize, size[1] - y)}};
+      tiles.push_back(itk::ImageRegion<2>(corner, tileSize));
+      }
+    }
+
+  return tiles;
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::ComputeImageStatistics()
+{
+  this->SourcesReader = CreateSeedReader(this->SourcesFileName);
+  this->SinksReader = CreateSeedReader(this->SinksFileName);
+
+  this->ImageMinimum.clear();
+  this->ImageMaximum.clear();
+
+  // As IncrementalImageGraphCut::GetNoise(), the mean difference of neighboring pixels
+  double noiseSum = 0;
+  unsigned long numberOfDifferences = 0;
+
+  const std::vector<itk::ImageRegion<2> > tiles = GetTiles();
+  for(unsigned int tileId = 0; tileId < tiles.size(); ++tileId)
+    {
+    const itk::ImageRegion<2>& tile = tiles[tileId];
+
+    // One more column and row, for the differences across the right and bottom edges of the tile
+    itk::ImageRegion<2> readRegion = tile;
+    readRegion.SetSize(0, tile.GetSize(0) + 1);
+    readRegion.SetSize(1, tile.GetSize(1) + 1);
+    readRegion.Crop(this->ImageRegion);
+    ReadRegion(this->ImageReader.GetPointer(), readRegion);
+
+    TImage* const image = this->ImageReader->GetOutput();
+    if(this->ImageMinimum.empty())
+      {
+      this->NumberOfComponents = image->GetNumberOfComponentsPerPixel();
+      if(this->NumberOfHistogramBins > RegionalCostTable::GetMaximumNumberOfHistogramBins(this->NumberOfComponents))
+        {
+        itkGenericExceptionMacro(<< this->NumberOfHistogramBins << " histogram bins per component are too many for "
+                                 << this->NumberOfComponents << " components, the maximum is "
+                                 << RegionalCostTable::GetMaximumNumberOfHistogramBins(this->NumberOfComponents));
+        }
+      this->ImageMinimum.assign(this->NumberOfComponents, std::numeric_limits<float>::max());
+      this->ImageMaximum.assign(this->NumberOfComponents, -std::numeric_limits<float>::max());
+      }
+
+    itk::ImageRegionConstIteratorWithIndex<TImage> imageIterator(image, tile);
+    while(!imageIterator.IsAtEnd())
+      {
+      typename TImage::PixelType pixel = imageIterator.Get();
+      for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+        {
+        this->ImageMinimum[component] = std::min(this->ImageMinimum[component], static_cast<float>(pixel[component]));
+        this->ImageMaximum[component] = std::max(this->ImageMaximum[component], static_cast<float>(pixel[component]));
+        }
+
+      for(unsigned int dimension = 0; dimension < 2; ++dimension)
+        {
+        itk::Index<2> neighbor = imageIterator.GetIndex();
+        neighbor[dimension]++;
+        if(this->ImageRegion.IsInside(neighbor))
+          {
+          noiseSum += PixelDifference(pixel, image->GetPixel(neighbor));
+          numberOfDifferences++;
+          }
+        }
+      ++imageIterator;
+      }
+    }
+
+  this->Sigma = 1.0f;
+  if(numberOfDifferences > 0 && noiseSum > 0)
+    {
+    this->Sigma = noiseSum / static_cast<double>(numberOfDifferences);
+    }
+
+  this->BinScale.assign(this->NumberOfComponents, 0.0f);
+  for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+    {
+    float range = this->ImageMaximum[component] - this->ImageMinimum[component];
+    if(range > 0)
+      {
+      this->BinScale[component] = this->NumberOfHistogramBins / range;
+      }
+    }
+
+  // The seeds can only be binned once the range is known. Only the number of seeds per bin is kept, which is
+  // bounded by the number of bins however many seeds there are.
+  std::map<unsigned int, unsigned int> sourceHistogram;
+  std::map<unsigned int, unsigned int> sinkHistogram;
+  for(unsigned int tileId = 0; tileId < tiles.size(); ++tileId)
+    {
+    AddSeedsToHistogram(this->SourcesReader.GetPointer(), tiles[tileId], sourceHistogram);
+    AddSeedsToHistogram(this->SinksReader.GetPointer(), tiles[tileId], sinkHistogram);
+    }
+
+  CreateRegionalCosts(sourceHistogram, sinkHistogram);
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::AddSeedsToHistogram(MaskReaderType* const reader, const itk::ImageRegion<2>& tile,
+                                                         std::map<unsigned int, unsigned int>& histogram)
+{
+  ReadRegion(reader, tile);
+
+  // The image is only read for the tiles that have seeds, which are usually few
+  bool imageIsRead = false;
+
+  itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(reader->GetOutput(), tile);
+  while(!maskIterator.IsAtEnd())
+    {
+    if(maskIterator.Get() != 0)
+      {
+      if(!imageIsRead)
+        {
+        ReadRegion(this->ImageReader.GetPointer(), tile);
+        imageIsRead = true;
+        }
+      histogram[ComputeBinIndex(this->ImageReader->GetOutput()->GetPixel(maskIterator.GetIndex()))]++;
+      }
+    ++maskIterator;
+    }
+}
+
+template <typename TImage>
+template <typename TPixel>
+unsigned int StreamingImageGraphCut<TImage>::ComputeBinIndex(const TPixel& pixel) const
+{
+  // As IncrementalImageGraphCut::ComputeBinIndex()
+  unsigned int binIndex = 0;
+  unsigned int stride = 1;
+  for(unsigned int component = 0; component < this->BinScale.size(); ++component)
+    {
+    int bin = static_cast<int>((pixel[component] - this->ImageMinimum[component]) * this->BinScale[component]);
+    bin = std::max(0, std::min(bin, this->NumberOfHistogramBins - 1));
+    binIndex += bin * stride;
+    stride *= this->NumberOfHistogramBins;
+    }
+  return binIndex;
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::CreateRegionalCosts(const std::map<unsigned int, unsigned int>& sourceHistogram,
+                                                         const std::map<unsigned int, unsigned int>& sinkHistogram)
+{
+  unsigned long long numberOfBins = 1;
+  for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+    {
+    numberOfBins *= this->NumberOfHistogramBins;
+    }
+
+  this->RegionalCosts.CreateFromHistograms(
+    numberOfBins, RegionalCostTable::HistogramType(sourceHistogram.begin(), sourceHistogram.end()),
+    RegionalCostTable::HistogramType(sinkHistogram.begin(), sinkHistogram.end()));
+}
+
+template <typename TImage>
+template <typename TPixel>
+float StreamingImageGraphCut<TImage>::PixelDifference(const TPixel& a, const TPixel& b) const
+{
+  float difference = 0;
+  for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+    {
+    float componentDifference = static_cast<float>(a[component]) - static_cast<float>(b[component]);
+    difference += componentDifference * componentDifference;
+    }
+  return sqrt(difference);
+}
+
+template <typename TImage>
+template <typename TPixel>
+float StreamingImageGraphCut<TImage>::ComputeNWeight(const TPixel& a, const TPixel& b) const
+{
+  float pixelDifference = PixelDifference(a, b);
+  return exp(-pow(pixelDifference,2)/(2.0*this->Sigma*this->Sigma));
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::SegmentTile(const itk::ImageRegion<2>& tile, std::vector<unsigned char>& rowAbove,
+                                                 std::vector<unsigned char>& columnLeft)
+{
+  // The graph extends past the right and bottom edges of the tile. Those pixels are cut again by the
+  // following tiles, so only their influence on the labels of the tile is kept.
+  itk::ImageRegion<2> graphRegion = tile;
+  graphRegion.SetSize(0, tile.GetSize(0) + this->TileOverlap);
+  graphRegion.SetSize(1, tile.GetSize(1) + this->TileOverlap);
+  graphRegion.Crop(this->ImageRegion);
+
+  // Also read the row above and the column to the left, for the n-links to the fixed pixels
+  itk::ImageRegion<2> readRegion = graphRegion;
+  readRegion.SetIndex(0, graphRegion.GetIndex(0) - 1);
+  readRegion.SetIndex(1, graphRegion.GetIndex(1) - 1);
+  readRegion.SetSize(0, graphRegion.GetSize(0) + 1);
+  readRegion.SetSize(1, graphRegion.GetSize(1) + 1);
+  readRegion.Crop(this->ImageRegion);
+  ReadRegion(this->ImageReader.GetPointer(), readRegion);
+
+  const TImage* const image = this->ImageReader->GetOutput();
+
+  const itk::Index<2> corner = graphRegion.GetIndex();
+  const int width = graphRegion.GetSize(0);
+  const int height = graphRegion.GetSize(1);
+
+  this->Graph.Reset(width, height);
+
+  std::vector<float> sourceWeights(width * height);
+  std::vector<float> sinkWeights(width * height);
+
+  for(int y = 0; y < height; ++y)
+    {
+    for(int x = 0; x < width; ++x)
+      {
+      typename GraphType::NodeId node = y * width + x;
+      itk::Index<2> index = {{corner[0] + x, corner[1] + y}};
+      typename TImage::PixelType pixel = image->GetPixel(index);
+
+      const float* binCost = this->RegionalCosts.GetCosts(ComputeBinIndex(pixel));
+      sourceWeights[node] = this->Lambda * binCost[0];
+      sinkWeights[node] = this->Lambda * binCost[1];
+
+      if(x + 1 < width)
+        {
+        itk::Index<2> neighbor = {{index[0] + 1, index[1]}};
+        this->Graph.SetEdgeWeight(node, GraphType::RIGHT, ComputeNWeight(pixel, image->GetPixel(neighbor)));
+        }
+      if(y + 1 < height)
+        {
+        itk::Index<2> neighbor = {{index[0], index[1] + 1}};
+        this->Graph.SetEdgeWeight(node, GraphType::DOWN, ComputeNWeight(pixel, image->GetPixel(neighbor)));
+        }
+
+      // The n-link to a fixed pixel is cut if this pixel takes the other label, like a t-link
+      if(y == 0 && corner[1] > 0)
+        {
+        itk::Index<2> neighbor = {{index[0], index[1] - 1}};
+        float weight = ComputeNWeight(pixel, image->GetPixel(neighbor));
+        if(rowAbove[index[0]])
+          {
+          sourceWeights[node] += weight;
+          }
+        else
+          {
+          sinkWeights[node] += weight;
+          }
+        }
+      if(x == 0 && corner[0] > 0)
+        {
+        itk::Index<2> neighbor = {{index[0] - 1, index[1]}};
+        float weight = ComputeNWeight(pixel, image->GetPixel(neighbor));
+        if(columnLeft[y])
+          {
+          sourceWeights[node] += weight;
+          }
+        else
+          {
+          sinkWeights[node] += weight;
+          }
+        }
+      }
+    }
+
+  SetSeedWeights(this->SourcesReader.GetPointer(), graphRegion, true, sourceWeights, sinkWeights);
+  SetSeedWeights(this->SinksReader.GetPointer(), graphRegion, false, sourceWeights, sinkWeights);
+
+  for(int node = 0; node < width * height; ++node)
+    {
+    this->Graph.SetTerminalWeights(node, sourceWeights[node], sinkWeights[node]);
+    }
+
+  this->Graph.MaxFlow();
+
+  WriteTile(tile, corner);
+
+  // The bottom row of the tile is fixed for the tiles below it. The right column is fixed for the next
+  // tile of this row; below the tile, where it is not written yet, it is the best guess that there is.
+  const int tileBottom = tile.GetIndex(1) + tile.GetSize(1) - 1 - corner[1];
+  for(unsigned int x = 0; x < tile.GetSize(0); ++x)
+    {
+    rowAbove[tile.GetIndex(0) + x] = (this->Graph.GetSegment(tileBottom * width + x) == GraphType::SOURCE);
+    }
+
+  const int tileRight = tile.GetIndex(0) + tile.GetSize(0) - 1 - corner[0];
+  columnLeft.resize(height);
+  for(int y = 0; y < height; ++y)
+    {
+    columnLeft[y] = (this->Graph.GetSegment(y * width + tileRight) == GraphType::SOURCE);
+    }
+}
+
+template <typename TImage>
+void StreamingImageGraphCut<TImage>::WriteTile(const itk::ImageRegion<2>& tile, const itk::Index<2>& graphCorner)
+{
+  // Either a mask that only buffers this tile (the writer pastes it into the file), or the whole output
+  Mask::Pointer mask = this->OutputMask;
+  if(mask.IsNull())
+    {
+    mask = Mask::New();
+    mask->SetLargestPossibleRegion(this->ImageRegion);
+    mask->SetBufferedRegion(tile);
+    mask->SetRequestedRegion(tile);
+    mask->Allocate();
+    }
+
+  const unsigned int width = this->Graph.GetWidth();
+
+  itk::ImageRegionIteratorWithIndex<Mask> maskIterator(mask, tile);
+  while(!maskIterator.IsAtEnd())
+    {
+    const itk::Index<2> index = maskIterator.GetIndex();
+    typename GraphType::NodeId node = (index[1] - graphCorner[1]) * width + index[0] - graphCorner[0];
+    if(this->Graph.GetSegment(node) == GraphType::SOURCE)
+      {
+      maskIterator.Set(mask->GetHoleValue());
+      }
+    else
+      {
+      maskIterator.Set(mask->GetValidValue());
+      }
+    ++maskIterator;
+    }
+
+  if(this->OutputWriter.IsNotNull())
+    {
+    itk::ImageIORegion ioRegion(2);
+    for(unsigned int dimension = 0; dimension < 2; ++dimension)
+      {
+      ioRegion.SetIndex(dimension, tile.GetIndex(dimension));
+      ioRegion.SetSize(dimension, tile.GetSize(dimension));
+      }
+    this->OutputWriter->SetInput(mask);
+    this->OutputWriter->SetIORegion(ioRegion);
+    this->OutputWriter->Update();
+    }
+}
+
+#endif
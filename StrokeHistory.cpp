@@ -0,0 +1,128 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StrokeHistory.h"
+
+// Custom
+#include "PixelRuns.h"
+
+// STL
+#include <algorithm>
+
+StrokeHistory::StrokeHistory() : MemorySize(0), MaximumMemorySize(64 << 20)
+{
+}
+
+void StrokeHistory::Add(const Label newLabel, std::vector<unsigned int> (&changedOffsets)[3])
+{
+  Stroke stroke;
+  stroke.NewLabel = newLabel;
+  for(unsigned int previousLabel = 0; previousLabel < 3; ++previousLabel)
+    {
+    // A stroke crosses the same pixels several times
+    std::vector<unsigned int>& offsets = changedOffsets[previousLabel];
+    std::sort(offsets.begin(), offsets.end());
+    offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+
+    const std::size_t numberOfValues = stroke.Runs.size();
+    PixelRuns::Encode(offsets, stroke.Runs);
+    stroke.NumberOfRuns[previousLabel] = (stroke.Runs.size() - numberOfValues) / 2;
+    }
+
+  if(stroke.Runs.empty())
+    {
+    return;
+    }
+  stroke.Runs.shrink_to_fit();
+
+  for(unsigned int i = 0; i < this->RedoStrokes.size(); ++i)
+    {
+    this->MemorySize -= GetMemorySize(this->RedoStrokes[i]);
+    }
+  this->RedoStrokes.clear();
+
+  this->MemorySize += GetMemorySize(stroke);
+  this->UndoStrokes.push_back(std::move(stroke));
+  Trim();
+}
+
+bool StrokeHistory::CanUndo() const
+{
+  return !this->UndoStrokes.empty();
+}
+
+bool StrokeHistory::CanRedo() const
+{
+  return !this->RedoStrokes.empty();
+}
+
+const StrokeHistory::Stroke& StrokeHistory::Undo()
+{
+  this->RedoStrokes.push_back(std::move(this->UndoStrokes.back()));
+  this->UndoStrokes.pop_back();
+  return this->RedoStrokes.back();
+}
+
+const StrokeHistory::Stroke& StrokeHistory::Redo()
+{
+  this->UndoStrokes.push_back(std::move(this->RedoStrokes.back()));
+  this->RedoStrokes.pop_back();
+  return this->UndoStrokes.back();
+}
+
+void StrokeHistory::Clear()
+{
+  this->UndoStrokes.clear();
+  this->RedoStrokes.clear();
+  this->MemorySize = 0;
+}
+
+void StrokeHistory::GetOffsets(const Stroke& stroke, const Label previousLabel, std::vector<unsigned int>& offsets)
+{
+  std::size_t firstRun = 0;
+  for(unsigned int label = 0; label < static_cast<unsigned int>(previousLabel); ++label)
+    {
+    firstRun += stroke.NumberOfRuns[label];
+    }
+  PixelRuns::Decode(stroke.Runs.data() + 2 * firstRun, stroke.NumberOfRuns[previousLabel], offsets);
+}
+
+std::size_t StrokeHistory::GetMemorySize() const
+{
+  return this->MemorySize;
+}
+
+void StrokeHistory::SetMaximumMemorySize(const std::size_t maximumMemorySize)
+{
+  this->MaximumMemorySize = maximumMemorySize;
+  Trim();
+}
+
+std::size_t StrokeHistory::GetMemorySize(const Stroke& stroke)
+{
+  return sizeof(Stroke) + stroke.Runs.capacity() * sizeof(unsigned int);
+}
+
+void StrokeHistory::Trim()
+{
+  // The last stroke is kept, however large it is
+  while(this->MemorySize > this->MaximumMemorySize && this->UndoStrokes.size() > 1)
+    {
+    this->MemorySize -= GetMemorySize(this->UndoStrokes.front());
+    this->UndoStrokes.pop_front();
+    }
+}
@@ -0,0 +1,98 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* The seeds that each stroke changed, so that the strokes can be undone and redone. A stroke is stored as the
+ * PixelRuns of the pixels whose label it changed, grouped by their label before the stroke, rather than as a copy
+ * of the seeds: undoing it gives each pixel its old label back and redoing it gives them the new one, in time
+ * proportional to the pixels of the stroke. The runs of a stroke take two numbers per row that it crosses, so
+ * thousands of strokes take little memory, and the oldest strokes are forgotten once they take more than
+ * MaximumMemorySize bytes.
+*/
+
+#ifndef StrokeHistory_H
+#define StrokeHistory_H
+
+// Custom
+#include "SeedSet.h"
+
+// STL
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+class StrokeHistory
+{
+public:
+  typedef SeedSet<2>::Label Label;
+
+  struct Stroke
+  {
+    /** The label that the stroke gave its pixels (None if it removed them). */
+    Label NewLabel;
+
+    /** The runs of the pixels that were None, Source and Sink before the stroke, one after the other. */
+    std::vector<unsigned int> Runs;
+    std::size_t NumberOfRuns[3];
+  };
+
+  StrokeHistory();
+
+  /** Record a stroke that gave the pixels of 'changedOffsets' (offsets in buffer order, indexed by the label
+   *  they had before, in any order) 'newLabel'. The strokes that were undone can no longer be redone. A stroke
+   *  that changed no pixel is not recorded. */
+  void Add(const Label newLabel, std::vector<unsigned int> (&changedOffsets)[3]);
+
+  bool CanUndo() const;
+  bool CanRedo() const;
+
+  /** Move the last stroke to the strokes that can be redone, and return it. The reference is valid until the
+   *  history is changed. */
+  const Stroke& Undo();
+
+  /** Move the last stroke that was undone back to the strokes that can be undone, and return it. */
+  const Stroke& Redo();
+
+  /** Forget all of the strokes, e.g. when the seeds are replaced. */
+  void Clear();
+
+  /** Append the offsets of the pixels that were 'previousLabel' before 'stroke' to 'offsets'. */
+  static void GetOffsets(const Stroke& stroke, const Label previousLabel, std::vector<unsigned int>& offsets);
+
+  /** The bytes taken by the runs of all of the strokes. */
+  std::size_t GetMemorySize() const;
+
+  /** The default is 64 MB. */
+  void SetMaximumMemorySize(const std::size_t maximumMemorySize);
+
+protected:
+
+  static std::size_t GetMemorySize(const Stroke& stroke);
+
+  /** Forget the oldest strokes until the history takes at most MaximumMemorySize bytes. */
+  void Trim();
+
+  /** The strokes that can be undone, the oldest first. */
+  std::deque<Stroke> UndoStrokes;
+
+  /** The strokes that were undone, the last one that was undone last. */
+  std::vector<Stroke> RedoStrokes;
+
+  std::size_t MemorySize;
+  std::size_t MaximumMemorySize;
+};
+
+#endif
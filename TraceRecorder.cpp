@@ -0,0 +1,243 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TraceRecorder.h"
+
+// STL
+#include <fstream>
+#include <sstream>
+
+/** The entry called 'name' of 'list', which is added (with a value of 0) if there is none. */
+template <typename TValue>
+static TValue& GetEntry(std::vector<std::pair<std::string, TValue> >& list, const std::string& name)
+{
+  for(unsigned int i = 0; i < list.size(); ++i)
+    {
+    if(list[i].first == name)
+      {
+      return list[i].second;
+      }
+    }
+  list.push_back(std::make_pair(name, TValue(0)));
+  return list.back().second;
+}
+
+/** The value called 'name' in 'list', or 0. */
+template <typename TValue>
+static TValue FindEntry(const std::vector<std::pair<std::string, TValue> >& list, const std::string& name)
+{
+  for(unsigned int i = 0; i < list.size(); ++i)
+    {
+    if(list[i].first == name)
+      {
+      return list[i].second;
+      }
+    }
+  return TValue(0);
+}
+
+/** Add 'element' to the ring buffer 'ring' of at most 'maximumSize' elements, whose oldest element is at 'next'
+ *  once it is full. */
+template <typename TElement>
+static void AddToRing(std::vector<TElement>& ring, std::size_t& next, const TElement& element,
+                      const std::size_t maximumSize)
+{
+  if(ring.size() < maximumSize)
+    {
+    ring.push_back(element);
+    }
+  else
+    {
+    ring[next] = element;
+    }
+  next = (next + 1) % maximumSize;
+}
+
+/** The index in 'ring' of its i'th oldest element (see AddToRing()). */
+template <typename TElement>
+static std::size_t GetRingIndex(const std::vector<TElement>& ring, const std::size_t next, const std::size_t i,
+                                const std::size_t maximumSize)
+{
+  return (ring.size() < maximumSize) ? i : (next + i) % maximumSize;
+}
+
+/** Escape 'text' for a JSON string. */
+static std::string Quote(const std::string& text)
+{
+  std::string quoted = "\"";
+  for(unsigned int i = 0; i < text.size(); ++i)
+    {
+    if(text[i] == '"' || text[i] == '\\')
+      {
+      quoted += '\\';
+      }
+    quoted += text[i];
+    }
+  return quoted + "\"";
+}
+
+TraceRecorder::ScopedTimer::ScopedTimer(TraceRecorder* const recorder, const char* const name) :
+  Recorder(recorder), Name(name)
+{
+  if(this->Recorder)
+    {
+    this->Start = std::chrono::steady_clock::now();
+    }
+}
+
+TraceRecorder::ScopedTimer::~ScopedTimer()
+{
+  if(this->Recorder)
+    {
+    this->Recorder->AddEvent(this->Name, this->Start, std::chrono::steady_clock::now());
+    }
+}
+
+const std::size_t TraceRecorder::MaximumNumberOfEvents;
+
+TraceRecorder::TraceRecorder() : NextEvent(0), NextCounterSample(0), Origin(std::chrono::steady_clock::now())
+{
+}
+
+void TraceRecorder::AddEvent(const char* const name, const std::chrono::steady_clock::time_point& start,
+                             const std::chrono::steady_clock::time_point& end)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  Event event;
+  event.Name = name;
+  event.Thread = GetThreadId();
+  event.Start = GetTimestamp(start);
+  event.Duration = GetTimestamp(end) - event.Start;
+  AddToRing(this->Events, this->NextEvent, event, MaximumNumberOfEvents);
+
+  GetEntry(this->CurrentTotals.Seconds, name) += std::chrono::duration<double>(end - start).count();
+}
+
+void TraceRecorder::AddToCounter(const std::string& name, const unsigned long long value)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  unsigned long long& count = GetEntry(this->CurrentTotals.Counts, name);
+  count += value;
+
+  CounterSample sample;
+  sample.Name = name;
+  sample.Time = GetTimestamp(std::chrono::steady_clock::now());
+  sample.Value = count;
+  AddToRing(this->CounterSamples, this->NextCounterSample, sample, MaximumNumberOfEvents);
+}
+
+TraceRecorder::Totals TraceRecorder::GetTotals() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->CurrentTotals;
+}
+
+std::string TraceRecorder::GetSummary(const Totals& since) const
+{
+  Totals totals = GetTotals();
+
+  std::stringstream summary;
+  summary.setf(std::ios::fixed);
+  summary.precision(1);
+  for(unsigned int i = 0; i < totals.Seconds.size(); ++i)
+    {
+    double seconds = totals.Seconds[i].second - FindEntry(since.Seconds, totals.Seconds[i].first);
+    if(seconds > 0)
+      {
+      summary << (summary.tellp() > 0 ? ", " : "") << totals.Seconds[i].first << " " << 1000 * seconds << " ms";
+      }
+    }
+
+  const char* separator = (summary.tellp() > 0) ? " | " : "";
+  for(unsigned int i = 0; i < totals.Counts.size(); ++i)
+    {
+    unsigned long long count = totals.Counts[i].second - FindEntry(since.Counts, totals.Counts[i].first);
+    if(count > 0)
+      {
+      summary << separator << totals.Counts[i].first << " " << count;
+      separator = ", ";
+      }
+    }
+
+  return summary.str();
+}
+
+bool TraceRecorder::WriteChromeTrace(const std::string& fileName) const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  std::ofstream fout(fileName.c_str());
+  if(!fout)
+    {
+    return false;
+    }
+
+  // Complete ("X") events for the timers and counter ("C") events for the counters
+  fout << "{\"traceEvents\":[";
+  const char* separator = "\n";
+  for(std::size_t i = 0; i < this->Events.size(); ++i)
+    {
+    const Event& event = this->Events[GetRingIndex(this->Events, this->NextEvent, i, MaximumNumberOfEvents)];
+    fout << separator << "{\"name\":" << Quote(event.Name) << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.Thread
+         << ",\"ts\":" << event.Start << ",\"dur\":" << event.Duration << "}";
+    separator = ",\n";
+    }
+  for(std::size_t i = 0; i < this->CounterSamples.size(); ++i)
+    {
+    const CounterSample& sample =
+      this->CounterSamples[GetRingIndex(this->CounterSamples, this->NextCounterSample, i, MaximumNumberOfEvents)];
+    fout << separator << "{\"name\":" << Quote(sample.Name) << ",\"ph\":\"C\",\"pid\":1,\"ts\":" << sample.Time
+         << ",\"args\":{\"value\":" << sample.Value << "}}";
+    separator = ",\n";
+    }
+  fout << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+
+  return static_cast<bool>(fout);
+}
+
+void TraceRecorder::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Events.clear();
+  this->NextEvent = 0;
+  this->CounterSamples.clear();
+  this->NextCounterSample = 0;
+  this->CurrentTotals = Totals();
+  this->Threads.clear();
+  this->Origin = std::chrono::steady_clock::now();
+}
+
+unsigned int TraceRecorder::GetThreadId()
+{
+  std::thread::id thread = std::this_thread::get_id();
+  for(unsigned int i = 0; i < this->Threads.size(); ++i)
+    {
+    if(this->Threads[i] == thread)
+      {
+      return i;
+      }
+    }
+  this->Threads.push_back(thread);
+  return this->Threads.size() - 1;
+}
+
+long long TraceRecorder::GetTimestamp(const std::chrono::steady_clock::time_point& time) const
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(time - this->Origin).count();
+}
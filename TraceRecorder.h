@@ -0,0 +1,127 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Timers and counters for the hot paths of a cut and of the display. A ScopedTimer records an event from its
+ * construction to its destruction, and counters accumulate values such as the number of augmenting paths.
+ * The last MaximumNumberOfEvents events and counter samples are kept in ring buffers until Clear(), so a long
+ * session takes a bounded amount of memory and its latest part can be written as a Chrome trace
+ * (chrome://tracing or https://ui.perfetto.dev). The totals are kept for everything that was recorded, and
+ * GetSummary() gives the totals since an earlier GetTotals().
+ *
+ * Recording is thread safe (a cut records from its worker thread while the display records from the GUI thread).
+ * Code that records takes a TraceRecorder pointer, which is null when nothing should be recorded, so an unused
+ * timer costs a single comparison.
+*/
+
+#ifndef TraceRecorder_H
+#define TraceRecorder_H
+
+// STL
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class TraceRecorder
+{
+public:
+  TraceRecorder();
+
+  /** Records the time from its construction to its destruction as an event called 'name'. It does nothing if
+   *  'recorder' is null. */
+  class ScopedTimer
+  {
+  public:
+    ScopedTimer(TraceRecorder* const recorder, const char* const name);
+    ~ScopedTimer();
+
+  private:
+    TraceRecorder* Recorder;
+    const char* Name;
+    std::chrono::steady_clock::time_point Start;
+  };
+
+  /** Add 'value' to the counter called 'name'. */
+  void AddToCounter(const std::string& name, const unsigned long long value);
+
+  /** The total seconds of the events of every name, and the value of every counter, in the order in which the
+   *  names were first recorded. */
+  struct Totals
+  {
+    std::vector<std::pair<std::string, double> > Seconds;
+    std::vector<std::pair<std::string, unsigned long long> > Counts;
+  };
+  Totals GetTotals() const;
+
+  /** One line with the totals that were recorded since 'since' was taken with GetTotals(), e.g.
+   *  "CreateGraph 12.1 ms, MaxFlow 30.4 ms | AugmentingPaths 5120". Names that did not change are left out. */
+  std::string GetSummary(const Totals& since = Totals()) const;
+
+  /** Write the events and counter samples that are kept, oldest first, in the Chrome trace event format (JSON).
+   *  Returns false if the file could not be written. */
+  bool WriteChromeTrace(const std::string& fileName) const;
+
+  /** Forget everything that was recorded. */
+  void Clear();
+
+  /** The number of events, and of counter samples, that are kept. About 15 MB of each when they are full. */
+  static const std::size_t MaximumNumberOfEvents = 1 << 18;
+
+private:
+  void AddEvent(const char* const name, const std::chrono::steady_clock::time_point& start,
+                const std::chrono::steady_clock::time_point& end);
+
+  /** A small id for the calling thread (the trace format wants numbers). Mutex must be locked. */
+  unsigned int GetThreadId();
+
+  /** Microseconds since Origin. */
+  long long GetTimestamp(const std::chrono::steady_clock::time_point& time) const;
+
+  struct Event
+  {
+    std::string Name;
+    unsigned int Thread;
+    long long Start;
+    long long Duration;
+  };
+
+  /** A counter's value after every change, for the trace. */
+  struct CounterSample
+  {
+    std::string Name;
+    long long Time;
+    unsigned long long Value;
+  };
+
+  /** Ring buffers: once one is full, its next element overwrites the oldest one, at NextEvent (NextCounterSample). */
+  std::vector<Event> Events;
+  std::size_t NextEvent;
+  std::vector<CounterSample> CounterSamples;
+  std::size_t NextCounterSample;
+  Totals CurrentTotals;
+
+  std::vector<std::thread::id> Threads;
+
+  std::chrono::steady_clock::time_point Origin;
+
+  mutable std::mutex Mutex;
+};
+
+#endif
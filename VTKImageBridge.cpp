@@ -0,0 +1,186 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "VTKImageBridge.h"
+
+// Custom
+#include "ImagePixelTraits.h"
+
+// VTK
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnsignedShortArray.h>
+
+// STL
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+namespace VTKImageBridge
+{
+
+/** The vtkDataArray that holds components of type TComponent. */
+template <typename TComponent>
+struct ScalarArray;
+
+template <>
+struct ScalarArray<float>
+{
+  typedef vtkFloatArray Type;
+};
+
+template <>
+struct ScalarArray<unsigned char>
+{
+  typedef vtkUnsignedCharArray Type;
+};
+
+template <>
+struct ScalarArray<unsigned short>
+{
+  typedef vtkUnsignedShortArray Type;
+};
+
+/** The window of GetColorWindow() for components of type TComponent. */
+template <typename TComponent>
+static double GetComponentWindow()
+{
+  return std::is_floating_point<TComponent>::value ? ColorWindow : std::numeric_limits<TComponent>::max();
+}
+
+template <typename TImage>
+static void WrapComponentBuffer(TImage* const image, vtkImageData* const output)
+{
+  typedef ImagePixelTraits<TImage> PixelTraits;
+  const itk::Size<2> size = image->GetLargestPossibleRegion().GetSize();
+  const unsigned int numberOfComponents = PixelTraits::GetNumberOfComponents(image);
+
+  // Both store the pixels row by row with interleaved components, so the buffer can be used as it is
+  vtkSmartPointer<typename ScalarArray<typename PixelTraits::ComponentType>::Type> scalars =
+    vtkSmartPointer<typename ScalarArray<typename PixelTraits::ComponentType>::Type>::New();
+  scalars->SetNumberOfComponents(numberOfComponents);
+  scalars->SetArray(PixelTraits::GetBuffer(image), static_cast<vtkIdType>(size[0]) * size[1] * numberOfComponents,
+                    1); // 1: VTK must not free the buffer
+
+  output->SetDimensions(size[0], size[1], 1);
+  output->GetPointData()->SetScalars(scalars);
+}
+
+template <typename TImage>
+static void CreateComponentMaskedImage(const TImage* const image, vtkImageData* const output)
+{
+  typedef ImagePixelTraits<TImage> PixelTraits;
+  typedef typename PixelTraits::ComponentType ComponentType;
+  const itk::Size<2> size = image->GetLargestPossibleRegion().GetSize();
+  const unsigned int numberOfComponents = PixelTraits::GetNumberOfComponents(image);
+  const std::size_t numberOfPixels = static_cast<std::size_t>(size[0]) * size[1];
+  const float scale = 255.0f / GetComponentWindow<ComponentType>();
+
+  output->SetDimensions(size[0], size[1], 1);
+  output->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+
+  const ComponentType* pixel = PixelTraits::GetBuffer(image);
+  unsigned char* rgba = static_cast<unsigned char*>(output->GetScalarPointer());
+  for(std::size_t i = 0; i < numberOfPixels; ++i, pixel += numberOfComponents, rgba += 4)
+    {
+    for(unsigned int component = 0; component < 3; ++component)
+      {
+      float value = pixel[std::min(component, numberOfComponents - 1)] * scale;
+      rgba[component] = static_cast<unsigned char>(std::max(0.0f, std::min(value, 255.0f)));
+      }
+    rgba[3] = 0;
+    }
+  output->Modified();
+}
+
+double GetColorWindow(vtkImageData* const image)
+{
+  switch(image->GetScalarType())
+    {
+    case VTK_UNSIGNED_CHAR:
+      return GetComponentWindow<unsigned char>();
+    case VTK_UNSIGNED_SHORT:
+      return GetComponentWindow<unsigned short>();
+    default:
+      return ColorWindow;
+    }
+}
+
+bool CanWrapImage(const ImageType* const image)
+{
+  const unsigned int numberOfComponents = image->GetNumberOfComponentsPerPixel();
+  return numberOfComponents == 1 || numberOfComponents == 3 || numberOfComponents == 4;
+}
+
+void WrapImage(ImageType* const image, vtkImageData* const output)
+{
+  WrapComponentBuffer(image, output);
+}
+
+void WrapImage(ImageFormat::RGBImageType* const image, vtkImageData* const output)
+{
+  WrapComponentBuffer(image, output);
+}
+
+void WrapImage(ImageFormat::GrayImageType* const image, vtkImageData* const output)
+{
+  WrapComponentBuffer(image, output);
+}
+
+void WrapImage(ImageFormat::Gray16ImageType* const image, vtkImageData* const output)
+{
+  WrapComponentBuffer(image, output);
+}
+
+void CreateMaskedImage(const ImageType* const image, vtkImageData* const output)
+{
+  CreateComponentMaskedImage(image, output);
+}
+
+void CreateMaskedImage(const ImageFormat::RGBImageType* const image, vtkImageData* const output)
+{
+  CreateComponentMaskedImage(image, output);
+}
+
+void CreateMaskedImage(const ImageFormat::GrayImageType* const image, vtkImageData* const output)
+{
+  CreateComponentMaskedImage(image, output);
+}
+
+void CreateMaskedImage(const ImageFormat::Gray16ImageType* const image, vtkImageData* const output)
+{
+  CreateComponentMaskedImage(image, output);
+}
+
+void UpdateMaskedImage(const MaskType* const mask, const unsigned char holeValue, vtkImageData* const output)
+{
+  const std::size_t numberOfPixels = mask->GetLargestPossibleRegion().GetNumberOfPixels();
+
+  const unsigned char* maskPixel = mask->GetBufferPointer();
+  unsigned char* alpha = static_cast<unsigned char*>(output->GetScalarPointer()) + 3;
+  for(std::size_t i = 0; i < numberOfPixels; ++i, alpha += 4)
+    {
+    *alpha = (maskPixel[i] == holeValue) ? 255 : 0;
+    }
+  output->Modified();
+}
+
+} // namespace VTKImageBridge
@@ -0,0 +1,79 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Display the images of the segmentation without converting them to new vtkImageData objects.
+ *
+ * WrapImage() points a vtkImageData at the buffer of an itk::VectorImage<float, 2> or of one of the images with fixed
+ * size pixels of ImageFormat, as vtkImageImport does, so the original image is displayed without a copy. Its
+ * components are mapped to colors by the window/level of the vtkImageProperty of the slice that shows it (see
+ * GetColorWindow()).
+ *
+ * The result pane shows the image with a transparent background. A slice cannot take its opacity from a second
+ * image, so the result is a single RGBA buffer: its colors are copied from the image once per image by
+ * CreateMaskedImage(), and after every cut UpdateMaskedImage() only rewrites its alpha channel in place.
+*/
+
+#ifndef VTKImageBridge_H
+#define VTKImageBridge_H
+
+// Custom
+#include "ImageFormat.h"
+
+// ITK
+#include <itkImage.h>
+#include <itkVectorImage.h>
+
+class vtkImageData;
+
+namespace VTKImageBridge
+{
+  typedef itk::VectorImage<float, 2> ImageType;
+  typedef itk::Image<unsigned char, 2> MaskType;
+
+  /** The window and level that show the components of a wrapped float image like the unsigned char RGB image that
+   *  it was read from. */
+  const double ColorWindow = 255.0;
+  const double ColorLevel = 127.5;
+
+  /** The window that shows the whole range of the components of a wrapped image: ColorWindow for float and unsigned
+   *  char components, 65535 for unsigned short components. The level is half of it. */
+  double GetColorWindow(vtkImageData* const image);
+
+  /** True if the image has 1 (gray), 3 (RGB) or 4 (RGBA) components, which VTK can display as they are. */
+  bool CanWrapImage(const ImageType* const image);
+
+  /** Make 'output' use the buffer of 'image' (which CanWrapImage() must accept for an ImageType). VTK does not take
+   *  ownership of the buffer, so 'image' must outlive this use of 'output'. */
+  void WrapImage(ImageType* const image, vtkImageData* const output);
+  void WrapImage(ImageFormat::RGBImageType* const image, vtkImageData* const output);
+  void WrapImage(ImageFormat::GrayImageType* const image, vtkImageData* const output);
+  void WrapImage(ImageFormat::Gray16ImageType* const image, vtkImageData* const output);
+
+  /** Allocate 'output' as an unsigned char RGBA image of the size of 'image', with the colors of the image (scaled
+   *  from the window of GetColorWindow() to [0, 255] and clamped; a gray image is repeated in all three) and an
+   *  alpha of 0 everywhere. */
+  void CreateMaskedImage(const ImageType* const image, vtkImageData* const output);
+  void CreateMaskedImage(const ImageFormat::RGBImageType* const image, vtkImageData* const output);
+  void CreateMaskedImage(const ImageFormat::GrayImageType* const image, vtkImageData* const output);
+  void CreateMaskedImage(const ImageFormat::Gray16ImageType* const image, vtkImageData* const output);
+
+  /** Set the alpha of every pixel of 'output' (from CreateMaskedImage()) to 255 where 'mask' is 'holeValue' (the
+   *  foreground) and to 0 elsewhere. */
+  void UpdateMaskedImage(const MaskType* const mask, const unsigned char holeValue, vtkImageData* const output);
+}
+
+#endif
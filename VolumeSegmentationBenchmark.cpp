@@ -0,0 +1,211 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Measure the time and memory per voxel of a volume cut. A synthetic size^3 volume (a bright ball on a dark
+ * background, both with gaussian noise) is segmented with sources in a small cube at the center of the ball
+ * and sinks on the first and last slice:
+ *
+ *   VolumeSegmentationBenchmark [size] [numberOfThreads]
+ *
+ * The default size is 128. The memory is the growth of the peak resident set size during the cut, so it
+ * includes the graph, the bin indices and the segment mask, but not the volume itself. The graph cut data is
+ * what IncrementalImageGraphCut::GetMemorySize() counts, which does include the volume.
+*/
+
+// Custom
+#include "IncrementalImageGraphCut.h"
+
+// ITK
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkVectorImage.h>
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+typedef itk::VectorImage<float,3> VolumeType;
+typedef IncrementalImageGraphCut<VolumeType> GraphCutType;
+
+/** The peak resident set size of this process in bytes, or 0 if it is not known on this platform. */
+static double GetPeakMemory()
+{
+#ifdef __unix__
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return 1024.0 * usage.ru_maxrss; // kilobytes on Linux
+#else
+  return 0;
+#endif
+}
+
+static bool IsInBall(const itk::Index<3>& index, const unsigned int size)
+{
+  double radius = size / 4.0;
+  double distanceSquared = 0;
+  for(unsigned int dimension = 0; dimension < 3; ++dimension)
+    {
+    double d = index[dimension] - size / 2.0;
+    distanceSquared += d * d;
+    }
+  return distanceSquared < radius * radius;
+}
+
+static VolumeType::Pointer CreateVolume(const unsigned int size)
+{
+  VolumeType::Pointer volume = VolumeType::New();
+  itk::Size<3> volumeSize = {{size, size, size}};
+  volume->SetRegions(itk::ImageRegion<3>(volumeSize));
+  volume->SetNumberOfComponentsPerPixel(1);
+  volume->Allocate();
+
+  std::mt19937 generator(0);
+  std::normal_distribution<float> noise(0.0f, 20.0f);
+
+  itk::ImageRegionIteratorWithIndex<VolumeType> volumeIterator(volume, volume->GetLargestPossibleRegion());
+  VolumeType::PixelType pixel(1);
+  while(!volumeIterator.IsAtEnd())
+    {
+    pixel[0] = (IsInBall(volumeIterator.GetIndex(), size) ? 200.0f : 50.0f) + noise(generator);
+    volumeIterator.Set(pixel);
+    ++volumeIterator;
+    }
+
+  return volume;
+}
+
+static double SecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+  unsigned int size = 128;
+  if(argc > 1)
+    {
+    size = atoi(argv[1]);
+    }
+  unsigned int numberOfThreads = std::thread::hardware_concurrency();
+  if(argc > 2)
+    {
+    numberOfThreads = atoi(argv[2]);
+    }
+  if(size < 8)
+    {
+    std::cerr << "Usage: " << argv[0] << " [size >= 8] [numberOfThreads]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const double numberOfVoxels = static_cast<double>(size) * size * size;
+
+  VolumeType::Pointer volume = CreateVolume(size);
+
+  const int last = size - 1;
+  const int center = size / 2;
+
+  std::vector<itk::Index<3> > sources;
+  std::vector<itk::Index<3> > sinks;
+  for(int z = 0; z <= last; ++z)
+    {
+    for(int y = 0; y <= last; ++y)
+      {
+      for(int x = 0; x <= last; ++x)
+        {
+        itk::Index<3> index = {{x, y, z}};
+        if(z == 0 || z == last)
+          {
+          sinks.push_back(index);
+          }
+        else if(std::abs(x - center) <= 2 && std::abs(y - center) <= 2 && std::abs(z - center) <= 2)
+          {
+          sources.push_back(index);
+          }
+        }
+      }
+    }
+
+  const double memoryBefore = GetPeakMemory();
+
+  GraphCutType graphCut;
+  graphCut.SetNumberOfThreads(std::max(numberOfThreads, 1u));
+  graphCut.SetLambda(0.01);
+  graphCut.SetNumberOfHistogramBins(20);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  graphCut.SetImage(volume);
+  double setImageTime = SecondsSince(start);
+
+  graphCut.SetSources(sources);
+  graphCut.SetSinks(sinks);
+
+  start = std::chrono::steady_clock::now();
+  graphCut.PerformSegmentation();
+  double firstCutTime = SecondsSince(start);
+
+  const double memoryAfter = GetPeakMemory();
+
+  // A second cut with one more source, which continues from the flow of the first
+  itk::Index<3> extraSource = {{center + 3, center, center}};
+  sources.push_back(extraSource);
+  graphCut.SetSources(sources);
+
+  start = std::chrono::steady_clock::now();
+  graphCut.PerformSegmentation();
+  double secondCutTime = SecondsSince(start);
+
+  // The fraction of voxels on the right side of the ball's surface
+  GraphCutType::MaskType* mask = graphCut.GetSegmentMask();
+  const GraphCutType::MaskType::PixelType holeValue = GraphCutType::MaskTraits::GetHoleValue(mask);
+  unsigned long numberOfCorrectVoxels = 0;
+  itk::ImageRegionIteratorWithIndex<GraphCutType::MaskType> maskIterator(mask, mask->GetLargestPossibleRegion());
+  while(!maskIterator.IsAtEnd())
+    {
+    if((maskIterator.Get() == holeValue) == IsInBall(maskIterator.GetIndex(), size))
+      {
+      numberOfCorrectVoxels++;
+      }
+    ++maskIterator;
+    }
+
+  std::cout << size << "^3 voxels, " << std::max(numberOfThreads, 1u) << " threads" << std::endl;
+  std::cout << "SetImage:            " << setImageTime << " s, "
+            << 1e9 * setImageTime / numberOfVoxels << " ns/voxel" << std::endl;
+  std::cout << "First cut:           " << firstCutTime << " s, "
+            << 1e9 * firstCutTime / numberOfVoxels << " ns/voxel" << std::endl;
+  std::cout << "Cut with a new seed: " << secondCutTime << " s, "
+            << 1e9 * secondCutTime / numberOfVoxels << " ns/voxel" << std::endl;
+  if(memoryAfter > 0)
+    {
+    std::cout << "Memory:              " << (memoryAfter - memoryBefore) / numberOfVoxels << " bytes/voxel (plus "
+              << sizeof(float) * volume->GetNumberOfComponentsPerPixel() << " bytes/voxel of volume)" << std::endl;
+    }
+  const double bytesPerVoxel = static_cast<double>(graphCut.GetMemorySize()) / numberOfVoxels;
+  std::cout << "Graph cut data:      " << bytesPerVoxel << " bytes/voxel" << std::endl;
+  std::cout << "                     so a 512^3 volume needs " << bytesPerVoxel * 512 * 512 * 512 / 1e9
+            << " GB and does not fit comfortably: more than an 8 GB machine has, and half of a 16 GB one" << std::endl;
+  std::cout << "Correct voxels:      " << 100.0 * numberOfCorrectVoxels / numberOfVoxels << "%" << std::endl;
+
+  return EXIT_SUCCESS;
+}
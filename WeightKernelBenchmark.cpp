@@ -0,0 +1,268 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Check the SIMD versions of the WeightKernels against the scalar version, and time them all:
+ *
+ *   WeightKernelBenchmark [numberOfPixels] [numberOfComponents]
+ *
+ * The defaults are 1000000 pixels of 3 components. The pixels are random in [0, 255], with the neighbor of
+ * every pixel close to it (as in a smooth image). The exit code is EXIT_FAILURE if an instruction set
+ * disagrees with the scalar version by more than its tolerance.
+ *
+ * With 1 or 3 components, the same pixels are then rounded to unsigned char and the kernels of an 8 bit gray or RGB
+ * image (with the number of components fixed at compile time) are timed against the float kernels of the rounded
+ * pixels, whose results they must match exactly, in no more time.
+*/
+
+// Custom
+#include "WeightKernels.h"
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+/** Call 'function' enough times to take about 0.2 s, and return the time per call in seconds. */
+template <typename TFunction>
+static double TimeFunction(TFunction function)
+{
+  unsigned int numberOfCalls = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  double seconds = 0;
+  while(seconds < 0.2)
+    {
+    function();
+    numberOfCalls++;
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+  return seconds / numberOfCalls;
+}
+
+/** Compare the kernels of VNumberOfComponents unsigned char components with the float kernels of the same pixels.
+ *  Returns false if they do not match, or if they are slower. */
+template <unsigned int VNumberOfComponents>
+static bool Benchmark8Bit(const std::vector<float>& a, const std::vector<float>& b, const float scale,
+                          const float* const minimum, const float* const binScale, const int binsPerComponent)
+{
+  const unsigned int numberOfPixels = a.size() / VNumberOfComponents;
+
+  std::vector<unsigned char> a8(a.size());
+  std::vector<unsigned char> b8(b.size());
+  std::vector<float> roundedA(a.size());
+  std::vector<float> roundedB(b.size());
+  for(unsigned int i = 0; i < a.size(); ++i)
+    {
+    a8[i] = static_cast<unsigned char>(std::max(0.0f, std::min(a[i] + 0.5f, 255.0f)));
+    b8[i] = static_cast<unsigned char>(std::max(0.0f, std::min(b[i] + 0.5f, 255.0f)));
+    roundedA[i] = a8[i];
+    roundedB[i] = b8[i];
+    }
+
+  std::vector<float> floatWeights(numberOfPixels);
+  std::vector<float> weights(numberOfPixels);
+  std::vector<unsigned int> floatBins(numberOfPixels);
+  std::vector<unsigned int> bins(numberOfPixels);
+  double floatSum = 0;
+  double sum = 0;
+
+  double floatNWeightsTime = TimeFunction([&]()
+    {
+    WeightKernels::ComputeNWeights(&roundedA[0], &roundedB[0], numberOfPixels, VNumberOfComponents, scale,
+                                   &floatWeights[0]);
+    });
+  double nWeightsTime = TimeFunction([&]()
+    {
+    WeightKernels::ComputeNWeights<VNumberOfComponents>(&a8[0], &b8[0], numberOfPixels, VNumberOfComponents, scale,
+                                                        &weights[0]);
+    });
+  double floatSumTime = TimeFunction([&]()
+    {
+    floatSum = WeightKernels::SumPixelDifferences(&roundedA[0], &roundedB[0], numberOfPixels, VNumberOfComponents);
+    });
+  double sumTime = TimeFunction([&]()
+    {
+    sum = WeightKernels::SumPixelDifferences<VNumberOfComponents>(&a8[0], &b8[0], numberOfPixels,
+                                                                  VNumberOfComponents);
+    });
+  double floatBinsTime = TimeFunction([&]()
+    {
+    WeightKernels::ComputeBinIndices(&roundedA[0], numberOfPixels, VNumberOfComponents, minimum, binScale,
+                                     binsPerComponent, &floatBins[0]);
+    });
+  double binsTime = TimeFunction([&]()
+    {
+    WeightKernels::ComputeBinIndices<VNumberOfComponents>(&a8[0], numberOfPixels, VNumberOfComponents, minimum,
+                                                          binScale, binsPerComponent, &bins[0]);
+    });
+
+  unsigned int numberOfMismatches = 0;
+  for(unsigned int i = 0; i < numberOfPixels; ++i)
+    {
+    if(weights[i] != floatWeights[i] || bins[i] != floatBins[i])
+      {
+      numberOfMismatches++;
+      }
+    }
+  double sumError = std::abs(sum - floatSum) / floatSum;
+
+  std::cout << "unsigned char, " << VNumberOfComponents << " components at compile time (float):" << std::endl
+            << "  n-weights:   " << 1e9 * nWeightsTime / numberOfPixels << " ns/pixel ("
+            << 1e9 * floatNWeightsTime / numberOfPixels << ")" << std::endl
+            << "  differences: " << 1e9 * sumTime / numberOfPixels << " ns/pixel ("
+            << 1e9 * floatSumTime / numberOfPixels << "), relative error " << sumError << std::endl
+            << "  bins:        " << 1e9 * binsTime / numberOfPixels << " ns/pixel ("
+            << 1e9 * floatBinsTime / numberOfPixels << "), " << numberOfMismatches << " mismatches" << std::endl;
+
+  if(numberOfMismatches > 0 || sumError > 1e-6)
+    {
+    std::cerr << "The unsigned char kernels do not match the float kernels" << std::endl;
+    return false;
+    }
+  if(nWeightsTime > floatNWeightsTime || sumTime > floatSumTime || binsTime > floatBinsTime)
+    {
+    std::cerr << "The unsigned char kernels are slower than the float kernels" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  unsigned int numberOfPixels = 1000000;
+  if(argc > 1)
+    {
+    numberOfPixels = atoi(argv[1]);
+    }
+  unsigned int numberOfComponents = 3;
+  if(argc > 2)
+    {
+    numberOfComponents = atoi(argv[2]);
+    }
+  if(numberOfPixels == 0 || numberOfComponents == 0)
+    {
+    std::cerr << "Usage: " << argv[0] << " [numberOfPixels] [numberOfComponents]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<float> value(0.0f, 255.0f);
+  std::normal_distribution<float> noise(0.0f, 10.0f);
+
+  std::vector<float> a(numberOfPixels * numberOfComponents);
+  std::vector<float> b(a.size());
+  for(unsigned int i = 0; i < a.size(); ++i)
+    {
+    a[i] = value(generator);
+    b[i] = a[i] + noise(generator);
+    }
+
+  const float sigma = 10.0f;
+  const float scale = 1.0f / (2.0f * sigma * sigma);
+
+  const int binsPerComponent = 20;
+  std::vector<float> minimum(numberOfComponents, 0.0f);
+  std::vector<float> binScale(numberOfComponents, binsPerComponent / 255.0f);
+
+  // The scalar results are the reference
+  WeightKernels::SetInstructionSet(WeightKernels::Scalar);
+  std::vector<float> referenceWeights(numberOfPixels);
+  WeightKernels::ComputeNWeights(&a[0], &b[0], numberOfPixels, numberOfComponents, scale, &referenceWeights[0]);
+  double referenceSum = WeightKernels::SumPixelDifferences(&a[0], &b[0], numberOfPixels, numberOfComponents);
+  std::vector<unsigned int> referenceBins(numberOfPixels);
+  WeightKernels::ComputeBinIndices(&a[0], numberOfPixels, numberOfComponents, &minimum[0], &binScale[0],
+                                   binsPerComponent, &referenceBins[0]);
+
+  std::cout << numberOfPixels << " pixels, " << numberOfComponents << " components" << std::endl;
+
+  bool passed = true;
+  for(int set = WeightKernels::Scalar; set <= WeightKernels::GetBestInstructionSet(); ++set)
+    {
+    WeightKernels::InstructionSet instructionSet = static_cast<WeightKernels::InstructionSet>(set);
+    WeightKernels::SetInstructionSet(instructionSet);
+
+    std::vector<float> weights(numberOfPixels);
+    WeightKernels::ComputeNWeights(&a[0], &b[0], numberOfPixels, numberOfComponents, scale, &weights[0]);
+    double sum = WeightKernels::SumPixelDifferences(&a[0], &b[0], numberOfPixels, numberOfComponents);
+    std::vector<unsigned int> bins(numberOfPixels);
+    WeightKernels::ComputeBinIndices(&a[0], numberOfPixels, numberOfComponents, &minimum[0], &binScale[0],
+                                     binsPerComponent, &bins[0]);
+
+    // The weights can be very small, so their error is relative
+    float maximumError = 0;
+    for(unsigned int i = 0; i < numberOfPixels; ++i)
+      {
+      maximumError = std::max(maximumError, std::abs(weights[i] - referenceWeights[i]) /
+                                            std::max(referenceWeights[i], std::numeric_limits<float>::min()));
+      }
+    double sumError = std::abs(sum - referenceSum) / referenceSum;
+    unsigned int numberOfBinMismatches = 0;
+    for(unsigned int i = 0; i < numberOfPixels; ++i)
+      {
+      if(bins[i] != referenceBins[i])
+        {
+        numberOfBinMismatches++;
+        }
+      }
+
+    double nWeightsTime = TimeFunction([&]()
+      {
+      WeightKernels::ComputeNWeights(&a[0], &b[0], numberOfPixels, numberOfComponents, scale, &weights[0]);
+      });
+    double sumTime = TimeFunction([&]()
+      {
+      sum = WeightKernels::SumPixelDifferences(&a[0], &b[0], numberOfPixels, numberOfComponents);
+      });
+    double binsTime = TimeFunction([&]()
+      {
+      WeightKernels::ComputeBinIndices(&a[0], numberOfPixels, numberOfComponents, &minimum[0], &binScale[0],
+                                       binsPerComponent, &bins[0]);
+      });
+
+    std::cout << WeightKernels::GetInstructionSetName(instructionSet) << ":" << std::endl
+              << "  n-weights:   " << 1e9 * nWeightsTime / numberOfPixels << " ns/pixel, max relative error "
+              << maximumError << std::endl
+              << "  differences: " << 1e9 * sumTime / numberOfPixels << " ns/pixel, relative error "
+              << sumError << std::endl
+              << "  bins:        " << 1e9 * binsTime / numberOfPixels << " ns/pixel, "
+              << numberOfBinMismatches << " mismatches" << std::endl;
+
+    // The polynomial exp is within a few ulps, and the bins must be exact
+    if(maximumError > 1e-5f || sumError > 1e-6 || numberOfBinMismatches > 0)
+      {
+      std::cerr << WeightKernels::GetInstructionSetName(instructionSet) << " does not match the scalar version" << std::endl;
+      passed = false;
+      }
+    }
+
+  // The 8 bit kernels with the best instruction set
+  WeightKernels::SetInstructionSet(WeightKernels::GetBestInstructionSet());
+  if(numberOfComponents == 1)
+    {
+    passed = Benchmark8Bit<1>(a, b, scale, &minimum[0], &binScale[0], binsPerComponent) && passed;
+    }
+  else if(numberOfComponents == 3)
+    {
+    passed = Benchmark8Bit<3>(a, b, scale, &minimum[0], &binScale[0], binsPerComponent) && passed;
+    }
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1182 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "WeightKernels.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+// SSE2 is part of x86-64. The AVX2 functions are compiled for AVX2 individually (with the target attribute),
+// so that the rest of the program still runs on CPUs without it.
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+  #define WEIGHTKERNELS_SSE2
+  #include <immintrin.h>
+  #if defined(__GNUC__)
+    #define WEIGHTKERNELS_AVX2
+    #define WEIGHTKERNELS_AVX2_FUNCTION __attribute__((target("avx2")))
+  #elif defined(_MSC_VER)
+    #define WEIGHTKERNELS_AVX2
+    #define WEIGHTKERNELS_AVX2_FUNCTION
+    #include <intrin.h>
+  #endif
+#endif
+
+namespace
+{
+
+// Scalar
+
+void ComputeNWeightsScalar(const float* const a, const float* const b, const unsigned int count,
+                           const unsigned int numberOfComponents, const float scale, float* const weights)
+{
+  for(unsigned int i = 0; i < count; ++i)
+    {
+    float sum = 0;
+    for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+      float difference = a[i * numberOfComponents + component] - b[i * numberOfComponents + component];
+      sum += difference * difference;
+      }
+    weights[i] = std::exp(-scale * sum);
+    }
+}
+
+void ComputeWeightsScalar(const float* const squaredDifferences, const unsigned int count, const float scale,
+                          float* const weights)
+{
+  for(unsigned int i = 0; i < count; ++i)
+    {
+    weights[i] = std::exp(-scale * squaredDifferences[i]);
+    }
+}
+
+double SumPixelDifferencesScalar(const float* const a, const float* const b, const unsigned int count,
+                                 const unsigned int numberOfComponents)
+{
+  double total = 0;
+  for(unsigned int i = 0; i < count; ++i)
+    {
+    float sum = 0;
+    for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+      float difference = a[i * numberOfComponents + component] - b[i * numberOfComponents + component];
+      sum += difference * difference;
+      }
+    total += std::sqrt(sum);
+    }
+  return total;
+}
+
+void ComputeBinIndicesScalar(const float* const pixels, const unsigned int count, const unsigned int numberOfComponents,
+                             const float* const minimum, const float* const scale, const int binsPerComponent,
+                             unsigned int* const binIndices)
+{
+  for(unsigned int i = 0; i < count; ++i)
+    {
+    unsigned int binIndex = 0;
+    unsigned int stride = 1;
+    for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+      float value = (pixels[i * numberOfComponents + component] - minimum[component]) * scale[component];
+      value = std::min(std::max(value, 0.0f), static_cast<float>(binsPerComponent - 1));
+      binIndex += static_cast<int>(value) * stride;
+      stride *= binsPerComponent;
+      }
+    binIndices[i] = binIndex;
+    }
+}
+
+// Scalar, 8 bit pixels
+
+/** |a - b|^2 of the 8 bit pixels at 'a' and 'b', summed as an integer. The sum is exact, and so is that of the float
+ *  kernels for the same values (up to 2^24, or 258 components), so the results are the same. */
+inline int SquaredDifference(const unsigned char* const a, const unsigned char* const b,
+                             const unsigned int numberOfComponents)
+{
+  int sum = 0;
+  for(unsigned int component = 0; component < numberOfComponents; ++component)
+    {
+    int difference = static_cast<int>(a[component]) - static_cast<int>(b[component]);
+    sum += difference * difference;
+    }
+  return sum;
+}
+
+void ComputeNWeightsScalar(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                           const unsigned int numberOfComponents, const float scale, float* const weights)
+{
+  for(unsigned int i = 0; i < count; ++i)
+    {
+    float sum = static_cast<float>(SquaredDifference(a + i * numberOfComponents, b + i * numberOfComponents,
+                                                     numberOfComponents));
+    weights[i] = std::exp(-scale * sum);
+    }
+}
+
+double SumPixelDifferencesScalar(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                                 const unsigned int numberOfComponents)
+{
+  double total = 0;
+  for(unsigned int i = 0; i < count; ++i)
+    {
+    total += std::sqrt(static_cast<float>(SquaredDifference(a + i * numberOfComponents, b + i * numberOfComponents,
+                                                            numberOfComponents)));
+    }
+  return total;
+}
+
+/** A component only has 256 values, so the bin (times the stride) of every value of every component is looked up in
+ *  a table, which is computed as in ComputeBinIndicesScalar(). The pixels of an image are binned with the same
+ *  parameters, so every thread keeps the table of the last ones. */
+struct BinTable
+{
+  BinTable() : BinsPerComponent(0) {}
+
+  const unsigned int* Get(const unsigned int numberOfComponents, const float* const minimum, const float* const scale,
+                          const int binsPerComponent)
+  {
+    if(binsPerComponent != this->BinsPerComponent || numberOfComponents != this->Minimum.size() ||
+       !std::equal(this->Minimum.begin(), this->Minimum.end(), minimum) ||
+       !std::equal(this->Scale.begin(), this->Scale.end(), scale))
+      {
+      this->BinsPerComponent = binsPerComponent;
+      this->Minimum.assign(minimum, minimum + numberOfComponents);
+      this->Scale.assign(scale, scale + numberOfComponents);
+      this->Bins.resize(256 * numberOfComponents);
+
+      unsigned int stride = 1;
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+        {
+        for(unsigned int componentValue = 0; componentValue < 256; ++componentValue)
+          {
+          float value = (static_cast<float>(componentValue) - minimum[component]) * scale[component];
+          value = std::min(std::max(value, 0.0f), static_cast<float>(binsPerComponent - 1));
+          this->Bins[component * 256 + componentValue] = static_cast<int>(value) * stride;
+          }
+        stride *= binsPerComponent;
+        }
+      }
+    return &this->Bins[0];
+  }
+
+  int BinsPerComponent;
+  std::vector<float> Minimum;
+  std::vector<float> Scale;
+  std::vector<unsigned int> Bins;
+};
+
+/** Look up the bins of pixels in a BinTable, with the component loops of gray and RGB pixels unrolled by hand. */
+void LookUpBinIndices(const unsigned char* const pixels, const unsigned int count,
+                      const unsigned int numberOfComponents, const unsigned int* const table,
+                      unsigned int* const binIndices)
+{
+  if(numberOfComponents == 1)
+    {
+    for(unsigned int i = 0; i < count; ++i)
+      {
+      binIndices[i] = table[pixels[i]];
+      }
+    }
+  else if(numberOfComponents == 3)
+    {
+    for(unsigned int i = 0; i < count; ++i)
+      {
+      const unsigned char* const pixel = pixels + i * 3;
+      binIndices[i] = table[pixel[0]] + table[256 + pixel[1]] + table[512 + pixel[2]];
+      }
+    }
+  else
+    {
+    for(unsigned int i = 0; i < count; ++i)
+      {
+      unsigned int binIndex = 0;
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+        {
+        binIndex += table[component * 256 + pixels[i * numberOfComponents + component]];
+        }
+      binIndices[i] = binIndex;
+      }
+    }
+}
+
+/** Without a gather, this is also the SSE2 version: the lookups are faster than computing the bins. */
+void ComputeBinIndicesScalar(const unsigned char* const pixels, const unsigned int count,
+                             const unsigned int numberOfComponents, const float* const minimum,
+                             const float* const scale, const int binsPerComponent, unsigned int* const binIndices)
+{
+  static thread_local BinTable table;
+  LookUpBinIndices(pixels, count, numberOfComponents,
+                   table.Get(numberOfComponents, minimum, scale, binsPerComponent), binIndices);
+}
+
+#ifdef WEIGHTKERNELS_SSE2
+
+// SSE2. There is no gather, so the components of 4 pixels are loaded one at a time.
+
+/** Cephes expf: exp(x) = 2^n * exp(r), with r in [-ln(2)/2, ln(2)/2] and a degree 5 polynomial for exp(r). */
+inline __m128 Exp(__m128 x)
+{
+  x = _mm_min_ps(x, _mm_set1_ps(88.3762626647949f));
+  x = _mm_max_ps(x, _mm_set1_ps(-88.3762626647949f));
+
+  // n = floor(x / ln(2) + 0.5). SSE2 has no floor, so truncate and correct the negative values.
+  __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+  __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+  fx = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, fx), _mm_set1_ps(1.0f)));
+
+  // r = x - n*ln(2), with ln(2) split in two for precision
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+
+  __m128 z = _mm_mul_ps(x, x);
+  __m128 y = _mm_set1_ps(1.9875691500e-4f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+  y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, z), x), _mm_set1_ps(1.0f));
+
+  // 2^n, built directly in the exponent bits
+  __m128i n = _mm_cvttps_epi32(fx);
+  n = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+  return _mm_mul_ps(y, _mm_castsi128_ps(n));
+}
+
+/** Component 'component' of the 4 pixels starting at 'pixels'. */
+inline __m128 LoadComponent(const float* const pixels, const unsigned int numberOfComponents, const unsigned int component)
+{
+  return _mm_setr_ps(pixels[component], pixels[numberOfComponents + component],
+                     pixels[2 * numberOfComponents + component], pixels[3 * numberOfComponents + component]);
+}
+
+/** |a_i - b_i|^2 of the 4 pixels starting at 'a' and 'b'. */
+inline __m128 SquaredDifferences(const float* const a, const float* const b, const unsigned int numberOfComponents)
+{
+  if(numberOfComponents == 1)
+    {
+    __m128 difference = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+    return _mm_mul_ps(difference, difference);
+    }
+
+  __m128 sum = _mm_setzero_ps();
+  for(unsigned int component = 0; component < numberOfComponents; ++component)
+    {
+    __m128 difference = _mm_sub_ps(LoadComponent(a, numberOfComponents, component),
+                                   LoadComponent(b, numberOfComponents, component));
+    sum = _mm_add_ps(sum, _mm_mul_ps(difference, difference));
+    }
+  return sum;
+}
+
+void ComputeNWeightsSSE2(const float* const a, const float* const b, const unsigned int count,
+                         const unsigned int numberOfComponents, const float scale, float* const weights)
+{
+  const __m128 negativeScale = _mm_set1_ps(-scale);
+
+  unsigned int i = 0;
+  for(; i + 4 <= count; i += 4)
+    {
+    __m128 sum = SquaredDifferences(a + i * numberOfComponents, b + i * numberOfComponents, numberOfComponents);
+    _mm_storeu_ps(weights + i, Exp(_mm_mul_ps(sum, negativeScale)));
+    }
+
+  ComputeNWeightsScalar(a + i * numberOfComponents, b + i * numberOfComponents, count - i, numberOfComponents,
+                        scale, weights + i);
+}
+
+void ComputeWeightsSSE2(const float* const squaredDifferences, const unsigned int count, const float scale,
+                        float* const weights)
+{
+  const __m128 negativeScale = _mm_set1_ps(-scale);
+
+  unsigned int i = 0;
+  for(; i + 4 <= count; i += 4)
+    {
+    _mm_storeu_ps(weights + i, Exp(_mm_mul_ps(_mm_loadu_ps(squaredDifferences + i), negativeScale)));
+    }
+
+  ComputeWeightsScalar(squaredDifferences + i, count - i, scale, weights + i);
+}
+
+double SumPixelDifferencesSSE2(const float* const a, const float* const b, const unsigned int count,
+                               const unsigned int numberOfComponents)
+{
+  // Accumulate in double, like the scalar version, since a row can have many thousands of pixels
+  __m128d total = _mm_setzero_pd();
+
+  unsigned int i = 0;
+  for(; i + 4 <= count; i += 4)
+    {
+    __m128 difference = _mm_sqrt_ps(SquaredDifferences(a + i * numberOfComponents, b + i * numberOfComponents,
+                                                       numberOfComponents));
+    total = _mm_add_pd(total, _mm_cvtps_pd(difference));
+    total = _mm_add_pd(total, _mm_cvtps_pd(_mm_movehl_ps(difference, difference)));
+    }
+
+  double totals[2];
+  _mm_storeu_pd(totals, total);
+  return totals[0] + totals[1] + SumPixelDifferencesScalar(a + i * numberOfComponents, b + i * numberOfComponents,
+                                                           count - i, numberOfComponents);
+}
+
+void ComputeBinIndicesSSE2(const float* const pixels, const unsigned int count, const unsigned int numberOfComponents,
+                           const float* const minimum, const float* const scale, const int binsPerComponent,
+                           unsigned int* const binIndices)
+{
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 lastBin = _mm_set1_ps(static_cast<float>(binsPerComponent - 1));
+
+  unsigned int i = 0;
+  for(; i + 4 <= count; i += 4)
+    {
+    // SSE2 can not multiply 32 bit integers, so the bins are combined in scalar code
+    unsigned int binIndex[4] = {0, 0, 0, 0};
+    unsigned int stride = 1;
+    for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+      __m128 value = LoadComponent(pixels + i * numberOfComponents, numberOfComponents, component);
+      value = _mm_mul_ps(_mm_sub_ps(value, _mm_set1_ps(minimum[component])), _mm_set1_ps(scale[component]));
+      value = _mm_min_ps(_mm_max_ps(value, zero), lastBin);
+
+      int bins[4];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(bins), _mm_cvttps_epi32(value));
+      for(unsigned int k = 0; k < 4; ++k)
+        {
+        binIndex[k] += bins[k] * stride;
+        }
+      stride *= binsPerComponent;
+      }
+    std::copy(binIndex, binIndex + 4, binIndices + i);
+    }
+
+  ComputeBinIndicesScalar(pixels + i * numberOfComponents, count - i, numberOfComponents, minimum, scale,
+                          binsPerComponent, binIndices + i);
+}
+
+// SSE2, 8 bit pixels. The components of a pixel are loaded 4 at a time as 32 bit lanes (words), with component
+// 4 * w + c in byte c of word w.
+
+/** exp(-scale * d^2) for the 256 absolute differences d of gray pixels, which are looked up instead of computing the
+ *  exp of every pixel. All of the rows of an image have the same scale, so every thread keeps the table of the last
+ *  scale (for each instruction set, since it is computed with its Exp()). */
+struct GrayWeightTable
+{
+  GrayWeightTable() : Scale(std::numeric_limits<float>::quiet_NaN()) {}
+
+  float Scale;
+  float Weights[256];
+};
+
+/** The 4 bytes at 'bytes'. */
+inline int LoadWord(const unsigned char* const bytes)
+{
+  int word;
+  std::memcpy(&word, bytes, sizeof(word));
+  return word;
+}
+
+inline unsigned int GetNumberOfWords(const unsigned int numberOfComponents)
+{
+  return (numberOfComponents + 3) / 4;
+}
+
+/** The bytes of the components in word 'word' of a pixel. */
+inline int GetComponentMask(const unsigned int numberOfComponents, const unsigned int word)
+{
+  return static_cast<int>(0xffffffffu >> (32 - 8 * std::min(numberOfComponents - 4 * word, 4u)));
+}
+
+/** The number of bytes that LoadPixels() reads: the words of every pixel, just the bytes of gray pixels, which are
+ *  consecutive, or as many bytes as the words of RGB pixels, which are shuffled into their words. */
+inline std::size_t GetLoadSize(const unsigned int numberOfPixels, const unsigned int numberOfComponents)
+{
+  if(numberOfComponents == 1)
+    {
+    return numberOfPixels;
+    }
+  if(numberOfComponents == 3)
+    {
+    return numberOfPixels * 4;
+    }
+  return (numberOfPixels - 1) * numberOfComponents + 4 * GetNumberOfWords(numberOfComponents);
+}
+
+/** The number of the 'count' pixels whose blocks of 'numberOfPixels' can be loaded in place. LoadPixels() may read
+ *  less than a block past the last pixel of a block, so only the last block is loaded from a zero padded copy (see
+ *  PaddedPixels) instead. */
+inline unsigned int GetLoadableCount(const unsigned int numberOfPixels, const unsigned int count,
+                                     const unsigned int numberOfComponents)
+{
+  std::size_t overrun = GetLoadSize(numberOfPixels, numberOfComponents) - numberOfPixels * numberOfComponents;
+  unsigned int overrunPixels = static_cast<unsigned int>((overrun + numberOfComponents - 1) / numberOfComponents);
+  return (count > overrunPixels) ? count - overrunPixels : 0;
+}
+
+/** A zero padded copy of the block of 'numberOfPixels' pixels at 'pixels'. It is on the stack unless the pixels have
+ *  more than 7 components. */
+struct PaddedPixels
+{
+  PaddedPixels(const unsigned char* const pixels, const unsigned int numberOfPixels,
+               const unsigned int numberOfComponents)
+  {
+    std::size_t size = GetLoadSize(numberOfPixels, numberOfComponents);
+    if(size > sizeof(this->Buffer))
+      {
+      this->LargeBuffer.resize(size);
+      }
+    this->Pixels = (size > sizeof(this->Buffer)) ? &this->LargeBuffer[0] : this->Buffer;
+    std::fill(this->Pixels, this->Pixels + size, 0);
+    std::copy(pixels, pixels + numberOfPixels * numberOfComponents, this->Pixels);
+  }
+
+  unsigned char* Pixels;
+  unsigned char Buffer[64];
+  std::vector<unsigned char> LargeBuffer;
+};
+
+/** Word 'word' of the 4 pixels starting at 'pixels', one pixel per lane. */
+inline __m128i LoadPixels(const unsigned char* const pixels, const unsigned int numberOfComponents,
+                          const unsigned int word)
+{
+  if(numberOfComponents == 3)
+    {
+    // The pixels are at bytes 0, 3, 6 and 9 of the 16 loaded, and they are shifted to the first word of each
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+    __m128i words01 = _mm_unpacklo_epi32(bytes, _mm_srli_si128(bytes, 3));
+    __m128i words23 = _mm_unpacklo_epi32(_mm_srli_si128(bytes, 6), _mm_srli_si128(bytes, 9));
+    return _mm_and_si128(_mm_unpacklo_epi64(words01, words23), _mm_set1_epi32(0x00ffffff));
+    }
+
+  const unsigned char* const bytes = pixels + 4 * word;
+  __m128i words = _mm_setr_epi32(LoadWord(bytes), LoadWord(bytes + numberOfComponents),
+                                 LoadWord(bytes + 2 * numberOfComponents), LoadWord(bytes + 3 * numberOfComponents));
+  return _mm_and_si128(words, _mm_set1_epi32(GetComponentMask(numberOfComponents, word)));
+}
+
+/** |a_i - b_i|^2 of 4 pixels from LoadPixels(), as exact integers. Components 0 and 2, and 1 and 3, are widened to
+ *  16 bits, and _mm_madd_epi16 squares their differences and adds each pair. */
+inline __m128i SquaredDifferences(const __m128i a, const __m128i b)
+{
+  const __m128i evenBytes = _mm_set1_epi32(0x00ff00ff);
+  __m128i even = _mm_sub_epi16(_mm_and_si128(a, evenBytes), _mm_and_si128(b, evenBytes));
+  __m128i odd = _mm_sub_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+  return _mm_add_epi32(_mm_madd_epi16(even, even), _mm_madd_epi16(odd, odd));
+}
+
+/** |a_i - b_i|^2 of the 4 pixels starting at 'a' and 'b'. Gray pixels have kernels of their own. */
+inline __m128 SquaredDifferences(const unsigned char* const a, const unsigned char* const b,
+                                 const unsigned int numberOfComponents)
+{
+  __m128i sum = _mm_setzero_si128();
+  for(unsigned int word = 0; word < GetNumberOfWords(numberOfComponents); ++word)
+    {
+    sum = _mm_add_epi32(sum, SquaredDifferences(LoadPixels(a, numberOfComponents, word),
+                                                LoadPixels(b, numberOfComponents, word)));
+    }
+  return _mm_cvtepi32_ps(sum);
+}
+
+/** The n-weights of gray pixels from a GrayWeightTable. The pixels that ComputeNWeightsSSE2() leaves to the scalar
+ *  version still are, so the weights are the same. */
+void ComputeGrayNWeightsSSE2(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                             const float scale, float* const weights)
+{
+  static thread_local GrayWeightTable table;
+  if(table.Scale != scale)
+    {
+    const __m128 negativeScale = _mm_set1_ps(-scale);
+    for(int difference = 0; difference < 256; difference += 4)
+      {
+      __m128 differences = _mm_cvtepi32_ps(_mm_setr_epi32(difference, difference + 1, difference + 2,
+                                                          difference + 3));
+      _mm_storeu_ps(table.Weights + difference,
+                    Exp(_mm_mul_ps(_mm_mul_ps(differences, differences), negativeScale)));
+      }
+    table.Scale = scale;
+    }
+
+  const unsigned int blockCount = count - count % 4;
+  for(unsigned int i = 0; i < blockCount; ++i)
+    {
+    weights[i] = table.Weights[std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]))];
+    }
+
+  ComputeNWeightsScalar(a + blockCount, b + blockCount, count - blockCount, 1, scale, weights + blockCount);
+}
+
+void ComputeNWeightsSSE2(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                         const unsigned int numberOfComponents, const float scale, float* const weights)
+{
+  if(numberOfComponents == 1)
+    {
+    ComputeGrayNWeightsSSE2(a, b, count, scale, weights);
+    return;
+    }
+
+  const __m128 negativeScale = _mm_set1_ps(-scale);
+  const unsigned int loadableCount = GetLoadableCount(4, count, numberOfComponents);
+
+  unsigned int i = 0;
+  for(; i + 4 <= loadableCount; i += 4)
+    {
+    __m128 sum = SquaredDifferences(a + i * numberOfComponents, b + i * numberOfComponents, numberOfComponents);
+    _mm_storeu_ps(weights + i, Exp(_mm_mul_ps(sum, negativeScale)));
+    }
+  if(i + 4 <= count)
+    {
+    PaddedPixels lastA(a + i * numberOfComponents, 4, numberOfComponents);
+    PaddedPixels lastB(b + i * numberOfComponents, 4, numberOfComponents);
+    __m128 sum = SquaredDifferences(lastA.Pixels, lastB.Pixels, numberOfComponents);
+    _mm_storeu_ps(weights + i, Exp(_mm_mul_ps(sum, negativeScale)));
+    i += 4;
+    }
+
+  ComputeNWeightsScalar(a + i * numberOfComponents, b + i * numberOfComponents, count - i, numberOfComponents,
+                        scale, weights + i);
+}
+
+double SumPixelDifferencesSSE2(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                               const unsigned int numberOfComponents)
+{
+  if(numberOfComponents == 1)
+    {
+    // The difference of gray pixels is |a_i - b_i|, so their sum is exact in integers, 16 at a time
+    __m128i sum = _mm_setzero_si128();
+    unsigned int i = 0;
+    for(; i + 16 <= count; i += 16)
+      {
+      sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+      }
+
+    unsigned long long sums[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), sum);
+    return static_cast<double>(sums[0] + sums[1]) + SumPixelDifferencesScalar(a + i, b + i, count - i, 1);
+    }
+
+  __m128d total = _mm_setzero_pd();
+  const unsigned int loadableCount = GetLoadableCount(4, count, numberOfComponents);
+
+  unsigned int i = 0;
+  for(; i + 4 <= loadableCount; i += 4)
+    {
+    __m128 difference = _mm_sqrt_ps(SquaredDifferences(a + i * numberOfComponents, b + i * numberOfComponents,
+                                                       numberOfComponents));
+    total = _mm_add_pd(total, _mm_cvtps_pd(difference));
+    total = _mm_add_pd(total, _mm_cvtps_pd(_mm_movehl_ps(difference, difference)));
+    }
+  if(i + 4 <= count)
+    {
+    PaddedPixels lastA(a + i * numberOfComponents, 4, numberOfComponents);
+    PaddedPixels lastB(b + i * numberOfComponents, 4, numberOfComponents);
+    __m128 difference = _mm_sqrt_ps(SquaredDifferences(lastA.Pixels, lastB.Pixels, numberOfComponents));
+    total = _mm_add_pd(total, _mm_cvtps_pd(difference));
+    total = _mm_add_pd(total, _mm_cvtps_pd(_mm_movehl_ps(difference, difference)));
+    i += 4;
+    }
+
+  double totals[2];
+  _mm_storeu_pd(totals, total);
+  return totals[0] + totals[1] + SumPixelDifferencesScalar(a + i * numberOfComponents, b + i * numberOfComponents,
+                                                           count - i, numberOfComponents);
+}
+
+#endif
+
+#ifdef WEIGHTKERNELS_AVX2
+
+// AVX2. The components of 8 pixels are gathered with one instruction.
+
+/** As the SSE2 Exp(), 8 at a time. */
+WEIGHTKERNELS_AVX2_FUNCTION inline __m256 Exp(__m256 x)
+{
+  x = _mm256_min_ps(x, _mm256_set1_ps(88.3762626647949f));
+  x = _mm256_max_ps(x, _mm256_set1_ps(-88.3762626647949f));
+
+  __m256 fx = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)), _mm256_set1_ps(0.5f));
+  fx = _mm256_floor_ps(fx);
+
+  x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(0.693359375f)));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(-2.12194440e-4f)));
+
+  __m256 z = _mm256_mul_ps(x, x);
+  __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.3981999507e-3f));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(8.3334519073e-3f));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(4.1665795894e-2f));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.6666665459e-1f));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(5.0000001201e-1f));
+  y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(y, z), x), _mm256_set1_ps(1.0f));
+
+  __m256i n = _mm256_cvttps_epi32(fx);
+  n = _mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(y, _mm256_castsi256_ps(n));
+}
+
+/** Component 0 of the 8 pixels starting at 'pixel'. */
+WEIGHTKERNELS_AVX2_FUNCTION inline __m256 LoadComponent(const float* const pixel, const unsigned int numberOfComponents)
+{
+  return _mm256_setr_ps(pixel[0], pixel[numberOfComponents], pixel[2 * numberOfComponents],
+                        pixel[3 * numberOfComponents], pixel[4 * numberOfComponents], pixel[5 * numberOfComponents],
+                        pixel[6 * numberOfComponents], pixel[7 * numberOfComponents]);
+}
+
+/** The offsets of the first component of 8 consecutive pixels. */
+WEIGHTKERNELS_AVX2_FUNCTION inline __m256i PixelOffsets(const unsigned int numberOfComponents)
+{
+  return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(numberOfComponents));
+}
+
+/** |a_i - b_i|^2 of the 8 pixels starting at 'a' and 'b'. */
+WEIGHTKERNELS_AVX2_FUNCTION inline __m256 SquaredDifferences(const float* const a, const float* const b,
+                                                             const unsigned int numberOfComponents,
+                                                             const __m256i offsets)
+{
+  if(numberOfComponents == 1)
+    {
+    __m256 difference = _mm256_sub_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
+    return _mm256_mul_ps(difference, difference);
+    }
+
+  __m256 sum = _mm256_setzero_ps();
+  for(unsigned int component = 0; component < numberOfComponents; ++component)
+    {
+    __m256 difference = _mm256_sub_ps(_mm256_i32gather_ps(a + component, offsets, 4),
+                                      _mm256_i32gather_ps(b + component, offsets, 4));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(difference, difference));
+    }
+  return sum;
+}
+
+WEIGHTKERNELS_AVX2_FUNCTION
+void ComputeNWeightsAVX2(const float* const a, const float* const b, const unsigned int count,
+                         const unsigned int numberOfComponents, const float scale, float* const weights)
+{
+  const __m256 negativeScale = _mm256_set1_ps(-scale);
+  const __m256i offsets = PixelOffsets(numberOfComponents);
+
+  unsigned int i = 0;
+  for(; i + 8 <= count; i += 8)
+    {
+    __m256 sum = SquaredDifferences(a + i * numberOfComponents, b + i * numberOfComponents, numberOfComponents, offsets);
+    _mm256_storeu_ps(weights + i, Exp(_mm256_mul_ps(sum, negativeScale)));
+    }
+
+  ComputeNWeightsScalar(a + i * numberOfComponents, b + i * numberOfComponents, count - i, numberOfComponents,
+                        scale, weights + i);
+}
+
+WEIGHTKERNELS_AVX2_FUNCTION
+void ComputeWeightsAVX2(const float* const squaredDifferences, const unsigned int count, const float scale,
+                        float* const weights)
+{
+  const __m256 negativeScale = _mm256_set1_ps(-scale);
+
+  unsigned int i = 0;
+  for(; i + 8 <= count; i += 8)
+    {
+    _mm256_storeu_ps(weights + i, Exp(_mm256_mul_ps(_mm256_loadu_ps(squaredDifferences + i), negativeScale)));
+    }
+
+  ComputeWeightsScalar(squaredDifferences + i, count - i, scale, weights + i);
+}
+
+WEIGHTKERNELS_AVX2_FUNCTION
+double SumPixelDifferencesAVX2(const float* const a, const float* const b, const unsigned int count,
+                               const unsigned int numberOfComponents)
+{
+  const __m256i offsets = PixelOffsets(numberOfComponents);
+  __m256d total = _mm256_setzero_pd();
+
+  unsigned int i = 0;
+  for(; i + 8 <= count; i += 8)
+    {
+    __m256 difference = _mm256_sqrt_ps(SquaredDifferences(a + i * numberOfComponents, b + i * numberOfComponents,
+                                                          numberOfComponents, offsets));
+    total = _mm256_add_pd(total, _mm256_cvtps_pd(_mm256_castps256_ps128(difference)));
+    total = _mm256_add_pd(total, _mm256_cvtps_pd(_mm256_extractf128_ps(difference, 1)));
+    }
+
+  double totals[4];
+  _mm256_storeu_pd(totals, total);
+  return totals[0] + totals[1] + totals[2] + totals[3] +
+         SumPixelDifferencesScalar(a + i * numberOfComponents, b + i * numberOfComponents, count - i, numberOfComponents);
+}
+
+WEIGHTKERNELS_AVX2_FUNCTION
+void ComputeBinIndicesAVX2(const float* const pixels, const unsigned int count, const unsigned int numberOfComponents,
+                           const float* const minimum, const float* const scale, const int binsPerComponent,
+                           unsigned int* const binIndices)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 lastBin = _mm256_set1_ps(static_cast<float>(binsPerComponent - 1));
+
+  unsigned int i = 0;
+  for(; i + 8 <= count; i += 8)
+    {
+    __m256i binIndex = _mm256_setzero_si256();
+    unsigned int stride = 1;
+    for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+      // A gather is slower than 8 loads here, since there is less arithmetic per load than in the n-weights
+      __m256 value = LoadComponent(pixels + i * numberOfComponents + component, numberOfComponents);
+      value = _mm256_mul_ps(_mm256_sub_ps(value, _mm256_set1_ps(minimum[component])), _mm256_set1_ps(scale[component]));
+      value = _mm256_min_ps(_mm256_max_ps(value, zero), lastBin);
+      binIndex = _mm256_add_epi32(binIndex, _mm256_mullo_epi32(_mm256_cvttps_epi32(value), _mm256_set1_epi32(stride)));
+      stride *= binsPerComponent;
+      }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(binIndices + i), binIndex);
+    }
+
+  // GCC leaves the upper halves of the AVX registers dirty before this tail call, slowing down its SSE code
+  _mm256_zeroupper();
+  ComputeBinIndicesScalar(pixels + i * numberOfComponents, count - i, numberOfComponents, minimum, scale,
+                          binsPerComponent, binIndices + i);
+}
+
+// AVX2, 8 bit pixels. The words of 8 gray or RGB pixels are loaded and shuffled, and those of other pixels gathered.
+
+/** Word 'word' of the 8 pixels starting at 'pixels', as the SSE2 LoadPixels(). */
+WEIGHTKERNELS_AVX2_FUNCTION inline __m256i LoadPixels(const unsigned char* const pixels,
+                                                      const unsigned int numberOfComponents, const unsigned int word,
+                                                      const __m256i offsets)
+{
+  if(numberOfComponents == 1)
+    {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels)));
+    }
+
+  if(numberOfComponents == 3)
+    {
+    // Bytes 0 to 15 and 12 to 27 of the 32 loaded go to the two lanes, where each pixel is shuffled to a word
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels));
+    bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6));
+    return _mm256_shuffle_epi8(bytes, _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                       0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1));
+    }
+
+  __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(pixels + 4 * word), offsets, 1);
+  return _mm256_and_si256(words, _mm256_set1_epi32(GetComponentMask(numberOfComponents, word)));
+}
+
+/** As the SSE2 SquaredDifferences() of 8 pixels. */
+WEIGHTKERNELS_AVX2_FUNCTION inline __m256i SquaredDifferences(const __m256i a, const __m256i b)
+{
+  const __m256i evenBytes = _mm256_set1_epi32(0x00ff00ff);
+  __m256i even = _mm256_sub_epi16(_mm256_and_si256(a, evenBytes), _mm256_and_si256(b, evenBytes));
+  __m256i odd = _mm256_sub_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+  return _mm256_add_epi32(_mm256_madd_epi16(even, even), _mm256_madd_epi16(odd, odd));
+}
+
+/** |a_i - b_i|^2 of the 8 pixels starting at 'a' and 'b'. */
+WEIGHTKERNELS_AVX2_FUNCTION inline __m256 SquaredDifferences(const unsigned char* const a, const unsigned char* const b,
+                                                             const unsigned int numberOfComponents,
+                                                             const __m256i offsets)
+{
+  if(numberOfComponents == 1)
+    {
+    __m256i difference = _mm256_sub_epi32(LoadPixels(a, numberOfComponents, 0, offsets),
+                                          LoadPixels(b, numberOfComponents, 0, offsets));
+    return _mm256_cvtepi32_ps(_mm256_mullo_epi32(difference, difference));
+    }
+
+  __m256i sum = _mm256_setzero_si256();
+  for(unsigned int word = 0; word < GetNumberOfWords(numberOfComponents); ++word)
+    {
+    sum = _mm256_add_epi32(sum, SquaredDifferences(LoadPixels(a, numberOfComponents, word, offsets),
+                                                   LoadPixels(b, numberOfComponents, word, offsets)));
+    }
+  return _mm256_cvtepi32_ps(sum);
+}
+
+/** The bins of the 8 pixels starting at 'pixels', gathered from a BinTable. */
+WEIGHTKERNELS_AVX2_FUNCTION inline __m256i LookUpBinIndices(const unsigned char* const pixels,
+                                                            const unsigned int numberOfComponents,
+                                                            const unsigned int* const table, const __m256i offsets)
+{
+  const int* const bins = reinterpret_cast<const int*>(table);
+  if(numberOfComponents == 1)
+    {
+    return _mm256_i32gather_epi32(bins, LoadPixels(pixels, 1, 0, offsets), 4);
+    }
+
+  __m256i words = _mm256_setzero_si256();
+  __m256i binIndex = _mm256_setzero_si256();
+  for(unsigned int component = 0; component < numberOfComponents; ++component)
+    {
+    if(component % 4 == 0)
+      {
+      words = LoadPixels(pixels, numberOfComponents, component / 4, offsets);
+      }
+    __m256i componentValue = _mm256_and_si256(words, _mm256_set1_epi32(0xff));
+    binIndex = _mm256_add_epi32(binIndex, _mm256_i32gather_epi32(bins + 256 * component, componentValue, 4));
+    words = _mm256_srli_epi32(words, 8);
+    }
+  return binIndex;
+}
+
+/** As ComputeGrayNWeightsSSE2(), with the table gathered 8 at a time. */
+WEIGHTKERNELS_AVX2_FUNCTION
+void ComputeGrayNWeightsAVX2(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                             const float scale, float* const weights)
+{
+  const __m256i offsets = PixelOffsets(1); // 0 to 7
+
+  static thread_local GrayWeightTable table;
+  if(table.Scale != scale)
+    {
+    const __m256 negativeScale = _mm256_set1_ps(-scale);
+    for(int difference = 0; difference < 256; difference += 8)
+      {
+      __m256 differences = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(difference), offsets));
+      _mm256_storeu_ps(table.Weights + difference,
+                       Exp(_mm256_mul_ps(_mm256_mul_ps(differences, differences), negativeScale)));
+      }
+    table.Scale = scale;
+    }
+
+  unsigned int i = 0;
+  for(; i + 8 <= count; i += 8)
+    {
+    __m256i difference = _mm256_sub_epi32(LoadPixels(a + i, 1, 0, offsets), LoadPixels(b + i, 1, 0, offsets));
+    _mm256_storeu_ps(weights + i, _mm256_i32gather_ps(table.Weights, _mm256_abs_epi32(difference), 4));
+    }
+
+  ComputeNWeightsScalar(a + i, b + i, count - i, 1, scale, weights + i);
+}
+
+WEIGHTKERNELS_AVX2_FUNCTION
+void ComputeNWeightsAVX2(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                         const unsigned int numberOfComponents, const float scale, float* const weights)
+{
+  if(numberOfComponents == 1)
+    {
+    ComputeGrayNWeightsAVX2(a, b, count, scale, weights);
+    return;
+    }
+
+  const __m256 negativeScale = _mm256_set1_ps(-scale);
+  const __m256i offsets = PixelOffsets(numberOfComponents);
+  const unsigned int loadableCount = GetLoadableCount(8, count, numberOfComponents);
+
+  unsigned int i = 0;
+  for(; i + 8 <= loadableCount; i += 8)
+    {
+    __m256 sum = SquaredDifferences(a + i * numberOfComponents, b + i * numberOfComponents, numberOfComponents,
+                                    offsets);
+    _mm256_storeu_ps(weights + i, Exp(_mm256_mul_ps(sum, negativeScale)));
+    }
+  if(i + 8 <= count)
+    {
+    PaddedPixels lastA(a + i * numberOfComponents, 8, numberOfComponents);
+    PaddedPixels lastB(b + i * numberOfComponents, 8, numberOfComponents);
+    __m256 sum = SquaredDifferences(lastA.Pixels, lastB.Pixels, numberOfComponents, offsets);
+    _mm256_storeu_ps(weights + i, Exp(_mm256_mul_ps(sum, negativeScale)));
+    i += 8;
+    }
+
+  ComputeNWeightsScalar(a + i * numberOfComponents, b + i * numberOfComponents, count - i, numberOfComponents,
+                        scale, weights + i);
+}
+
+WEIGHTKERNELS_AVX2_FUNCTION
+double SumPixelDifferencesAVX2(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                               const unsigned int numberOfComponents)
+{
+  if(numberOfComponents == 1)
+    {
+    __m256i sum = _mm256_setzero_si256();
+    unsigned int i = 0;
+    for(; i + 32 <= count; i += 32)
+      {
+      sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                                  _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+      }
+
+    unsigned long long sums[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums), sum);
+    return static_cast<double>(sums[0] + sums[1] + sums[2] + sums[3]) +
+           SumPixelDifferencesScalar(a + i, b + i, count - i, 1);
+    }
+
+  const __m256i offsets = PixelOffsets(numberOfComponents);
+  const unsigned int loadableCount = GetLoadableCount(8, count, numberOfComponents);
+  __m256d total = _mm256_setzero_pd();
+
+  unsigned int i = 0;
+  for(; i + 8 <= loadableCount; i += 8)
+    {
+    __m256 difference = _mm256_sqrt_ps(SquaredDifferences(a + i * numberOfComponents, b + i * numberOfComponents,
+                                                          numberOfComponents, offsets));
+    total = _mm256_add_pd(total, _mm256_cvtps_pd(_mm256_castps256_ps128(difference)));
+    total = _mm256_add_pd(total, _mm256_cvtps_pd(_mm256_extractf128_ps(difference, 1)));
+    }
+  if(i + 8 <= count)
+    {
+    PaddedPixels lastA(a + i * numberOfComponents, 8, numberOfComponents);
+    PaddedPixels lastB(b + i * numberOfComponents, 8, numberOfComponents);
+    __m256 difference = _mm256_sqrt_ps(SquaredDifferences(lastA.Pixels, lastB.Pixels, numberOfComponents, offsets));
+    total = _mm256_add_pd(total, _mm256_cvtps_pd(_mm256_castps256_ps128(difference)));
+    total = _mm256_add_pd(total, _mm256_cvtps_pd(_mm256_extractf128_ps(difference, 1)));
+    i += 8;
+    }
+
+  double totals[4];
+  _mm256_storeu_pd(totals, total);
+  return totals[0] + totals[1] + totals[2] + totals[3] +
+         SumPixelDifferencesScalar(a + i * numberOfComponents, b + i * numberOfComponents, count - i, numberOfComponents);
+}
+
+WEIGHTKERNELS_AVX2_FUNCTION
+void ComputeBinIndicesAVX2(const unsigned char* const pixels, const unsigned int count,
+                           const unsigned int numberOfComponents, const float* const minimum, const float* const scale,
+                           const int binsPerComponent, unsigned int* const binIndices)
+{
+  static thread_local BinTable binTable;
+  const unsigned int* const table = binTable.Get(numberOfComponents, minimum, scale, binsPerComponent);
+  const __m256i offsets = PixelOffsets(numberOfComponents);
+  const unsigned int loadableCount = GetLoadableCount(8, count, numberOfComponents);
+
+  unsigned int i = 0;
+  for(; i + 8 <= loadableCount; i += 8)
+    {
+    __m256i binIndex = LookUpBinIndices(pixels + i * numberOfComponents, numberOfComponents, table, offsets);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(binIndices + i), binIndex);
+    }
+  if(i + 8 <= count)
+    {
+    PaddedPixels last(pixels + i * numberOfComponents, 8, numberOfComponents);
+    __m256i binIndex = LookUpBinIndices(last.Pixels, numberOfComponents, table, offsets);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(binIndices + i), binIndex);
+    i += 8;
+    }
+
+  // GCC leaves the upper halves of the AVX registers dirty before this tail call, slowing down the SSE code after it
+  _mm256_zeroupper();
+  LookUpBinIndices(pixels + i * numberOfComponents, count - i, numberOfComponents, table, binIndices + i);
+}
+
+bool CPUSupportsAVX2()
+{
+#if defined(__GNUC__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  // The CPU must have AVX2 and the OS must save the AVX registers
+  int info[4];
+  __cpuid(info, 1);
+  bool osSavesAVX = (info[2] & (1 << 27)) && ((_xgetbv(0) & 6) == 6);
+  __cpuidex(info, 7, 0);
+  return osSavesAVX && (info[1] & (1 << 5));
+#endif
+}
+
+#endif
+
+/** The InstructionSet of the kernels, or -1 until it is first needed. */
+std::atomic<int> CurrentInstructionSet(-1);
+
+} // namespace
+
+namespace WeightKernels
+{
+
+InstructionSet GetBestInstructionSet()
+{
+#ifdef WEIGHTKERNELS_AVX2
+  static const bool supportsAVX2 = CPUSupportsAVX2();
+  if(supportsAVX2)
+    {
+    return AVX2;
+    }
+#endif
+#ifdef WEIGHTKERNELS_SSE2
+  return SSE2;
+#else
+  return Scalar;
+#endif
+}
+
+InstructionSet GetInstructionSet()
+{
+  int instructionSet = CurrentInstructionSet.load();
+  if(instructionSet < 0)
+    {
+    instructionSet = GetBestInstructionSet();
+    CurrentInstructionSet.store(instructionSet);
+    }
+  return static_cast<InstructionSet>(instructionSet);
+}
+
+void SetInstructionSet(const InstructionSet instructionSet)
+{
+  CurrentInstructionSet.store(std::min(instructionSet, GetBestInstructionSet()));
+}
+
+const char* GetInstructionSetName(const InstructionSet instructionSet)
+{
+  switch(instructionSet)
+    {
+    case AVX2:
+      return "AVX2";
+    case SSE2:
+      return "SSE2";
+    default:
+      return "Scalar";
+    }
+}
+
+void ComputeNWeights(const float* const a, const float* const b, const unsigned int count,
+                     const unsigned int numberOfComponents, const float scale, float* const weights)
+{
+  switch(GetInstructionSet())
+    {
+#ifdef WEIGHTKERNELS_AVX2
+    case AVX2:
+      ComputeNWeightsAVX2(a, b, count, numberOfComponents, scale, weights);
+      return;
+#endif
+#ifdef WEIGHTKERNELS_SSE2
+    case SSE2:
+      ComputeNWeightsSSE2(a, b, count, numberOfComponents, scale, weights);
+      return;
+#endif
+    default:
+      ComputeNWeightsScalar(a, b, count, numberOfComponents, scale, weights);
+    }
+}
+
+void ComputeWeights(const float* const squaredDifferences, const unsigned int count, const float scale,
+                    float* const weights)
+{
+  switch(GetInstructionSet())
+    {
+#ifdef WEIGHTKERNELS_AVX2
+    case AVX2:
+      ComputeWeightsAVX2(squaredDifferences, count, scale, weights);
+      return;
+#endif
+#ifdef WEIGHTKERNELS_SSE2
+    case SSE2:
+      ComputeWeightsSSE2(squaredDifferences, count, scale, weights);
+      return;
+#endif
+    default:
+      ComputeWeightsScalar(squaredDifferences, count, scale, weights);
+    }
+}
+
+double SumPixelDifferences(const float* const a, const float* const b, const unsigned int count,
+                           const unsigned int numberOfComponents)
+{
+  switch(GetInstructionSet())
+    {
+#ifdef WEIGHTKERNELS_AVX2
+    case AVX2:
+      return SumPixelDifferencesAVX2(a, b, count, numberOfComponents);
+#endif
+#ifdef WEIGHTKERNELS_SSE2
+    case SSE2:
+      return SumPixelDifferencesSSE2(a, b, count, numberOfComponents);
+#endif
+    default:
+      return SumPixelDifferencesScalar(a, b, count, numberOfComponents);
+    }
+}
+
+void ComputeBinIndices(const float* const pixels, const unsigned int count, const unsigned int numberOfComponents,
+                       const float* const minimum, const float* const scale, const int binsPerComponent,
+                       unsigned int* const binIndices)
+{
+  switch(GetInstructionSet())
+    {
+#ifdef WEIGHTKERNELS_AVX2
+    case AVX2:
+      ComputeBinIndicesAVX2(pixels, count, numberOfComponents, minimum, scale, binsPerComponent, binIndices);
+      return;
+#endif
+#ifdef WEIGHTKERNELS_SSE2
+    case SSE2:
+      ComputeBinIndicesSSE2(pixels, count, numberOfComponents, minimum, scale, binsPerComponent, binIndices);
+      return;
+#endif
+    default:
+      ComputeBinIndicesScalar(pixels, count, numberOfComponents, minimum, scale, binsPerComponent, binIndices);
+    }
+}
+
+void ComputeNWeights(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                     const unsigned int numberOfComponents, const float scale, float* const weights)
+{
+  switch(GetInstructionSet())
+    {
+#ifdef WEIGHTKERNELS_AVX2
+    case AVX2:
+      ComputeNWeightsAVX2(a, b, count, numberOfComponents, scale, weights);
+      return;
+#endif
+#ifdef WEIGHTKERNELS_SSE2
+    case SSE2:
+      ComputeNWeightsSSE2(a, b, count, numberOfComponents, scale, weights);
+      return;
+#endif
+    default:
+      ComputeNWeightsScalar(a, b, count, numberOfComponents, scale, weights);
+    }
+}
+
+double SumPixelDifferences(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                           const unsigned int numberOfComponents)
+{
+  switch(GetInstructionSet())
+    {
+#ifdef WEIGHTKERNELS_AVX2
+    case AVX2:
+      return SumPixelDifferencesAVX2(a, b, count, numberOfComponents);
+#endif
+#ifdef WEIGHTKERNELS_SSE2
+    case SSE2:
+      return SumPixelDifferencesSSE2(a, b, count, numberOfComponents);
+#endif
+    default:
+      return SumPixelDifferencesScalar(a, b, count, numberOfComponents);
+    }
+}
+
+void ComputeBinIndices(const unsigned char* const pixels, const unsigned int count,
+                       const unsigned int numberOfComponents, const float* const minimum, const float* const scale,
+                       const int binsPerComponent, unsigned int* const binIndices)
+{
+  switch(GetInstructionSet())
+    {
+#ifdef WEIGHTKERNELS_AVX2
+    case AVX2:
+      ComputeBinIndicesAVX2(pixels, count, numberOfComponents, minimum, scale, binsPerComponent, binIndices);
+      return;
+#endif
+    default:
+      ComputeBinIndicesScalar(pixels, count, numberOfComponents, minimum, scale, binsPerComponent, binIndices);
+    }
+}
+
+} // namespace WeightKernels
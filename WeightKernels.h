@@ -0,0 +1,102 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* The per-pixel arithmetic of graph construction, over contiguous runs of pixels. A run is 'count' pixels of
+ * 'numberOfComponents' interleaved floats, as in the buffer of an itk::VectorImage<float, N>.
+ *
+ * Every kernel has a scalar, an SSE2 and an AVX2 version. The version is chosen once at runtime from the
+ * instructions that the CPU supports, so the executable does not have to be compiled for a specific CPU.
+ * The SIMD versions use a polynomial exp (Cephes expf), which is within a few float ulps of std::exp.
+ *
+ * The kernels of 8 bit pixels (e.g. of an itk::Image<itk::RGBPixel<unsigned char>, N>) have SIMD versions of their
+ * own. The components of a pixel are loaded 4 at a time as 32 bit lanes, and their squared differences are summed as
+ * integers with _mm_madd_epi16, so the results are the same as those of the float kernels. The bins of 8 bit pixels
+ * are looked up in a table of the 256 values of each component.
+ *
+ * The templates in WeightKernels.hpp are the same kernels for the pixels of images with integer components, with
+ * the number of components as a template argument (see ImagePixelTraits). 8 bit pixels go to the kernels above. The
+ * squared differences of wider integer pixels are computed without branches over the unrolled components, and only
+ * their exp goes through the SIMD versions.
+*/
+
+#ifndef WeightKernels_H
+#define WeightKernels_H
+
+namespace WeightKernels
+{
+  enum InstructionSet {Scalar = 0, SSE2 = 1, AVX2 = 2};
+
+  /** The best instruction set that this CPU and compiler support. */
+  InstructionSet GetBestInstructionSet();
+
+  /** The instruction set used by the kernels. The default is GetBestInstructionSet(). */
+  InstructionSet GetInstructionSet();
+
+  /** Use another instruction set (e.g. Scalar, to compare against). It is limited to GetBestInstructionSet(). */
+  void SetInstructionSet(const InstructionSet instructionSet);
+
+  const char* GetInstructionSetName(const InstructionSet instructionSet);
+
+  /** weights[i] = exp(-scale * |a_i - b_i|^2). With scale = 1/(2 sigma^2) this is the boundary term. */
+  void ComputeNWeights(const float* const a, const float* const b, const unsigned int count,
+                       const unsigned int numberOfComponents, const float scale, float* const weights);
+
+  /** weights[i] = exp(-scale * squaredDifferences[i]). The arrays may be the same. */
+  void ComputeWeights(const float* const squaredDifferences, const unsigned int count, const float scale,
+                      float* const weights);
+
+  /** The sum over i of |a_i - b_i|. */
+  double SumPixelDifferences(const float* const a, const float* const b, const unsigned int count,
+                             const unsigned int numberOfComponents);
+
+  /** The histogram bin of every pixel: sum over the components c of bin_c * binsPerComponent^c, where
+   *  bin_c = (pixel_c - minimum[c]) * scale[c], truncated and clamped to [0, binsPerComponent). */
+  void ComputeBinIndices(const float* const pixels, const unsigned int count, const unsigned int numberOfComponents,
+                         const float* const minimum, const float* const scale, const int binsPerComponent,
+                         unsigned int* const binIndices);
+
+  /** The kernels above for pixels of unsigned char components. They give the same results as the float kernels for
+   *  the same values. */
+  void ComputeNWeights(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                       const unsigned int numberOfComponents, const float scale, float* const weights);
+
+  double SumPixelDifferences(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                             const unsigned int numberOfComponents);
+
+  void ComputeBinIndices(const unsigned char* const pixels, const unsigned int count,
+                         const unsigned int numberOfComponents, const float* const minimum, const float* const scale,
+                         const int binsPerComponent, unsigned int* const binIndices);
+
+  /** The kernels above for pixels of 'VNumberOfComponents' components of type TComponent. If VNumberOfComponents
+   *  is 0, 'numberOfComponents' is used instead. Float pixels go to the kernels above. */
+  template <unsigned int VNumberOfComponents, typename TComponent>
+  void ComputeNWeights(const TComponent* const a, const TComponent* const b, const unsigned int count,
+                       const unsigned int numberOfComponents, const float scale, float* const weights);
+
+  template <unsigned int VNumberOfComponents, typename TComponent>
+  double SumPixelDifferences(const TComponent* const a, const TComponent* const b, const unsigned int count,
+                             const unsigned int numberOfComponents);
+
+  template <unsigned int VNumberOfComponents, typename TComponent>
+  void ComputeBinIndices(const TComponent* const pixels, const unsigned int count,
+                         const unsigned int numberOfComponents, const float* const minimum, const float* const scale,
+                         const int binsPerComponent, unsigned int* const binIndices);
+}
+
+#include "WeightKernels.hpp"
+
+#endif
@@ -0,0 +1,174 @@
+/*
+Copyright (C) 2011 David Doria, daviddoria@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WeightKernels_HPP
+#define WeightKernels_HPP
+
+#include "WeightKernels.h" // Appease syntax parser
+
+// STL
+#include <algorithm>
+#include <cmath>
+
+namespace WeightKernels
+{
+
+/** The kernels of integer pixels, in a struct so that they can be specialized for float and 8 bit pixels. */
+template <unsigned int VNumberOfComponents, typename TComponent>
+struct PixelKernels
+{
+  /** The number of components of a pixel, a constant if VNumberOfComponents is not 0. */
+  static unsigned int GetNumberOfComponents(const unsigned int numberOfComponents)
+  {
+    return (VNumberOfComponents > 0) ? VNumberOfComponents : numberOfComponents;
+  }
+
+  /** The squared differences are summed as floats, like the float kernels. */
+  static float ComputeSquaredDifference(const TComponent* const a, const TComponent* const b, const unsigned int n)
+  {
+    float sum = 0;
+    for(unsigned int component = 0; component < n; ++component)
+      {
+      float difference = static_cast<float>(a[component]) - static_cast<float>(b[component]);
+      sum += difference * difference;
+      }
+    return sum;
+  }
+
+  static void ComputeSquaredDifferences(const TComponent* const a, const TComponent* const b, const unsigned int count,
+                                        const unsigned int numberOfComponents, float* const squaredDifferences)
+  {
+    const unsigned int n = GetNumberOfComponents(numberOfComponents);
+    for(unsigned int i = 0; i < count; ++i)
+      {
+      squaredDifferences[i] = ComputeSquaredDifference(a + i * n, b + i * n, n);
+      }
+  }
+
+  static void ComputeNWeights(const TComponent* const a, const TComponent* const b, const unsigned int count,
+                              const unsigned int numberOfComponents, const float scale, float* const weights)
+  {
+    ComputeSquaredDifferences(a, b, count, numberOfComponents, weights);
+    ComputeWeights(weights, count, scale, weights);
+  }
+
+  static double SumPixelDifferences(const TComponent* const a, const TComponent* const b, const unsigned int count,
+                                    const unsigned int numberOfComponents)
+  {
+    const unsigned int n = GetNumberOfComponents(numberOfComponents);
+    double total = 0;
+    for(unsigned int i = 0; i < count; ++i)
+      {
+      total += std::sqrt(ComputeSquaredDifference(a + i * n, b + i * n, n));
+      }
+    return total;
+  }
+
+  static void ComputeBinIndices(const TComponent* const pixels, const unsigned int count,
+                                const unsigned int numberOfComponents, const float* const minimum,
+                                const float* const scale, const int binsPerComponent, unsigned int* const binIndices)
+  {
+    const unsigned int n = GetNumberOfComponents(numberOfComponents);
+    const float lastBin = static_cast<float>(binsPerComponent - 1);
+    for(unsigned int i = 0; i < count; ++i)
+      {
+      unsigned int binIndex = 0;
+      unsigned int stride = 1;
+      for(unsigned int component = 0; component < n; ++component)
+        {
+        float value = (static_cast<float>(pixels[i * n + component]) - minimum[component]) * scale[component];
+        value = std::min(std::max(value, 0.0f), lastBin);
+        binIndex += static_cast<int>(value) * stride;
+        stride *= binsPerComponent;
+        }
+      binIndices[i] = binIndex;
+      }
+  }
+};
+
+template <unsigned int VNumberOfComponents>
+struct PixelKernels<VNumberOfComponents, float>
+{
+  static void ComputeNWeights(const float* const a, const float* const b, const unsigned int count,
+                              const unsigned int numberOfComponents, const float scale, float* const weights)
+  {
+    WeightKernels::ComputeNWeights(a, b, count, numberOfComponents, scale, weights);
+  }
+
+  static double SumPixelDifferences(const float* const a, const float* const b, const unsigned int count,
+                                    const unsigned int numberOfComponents)
+  {
+    return WeightKernels::SumPixelDifferences(a, b, count, numberOfComponents);
+  }
+
+  static void ComputeBinIndices(const float* const pixels, const unsigned int count,
+                                const unsigned int numberOfComponents, const float* const minimum,
+                                const float* const scale, const int binsPerComponent, unsigned int* const binIndices)
+  {
+    WeightKernels::ComputeBinIndices(pixels, count, numberOfComponents, minimum, scale, binsPerComponent, binIndices);
+  }
+};
+
+template <unsigned int VNumberOfComponents>
+struct PixelKernels<VNumberOfComponents, unsigned char>
+{
+  static void ComputeNWeights(const unsigned char* const a, const unsigned char* const b, const unsigned int count,
+                              const unsigned int numberOfComponents, const float scale, float* const weights)
+  {
+    WeightKernels::ComputeNWeights(a, b, count, numberOfComponents, scale, weights);
+  }
+
+  static double SumPixelDifferences(const unsigned char* const a, const unsigned char* const b,
+                                    const unsigned int count, const unsigned int numberOfComponents)
+  {
+    return WeightKernels::SumPixelDifferences(a, b, count, numberOfComponents);
+  }
+
+  static void ComputeBinIndices(const unsigned char* const pixels, const unsigned int count,
+                                const unsigned int numberOfComponents, const float* const minimum,
+                                const float* const scale, const int binsPerComponent, unsigned int* const binIndices)
+  {
+    WeightKernels::ComputeBinIndices(pixels, count, numberOfComponents, minimum, scale, binsPerComponent, binIndices);
+  }
+};
+
+template <unsigned int VNumberOfComponents, typename TComponent>
+void ComputeNWeights(const TComponent* const a, const TComponent* const b, const unsigned int count,
+                     const unsigned int numberOfComponents, const float scale, float* const weights)
+{
+  PixelKernels<VNumberOfComponents, TComponent>::ComputeNWeights(a, b, count, numberOfComponents, scale, weights);
+}
+
+template <unsigned int VNumberOfComponents, typename TComponent>
+double SumPixelDifferences(const TComponent* const a, const TComponent* const b, const unsigned int count,
+                           const unsigned int numberOfComponents)
+{
+  return PixelKernels<VNumberOfComponents, TComponent>::SumPixelDifferences(a, b, count, numberOfComponents);
+}
+
+template <unsigned int VNumberOfComponents, typename TComponent>
+void ComputeBinIndices(const TComponent* const pixels, const unsigned int count, const unsigned int numberOfComponents,
+                       const float* const minimum, const float* const scale, const int binsPerComponent,
+                       unsigned int* const binIndices)
+{
+  PixelKernels<VNumberOfComponents, TComponent>::ComputeBinIndices(pixels, count, numberOfComponents, minimum, scale,
+                                                                   binsPerComponent, binIndices);
+}
+
+} // namespace WeightKernels
+
+#endif